@@ -0,0 +1,36 @@
+#include "async_map.hpp"
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// a lookup followed in the same batch by an erase or an overwrite of its key:
+// the lookup must see the value as of its own turn, never the erased node;
+// build with -fsanitize=address to check the erased nodes are not read
+
+int main() {
+	sjtu::async_map<int, std::string> m;
+	std::vector<std::future<std::string> > seen;
+	std::vector<std::future<bool> > erased;
+	for (int i = 0; i < 20000; ++i) {
+		std::string value(40, static_cast<char>('a' + i % 26));
+		m.assign(1, value);
+		seen.push_back(m.at(1));
+		erased.push_back(m.erase(1));
+	}
+	int good = 0;
+	for (int i = 0; i < 20000; ++i) {
+		good += seen[i].get() == std::string(40, static_cast<char>('a' + i % 26)) && erased[i].get();
+	}
+	std::cout << "erase after lookup " << good << std::endl;
+
+	seen.clear();
+	for (int i = 0; i < 20000; ++i) {
+		m.assign(2, std::to_string(i));
+		seen.push_back(m.at(2));
+	}
+	good = 0;
+	for (int i = 0; i < 20000; ++i) good += seen[i].get() == std::to_string(i);
+	std::cout << "overwrite after lookup " << good << std::endl;
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "async_map.hpp"
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// async_map from several threads against the expected final contents, and
+// per-op results when copies of values throw inside a batch
+
+class Value {
+public:
+	int val;
+	int copies;
+
+	explicit Value(int v) : val(v), copies(0) {}
+
+	// the copy the map makes of a submitted 13 throws, the caller's own does not
+	Value(const Value &rhs) : val(rhs.val), copies(rhs.copies + 1) {
+		if (val == 13 && rhs.copies > 0) throw std::runtime_error("copy");
+	}
+
+	Value &operator=(const Value &rhs) {
+		if (rhs.val == 13) throw std::runtime_error("assign");
+		val = rhs.val;
+		return *this;
+	}
+};
+
+int main() {
+	{
+		sjtu::async_map<int, int> m(1024, 64);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < 4; ++t) {
+			workers.push_back(std::thread([&m, t] {
+				for (int i = 0; i < 20000; ++i) {
+					int key = i * 4 + t;
+					m.assign(key, key, nullptr);
+					if (i % 3 == 0) m.erase(key, nullptr);
+				}
+			}));
+		}
+		for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+		int good = 0;
+		for (int key = 0; key < 80000; ++key) {
+			good += m.count(key).get() == ((key / 4) % 3 == 0 ? 0u : 1u);
+		}
+		std::cout << "threads " << good << std::endl;
+	}
+
+	sjtu::async_map<int, Value> m;
+	std::vector<std::future<bool> > inserted;
+	for (int key = 0; key < 200; ++key) inserted.push_back(m.insert(key, Value(key)));
+	std::future<bool> overwritten = m.assign(5, Value(13));
+	std::future<Value> five = m.at(5);
+	std::future<Value> thirteen = m.at(13);
+	int ok = 0, threw = 0;
+	for (int key = 0; key < 200; ++key) {
+		try {
+			ok += inserted[key].get();
+		} catch (std::runtime_error &) {
+			++threw;
+		}
+	}
+	std::cout << "inserted " << ok << ", threw " << threw << std::endl;
+	try {
+		overwritten.get();
+		std::cout << "assign did not throw" << std::endl;
+	} catch (std::runtime_error &) {
+		std::cout << "assign threw" << std::endl;
+	}
+	std::cout << "at(5) " << five.get().val << std::endl;
+	try {
+		thirteen.get();
+		std::cout << "13 present" << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "13 absent" << std::endl;
+	}
+	std::cout << "count(199) " << m.count(199).get() << std::endl;
+	return 0;
+}
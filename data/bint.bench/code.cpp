@@ -0,0 +1,80 @@
+#include "class-bint.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// addition and subtraction of long Bints, and multiplication with the default
+// thresholds and after an explicit Bint::Calibrate(); timings go to stderr, the
+// checks to stdout. Build with -DUTIL_BINT_NO_AVX2 to time the scalar add and
+// subtract kernels.
+
+using Util::Bint;
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+std::string digits(size_t n) {
+	std::string s(n, '0');
+	s[0] = static_cast<char>('1' + rand() % 9);
+	for (size_t i = 1; i < n; ++i) s[i] = static_cast<char>('0' + rand() % 10);
+	return s;
+}
+
+const size_t SIZES[] = {100, 300, 1000, 3000, 10000, 30000, 100000};
+const size_t COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+
+void addAndSubtract(size_t n) {
+	Bint a(digits(n)), b(digits(n));
+	int reps = static_cast<int>(20000000 / n) + 1;
+	Bint sum, difference;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; ++r) sum = a + b;
+	double added = since(t0);
+	t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < reps; ++r) difference = b - a;
+	std::cerr << n << " digits: add " << added * 1000 / reps << " us, subtract " << since(t0) * 1000 / reps
+	          << " us" << std::endl;
+	std::cout << n << " digits: " << (sum - b == a && difference + a == b ? "add and subtract invert" : "WRONG")
+	          << std::endl;
+}
+
+std::vector<Bint> multiplyAll(const std::vector<Bint> &a, const std::vector<Bint> &b, const char *label) {
+	std::vector<Bint> products;
+	for (size_t i = 0; i < COUNT; ++i) {
+		int reps = static_cast<int>(300000 / SIZES[i]) + 1;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (int r = 1; r < reps; ++r) Bint discard = a[i] * b[i];
+		products.push_back(a[i] * b[i]);
+		std::cerr << label << " " << SIZES[i] << " digits: " << since(t0) / reps << " ms" << std::endl;
+	}
+	return products;
+}
+
+int main() {
+	srand(90);
+	for (size_t n = 1000; n <= 1000000; n *= 10) addAndSubtract(n);
+	// carries and borrows running the whole length
+	Bint nines(std::string(100000, '9')), power("1" + std::string(100000, '0'));
+	std::cout << "long carry: " << (nines + Bint(1) == power && power - Bint(1) == nines ? "ok" : "WRONG") << std::endl;
+
+	std::vector<Bint> a, b;
+	for (size_t i = 0; i < COUNT; ++i) {
+		a.push_back(Bint(digits(SIZES[i])));
+		b.push_back(Bint(digits(SIZES[i])));
+	}
+	std::vector<Bint> fixed = multiplyAll(a, b, "default");
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	Bint::Calibrate();
+	std::cerr << "Calibrate: " << since(t0) << " ms" << std::endl;
+	std::vector<Bint> calibrated = multiplyAll(a, b, "calibrated");
+	for (size_t i = 0; i < COUNT; ++i) {
+		Bint sum = a[i] + b[i], difference = a[i] - b[i];
+		bool identity = sum * sum - difference * difference == fixed[i] * Bint(4);
+		std::cout << SIZES[i] << " digits: " << (fixed[i] == calibrated[i] ? "same" : "DIFFERENT") << " product, "
+		          << (identity ? "identity holds" : "WRONG") << std::endl;
+	}
+	return 0;
+}
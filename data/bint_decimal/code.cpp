@@ -0,0 +1,98 @@
+#include "class-bint.hpp"
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+// decimal input and output of Bint, including values long enough for several
+// levels of the divide-and-conquer conversions: strings whose value is known from
+// their shape (10^n, 10^n - 1 and its square), round trips of random digits of
+// every length around the 9-digit chunks and 144-digit groups, zero in its
+// spellings, negatives, and a few values printed for answer.txt
+
+using Util::Bint;
+
+std::string str(const Bint &b) {
+	std::ostringstream os;
+	os << b;
+	return os.str();
+}
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+int main() {
+	// zero however it is written, and signs
+	const char *zeros[] = {"0", "-0", "000", "-000000000000000000000000000000", "--0"};
+	for (size_t i = 0; i < sizeof(zeros) / sizeof(zeros[0]); ++i) {
+		Bint z{std::string(zeros[i])};
+		check(str(z) == "0" && z == Bint(0) && str(-z) == "0", "zero");
+	}
+	check(str(Bint(std::string("0000000000000000000000000123"))) == "123", "leading zeros");
+	check(str(Bint(std::string("-0000000000000000000000000123"))) == "-123", "negative with leading zeros");
+	check(str(Bint(std::string("--123456789012345678901234567890"))) == "123456789012345678901234567890", "double minus");
+	check(str(Bint(-9223372036854775807LL - 1)) == "-9223372036854775808", "smallest long long");
+	try {
+		Bint bad(std::string("12a4"));
+		check(false, "bad digit accepted");
+	} catch (std::invalid_argument &) {}
+
+	// 10^n, 10^n - 1 and (10^n - 1)^2 = 9..980..01, with n up to several D&C levels
+	const size_t lengths[] = {1, 8, 9, 10, 18, 19, 20, 143, 144, 145, 288, 1000, 4321, 20000};
+	bool shapes = true;
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+		size_t n = lengths[i];
+		std::string power = "1" + std::string(n, '0'), nines(n, '9');
+		std::string square = std::string(n - 1, '9') + "8" + std::string(n - 1, '0') + "1";
+		Bint p(power), q(nines);
+		shapes = shapes && str(p) == power && str(q) == nines && str(-q) == "-" + nines;
+		shapes = shapes && p - Bint(1) == q && str(p - Bint(1)) == nines;
+		shapes = shapes && str(q * q) == square && str(q * -q) == "-" + square;
+		shapes = shapes && str(Bint(1) - p) == "-" + nines;
+	}
+	check(shapes, "numbers known by their shape");
+
+	// random digits of every length around the chunk and group sizes round trip exactly
+	std::mt19937 rng(91);
+	bool trips = true;
+	for (size_t n = 1; n <= 600; ++n) {
+		std::string digits(n, '0');
+		digits[0] = static_cast<char>('1' + rng() % 9);
+		for (size_t i = 1; i < n; ++i) digits[i] = static_cast<char>('0' + rng() % 10);
+		Bint b(digits), negative("-" + digits);
+		std::istringstream in(digits + " -" + digits);
+		Bint read, readNegative;
+		in >> read >> readNegative;
+		trips = trips && str(b) == digits && str(negative) == "-" + digits && b == read && negative == readNegative;
+		trips = trips && b + negative == Bint(0) && str(b * Bint(10)) == digits + "0";
+	}
+	for (int round = 0; round < 6; ++round) {
+		size_t n = 10000 + rng() % 60000;
+		std::string digits(n, '0');
+		digits[0] = static_cast<char>('1' + rng() % 9);
+		for (size_t i = 1; i < n; ++i) digits[i] = static_cast<char>('0' + rng() % 10);
+		// runs of zeros, so whole chunks and groups of the output are zero
+		size_t from = rng() % n, span = rng() % 2000;
+		for (size_t i = from; i < n && i < from + span; ++i) digits[i] = i == 0 ? '1' : '0';
+		trips = trips && str(Bint(digits)) == digits;
+	}
+	check(trips, "round trips");
+
+	// values worked out independently in answer.txt
+	Bint three(1);
+	for (int i = 0; i < 1000; ++i) three = three * Bint(3);
+	std::cout << "3^1000 = " << three << std::endl;
+	std::cout << "-(3^1000) + 1 = " << Bint(1) - three << std::endl;
+	Bint factorial(1);
+	for (int i = 2; i <= 300; ++i) factorial = factorial * Bint(i);
+	std::cout << "300! = " << factorial << std::endl;
+	std::cout << "300! - 3^1000 = " << factorial - three << std::endl;
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include "class-bint.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bint values on both sides of the inline limb storage (below 2^256 inline, on the
+// heap above): copies, assignments and moves between every pair of them, values
+// growing out of and shrinking back into the inline limbs, and powers of two
+// around the limb boundaries printed for answer.txt
+
+using Util::Bint;
+
+std::string str(const Bint &b) {
+	std::ostringstream os;
+	os << b;
+	return os.str();
+}
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+int main() {
+	std::vector<std::string> values;
+	values.push_back("0");
+	values.push_back("-1");
+	values.push_back("4294967295");
+	values.push_back("18446744073709551616");
+	// 2^256 - 1, the largest value kept inline, and 2^256, the smallest on the heap
+	values.push_back("115792089237316195423570985008687907853269984665640564039457584007913129639935");
+	values.push_back("-115792089237316195423570985008687907853269984665640564039457584007913129639936");
+	values.push_back("1" + std::string(200, '0'));
+	values.push_back("-" + std::string(300, '9'));
+
+	size_t pairs = 0, good = 0;
+	for (size_t i = 0; i < values.size(); ++i) {
+		for (size_t j = 0; j < values.size(); ++j) {
+			Bint target(values[i]), source(values[j]);
+			bool fine = true;
+
+			Bint copied(source);
+			fine = fine && str(copied) == values[j] && copied == source;
+			target = source;
+			fine = fine && str(target) == values[j] && str(source) == values[j];
+
+			Bint other(values[i]);
+			other = std::move(target);
+			fine = fine && str(other) == values[j] && str(target) == "0";
+			// a moved-from Bint is an ordinary zero again
+			target = source;
+			fine = fine && str(target) == values[j];
+
+			Bint moved(std::move(other));
+			fine = fine && str(moved) == values[j] && str(other) == "0";
+			moved = moved;
+			fine = fine && str(moved) == values[j];
+
+			// the value in a reused object is bounded by its own length, not by its capacity
+			Bint reused(values[i]);
+			reused = source;
+			reused = reused + Bint(1) - Bint(1);
+			fine = fine && reused == source && str(reused) == values[j];
+			++pairs;
+			good += fine;
+		}
+	}
+	std::cout << "copies and moves " << good << " of " << pairs << std::endl;
+
+	// 2^255 + (2^255 - 1) stays inline, + 1 more spills to the heap, - 1 comes back
+	Bint half("57896044618658097711785492504343953926634992332820282019728792003956564819968");
+	Bint top = half + (half - Bint(1));
+	check(str(top) == values[4], "largest inline value");
+	Bint spilled = top + Bint(1);
+	check(str(spilled) == values[5].substr(1), "spill to the heap");
+	spilled = spilled - Bint(1);
+	check(spilled == top && str(spilled) == values[4], "back under 2^256");
+	spilled = Bint(7);
+	check(str(spilled) == "7" && spilled + spilled == Bint(14), "small value in a heap block");
+
+	Bint power(1);
+	for (int k = 1; k <= 600; ++k) {
+		power = power + power;
+		if (k == 31 || k == 32 || k == 63 || k == 64 || k == 255 || k == 256 || k == 257 || k == 600) {
+			std::cout << "2^" << k << " = " << power << std::endl;
+		}
+	}
+	std::vector<Bint> many;
+	for (int i = 0; i < 64; ++i) many.push_back(i % 2 ? power * Bint(i) : Bint(i));
+	std::vector<Bint> copies(many);
+	size_t same = 0;
+	for (int i = 0; i < 64; ++i) same += copies[i] == many[i] && str(copies[i]) == str(many[i]);
+	check(same == 64, "copies in a vector");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -1,13 +1,24 @@
 #include <string>
 #include <iostream>
+#include <atomic>
 #include <cstring>
 #include <cstdlib>
 #include <vector>
 #include <stdexcept>
+#include <functional>
+
+// the add and subtract kernels switch to AVX2 at run time where the compiler can emit it;
+// define UTIL_BINT_NO_AVX2 to keep the scalar kernels, e.g. to compare them
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(UTIL_BINT_NO_AVX2)
+#define UTIL_BINT_AVX2 1
+#endif
 
 namespace Util {
 
-const size_t MIN_CAPACITY = 2048;
+// limbs stored inside the object itself, 256 bits
+const size_t INLINE_CAPACITY = 8;
+// limbs of both factors together that the NTT kernel takes: 2^23 16-bit digits
+const size_t NTT_MAX_LIMBS = 1u << 22;
 
 class Bint {
 	class NewSpaceFailed : public std::runtime_error {
@@ -18,13 +29,61 @@ class Bint {
 	public:
 		BadCast();
 	};
+	typedef unsigned int Limb;
+	// a magnitude, least significant limb first, without leading zero limbs; 0 is empty
+	typedef std::vector<Limb> Mag;
+
+	// limbs [0, length) are the magnitude, base 2^32, least significant first;
+	// data points to inlineData until the value outgrows it
 	bool isMinus = false;
 	size_t length;
-	int *data = nullptr;
-	size_t capacity = MIN_CAPACITY;
-	void _DoubleSpace();
-	void _SafeNewSpace(int *&p, const size_t &len);
+	Limb *data = inlineData;
+	size_t capacity = INLINE_CAPACITY;
+	Limb inlineData[INLINE_CAPACITY];
+	void _Reserve(const size_t &capa);
+	void _Release();
+	void _Trim();
+	bool _IsZero() const;
+	void _SetMagnitude(unsigned long long x);
+	void _SetMagnitude(const Mag &m);
+	Mag _Magnitude() const;
 	explicit Bint(const size_t &capa);
+
+	// limb kernels: out[0, n) = a[0, n) +/- b[0, n) with a carry or borrow in and out,
+	// out may be a
+	static Limb _AddLimbs(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry);
+	static Limb _SubLimbs(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow);
+	static Limb _AddLimbsScalar(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry);
+	static Limb _SubLimbsScalar(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow);
+#ifdef UTIL_BINT_AVX2
+	static Limb _AddLimbsAvx2(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry) __attribute__((target("avx2")));
+	static Limb _SubLimbsAvx2(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow) __attribute__((target("avx2")));
+#endif
+	// out[0, n) = a[0, n) + carry or - borrow
+	static Limb _AddCarry(const Limb *a, Limb *out, size_t n, Limb carry);
+	static Limb _SubBorrow(const Limb *a, Limb *out, size_t n, Limb borrow);
+	static int _CompareLimbs(const Limb *a, size_t na, const Limb *b, size_t nb);
+
+	// magnitude arithmetic behind operator* and the decimal conversions
+	static std::atomic<size_t> karatsubaThreshold;
+	static std::atomic<size_t> nttThreshold;
+	static void _MagTrim(Mag &a);
+	static int _MagCompare(const Mag &a, const Mag &b);
+	static void _MagAddAt(Mag &a, const Mag &b, size_t offset);
+	static void _MagSub(Mag &a, const Mag &b);
+	static void _MagMulAdd(Mag &a, Limb mul, Limb add);
+	static Limb _MagDivSmall(Mag &a, Limb d);
+	static void _MulSchool(const Limb *a, size_t na, const Limb *b, size_t nb, Limb *out);
+	template <unsigned long long MOD>
+	static void _Ntt(std::vector<unsigned long long> &a, bool invert);
+	static Mag _MulNtt(const Mag &a, const Mag &b);
+	static Mag _Mul(const Mag &a, const Mag &b, size_t karatsuba, size_t ntt);
+	static Mag _Reciprocal(const Mag &p);
+	static void _DivMod(const Mag &n, const Mag &p, const Mag &reciprocal, Mag &q, Mag &r);
+	static Mag _FromDecimal(const std::string &digits);
+	static void _AppendChunks(Mag n, size_t chunks, std::string &out);
+	static void _ToDecimal(const Mag &n, size_t k, const std::vector<Mag> &powers, std::vector<Mag> &reciprocals, std::string &out);
+	static std::string _ToDecimal(const Mag &n);
 public:
 	Bint();
 	Bint(int x);
@@ -41,6 +100,11 @@ public:
 	friend Bint abs(const Bint &x);
 	friend Bint abs(Bint &&x);
 
+	// negative, zero or positive as lhs is less than, equal to or greater than rhs
+	friend int compare(const Bint &lhs, const Bint &rhs);
+	// the three-way hook of sjtu::map, so a descent compares once per node
+	friend int compare_keys(const std::less<Bint> &, const Bint &lhs, const Bint &rhs);
+
 	friend bool operator==(const Bint &lhs, const Bint &rhs);
 	friend bool operator!=(const Bint &lhs, const Bint &rhs);
 	friend bool operator<(const Bint &lhs, const Bint &rhs);
@@ -48,12 +112,19 @@ public:
 	friend bool operator<=(const Bint &lhs, const Bint &rhs);
 	friend bool operator>=(const Bint &lhs, const Bint &rhs);
 
+	// order-preserving 64-bit prefix: sign, length and the top limbs
+	friend unsigned long long key_prefix(const Bint &b);
+
 	friend Bint operator+(const Bint &lhs, const Bint &rhs);
 	friend Bint operator-(const Bint &b);
 	friend Bint operator-(Bint &&b);
 	friend Bint operator-(const Bint &lhs, const Bint &rhs);
 	friend Bint operator*(const Bint &lhs, const Bint &rhs);
 
+	// time the kernels on this machine (~50 ms) and set the thresholds operator* switches
+	// at; only runs when called, until then the fixed defaults apply
+	static void Calibrate();
+
 	friend std::istream &operator>>(std::istream &is, Bint &b);
 	friend std::ostream &operator<<(std::ostream &os, const Bint &b);
 
@@ -61,168 +132,169 @@ public:
 };
 }
 
-#include <iomanip>
 #include <algorithm>
+#include <chrono>
+#include <new>
+#ifdef UTIL_BINT_AVX2
+#include <immintrin.h>
+#endif
 
 namespace Util {
 
 Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
 Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
 
-void Bint::_SafeNewSpace(int *&p, const size_t &len)
+void Bint::_Reserve(const size_t &capa)
 {
-	if (p != nullptr) {
-		delete[] p;
-		p = nullptr;
+	if (capa <= capacity) {
+		return;
+	}
+	size_t newCapacity = capacity << 1;
+	while (newCapacity < capa) {
+		newCapacity <<= 1;
 	}
-	p = new int[len];
-	if (p == nullptr) {
+	Limb *newMem = new (std::nothrow) Limb[newCapacity];
+	if (newMem == nullptr) {
 		throw NewSpaceFailed();
 	}
-	memset(p, 0, len * sizeof(unsigned int));
+	memcpy(newMem, data, length * sizeof(Limb));
+	_Release();
+	data = newMem;
+	capacity = newCapacity;
 }
 
-void Bint::_DoubleSpace()
+void Bint::_Release()
 {
-	int *newMem = nullptr;
-	_SafeNewSpace(newMem, capacity << 1);
-	memcpy(newMem, data, capacity * sizeof(int));
-	delete[] data;
-	data = newMem;
-	capacity <<= 1;
+	if (data != inlineData) {
+		delete[] data;
+	}
+	data = inlineData;
+	capacity = INLINE_CAPACITY;
+}
+
+void Bint::_Trim()
+{
+	while (length > 1 && data[length - 1] == 0) {
+		--length;
+	}
+}
+
+bool Bint::_IsZero() const
+{
+	return length == 1 && data[0] == 0;
+}
+
+void Bint::_SetMagnitude(unsigned long long x)
+{
+	// two limbs at most, which fit inline
+	data[0] = static_cast<Limb>(x);
+	data[1] = static_cast<Limb>(x >> 32);
+	length = data[1] ? 2 : 1;
+}
+
+void Bint::_SetMagnitude(const Mag &m)
+{
+	length = 0;
+	_Reserve(m.size());
+	if (m.empty()) {
+		data[0] = 0;
+		length = 1;
+	} else {
+		memcpy(data, m.data(), m.size() * sizeof(Limb));
+		length = m.size();
+	}
+}
+
+Bint::Mag Bint::_Magnitude() const
+{
+	return _IsZero() ? Mag() : Mag(data, data + length);
 }
 
 Bint::Bint()
 	: length(1)
 {
-	_SafeNewSpace(data, capacity);
+	data[0] = 0;
 }
 
 Bint::Bint(int x)
-	: length(0)
+	: Bint(static_cast<long long>(x))
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
 }
 
 Bint::Bint(long long x)
-	: length(0)
+	: isMinus(x < 0), length(0)
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	_SetMagnitude(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : static_cast<unsigned long long>(x));
 }
 
 Bint::Bint(const size_t &capa)
 	: length(1)
 {
-	while (capacity < capa) {
-		capacity <<= 1;
-	}
-	_SafeNewSpace(data, capacity);
+	_Reserve(capa);
+	memset(data, 0, capacity * sizeof(Limb));
 }
 
 Bint::Bint(std::string x)
+	: length(0)
 {
 	while (x[0] == '-') {
 		isMinus = !isMinus;
 		x.erase(0, 1);
 	}
-	while ((capacity << 2) <= x.length()) {
-		capacity <<= 1;
-	}
-
-	_SafeNewSpace(data, capacity);
-
-	size_t mid = x.length() >> 1;
-	for (size_t i = 0; i < mid; ++i) {
-		std::swap(x[i], x[x.length() - 1 - i]);
+	for (size_t i = 0; i < x.length(); ++i) {
+		if (x[i] > '9' || x[i] < '0') {
+			throw BadCast();
+		}
 	}
 
-	const static unsigned int pow10[4] = {1, 10, 100, 1000};
-	for (size_t i = 0; i < capacity; ++i) {
-		if ((i << 2) >= x.length()) {
-			length = i;
-			break;
-		}
-		for (size_t j = 0; j < 4; ++j) {
-			if ((i << 2) + j >= x.length()) {
-				break;
-			}
-			if (x[(i << 2) + j] > '9' || x[(i << 2) + j] < '0') {
-				throw BadCast();
-			}
-			data[i] = data[i] + (x[(i << 2) + j] - '0') * pow10[j];
+	if (x.length() <= 19) {
+		unsigned long long value = 0;
+		for (size_t i = 0; i < x.length(); ++i) {
+			value = value * 10 + (x[i] - '0');
 		}
+		_SetMagnitude(value);
+	} else {
+		_SetMagnitude(_FromDecimal(x));
+	}
+	if (_IsZero()) {
+		isMinus = false;
 	}
 }
 
 Bint::Bint(const Bint &b)
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), length(0)
 {
-	_SafeNewSpace(data, capacity);
-	memcpy(data, b.data, sizeof(unsigned int) * capacity);
+	_Reserve(b.length);
+	memcpy(data, b.data, sizeof(Limb) * b.length);
+	length = b.length;
 }
 
 Bint::Bint(Bint &&b) noexcept
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+	: isMinus(b.isMinus), length(b.length)
 {
-	data = b.data;
-	b.data = nullptr;
+	if (b.data != b.inlineData) {
+		data = b.data;
+		capacity = b.capacity;
+		b.data = b.inlineData;
+		b.capacity = INLINE_CAPACITY;
+	} else {
+		memcpy(data, b.data, sizeof(Limb) * length);
+	}
+	// the moved-from object is zero
+	b.isMinus = false;
+	b.length = 1;
+	b.data[0] = 0;
 }
 
 Bint &Bint::operator=(int x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
-	return *this;
+	return *this = static_cast<long long>(x);
 }
 
 Bint &Bint::operator=(long long x)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
-	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
-	}
-	if (!length) {
-		length = 1;
-	}
+	isMinus = x < 0;
+	_SetMagnitude(x < 0 ? 0ULL - static_cast<unsigned long long>(x) : static_cast<unsigned long long>(x));
 	return *this;
 }
 
@@ -231,11 +303,9 @@ Bint &Bint::operator=(const Bint &rhs)
 	if (this == &rhs) {
 		return *this;
 	}
-	if (rhs.capacity > capacity) {
-		capacity = rhs.capacity;
-		_SafeNewSpace(data, capacity);
-	}
-	memcpy(data, rhs.data, sizeof(unsigned int) * rhs.capacity);
+	length = 0;
+	_Reserve(rhs.length);
+	memcpy(data, rhs.data, sizeof(Limb) * rhs.length);
 	length = rhs.length;
 	isMinus = rhs.isMinus;
 	return *this;
@@ -246,11 +316,21 @@ Bint &Bint::operator=(Bint &&rhs) noexcept
 	if (this == &rhs) {
 		return *this;
 	}
-	capacity = rhs.capacity;
+	if (rhs.data != rhs.inlineData) {
+		_Release();
+		data = rhs.data;
+		capacity = rhs.capacity;
+		rhs.data = rhs.inlineData;
+		rhs.capacity = INLINE_CAPACITY;
+	} else {
+		// fits inline here too, and keeps any heap block this object already owns
+		memcpy(data, rhs.data, sizeof(Limb) * rhs.length);
+	}
 	length = rhs.length;
 	isMinus = rhs.isMinus;
-	data = rhs.data;
-	rhs.data = nullptr;
+	rhs.isMinus = false;
+	rhs.length = 1;
+	rhs.data[0] = 0;
 	return *this;
 }
 
@@ -264,15 +344,13 @@ std::istream &operator>>(std::istream &is, Bint &b)
 
 std::ostream &operator<<(std::ostream &os, const Bint &b)
 {
-	if (b.data == nullptr) {
-		return os;
-	}
-	if (b.isMinus && (b.length > 1 || b.data[0] != 0)) {
+	if (b.isMinus && !b._IsZero()) {
 		os << "-";
 	}
-	os << b.data[b.length - 1];
-	for (long long i = b.length - 2LL; i >= 0; --i) {
-		os << std::setw(4) << std::setfill('0') << b.data[i];
+	if (b.length <= 2) {
+		os << ((b.length == 2 ? static_cast<unsigned long long>(b.data[1]) << 32 : 0ULL) | b.data[0]);
+	} else {
+		os << Bint::_ToDecimal(b._Magnitude());
 	}
 	return os;
 }
@@ -290,143 +368,221 @@ Bint abs(Bint &&b)
 	return b;
 }
 
-bool operator==(const Bint &lhs, const Bint &rhs)
+Bint::Limb Bint::_AddLimbsScalar(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return false;
+	unsigned long long sum = carry;
+	for (size_t i = 0; i < n; ++i) {
+		sum += static_cast<unsigned long long>(a[i]) + b[i];
+		out[i] = static_cast<Limb>(sum);
+		sum >>= 32;
 	}
-	if (lhs.length != rhs.length) {
-		return false;
+	return static_cast<Limb>(sum);
+}
+
+Bint::Limb Bint::_SubLimbsScalar(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow)
+{
+	unsigned long long diff = 0;
+	for (size_t i = 0; i < n; ++i) {
+		diff = static_cast<unsigned long long>(a[i]) - b[i] - borrow;
+		out[i] = static_cast<Limb>(diff);
+		borrow = static_cast<Limb>(diff >> 63);
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return false;
-		}
+	return borrow;
+}
+
+#ifdef UTIL_BINT_AVX2
+/**
+ * Eight limbs at a time: lane sums without carries first, then the carries of the
+ * block as one 8-bit addition. A lane generates a carry when its sum wrapped and
+ * propagates one when its sum is all ones (never both), so with g and p the masks
+ * of those lanes, the lanes receiving a carry are ((g << 1 | carry) + p) ^ p and
+ * bit 8 of the sum carries out of the block. Borrows work the same way, with the
+ * lanes whose difference is zero propagating.
+ */
+Bint::Limb Bint::_AddLimbsAvx2(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry)
+{
+	const __m256i sign = _mm256_set1_epi32(-0x7FFFFFFF - 1), ones = _mm256_set1_epi32(-1);
+	const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		__m256i sum = _mm256_add_epi32(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi32(_mm256_xor_si256(x, sign), _mm256_xor_si256(sum, sign));
+		unsigned g = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(wrapped)));
+		unsigned p = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sum, ones))));
+		unsigned carries = ((g << 1) | carry) + p;
+		__m256i in = _mm256_set1_epi32(static_cast<int>((carries ^ p) & 0xFF));
+		// subtracting the all-ones lanes of the mask adds the carries
+		sum = _mm256_sub_epi32(sum, _mm256_cmpeq_epi32(_mm256_and_si256(in, bits), bits));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), sum);
+		carry = carries >> 8;
 	}
-	return true;
+	return _AddLimbsScalar(a + i, b + i, out + i, n - i, carry);
 }
 
-bool operator!=(const Bint &lhs, const Bint &rhs)
+Bint::Limb Bint::_SubLimbsAvx2(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return true;
+	const __m256i sign = _mm256_set1_epi32(-0x7FFFFFFF - 1), zero = _mm256_setzero_si256();
+	const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		__m256i diff = _mm256_sub_epi32(x, y);
+		__m256i wrapped = _mm256_cmpgt_epi32(_mm256_xor_si256(y, sign), _mm256_xor_si256(x, sign));
+		unsigned g = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(wrapped)));
+		unsigned p = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(diff, zero))));
+		unsigned borrows = ((g << 1) | borrow) + p;
+		__m256i in = _mm256_set1_epi32(static_cast<int>((borrows ^ p) & 0xFF));
+		diff = _mm256_add_epi32(diff, _mm256_cmpeq_epi32(_mm256_and_si256(in, bits), bits));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), diff);
+		borrow = borrows >> 8;
 	}
-	if (lhs.length != rhs.length) {
-		return true;
+	return _SubLimbsScalar(a + i, b + i, out + i, n - i, borrow);
+}
+#endif
+
+Bint::Limb Bint::_AddLimbs(const Limb *a, const Limb *b, Limb *out, size_t n, Limb carry)
+{
+#ifdef UTIL_BINT_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	if (avx2) {
+		return _AddLimbsAvx2(a, b, out, n, carry);
 	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return true;
-		}
+#endif
+	return _AddLimbsScalar(a, b, out, n, carry);
+}
+
+Bint::Limb Bint::_SubLimbs(const Limb *a, const Limb *b, Limb *out, size_t n, Limb borrow)
+{
+#ifdef UTIL_BINT_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	if (avx2) {
+		return _SubLimbsAvx2(a, b, out, n, borrow);
 	}
-	return false;
+#endif
+	return _SubLimbsScalar(a, b, out, n, borrow);
 }
 
-bool operator<(const Bint &lhs, const Bint &rhs)
+Bint::Limb Bint::_AddCarry(const Limb *a, Limb *out, size_t n, Limb carry)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
+	size_t i = 0;
+	for (; carry && i < n; ++i) {
+		out[i] = a[i] + 1;
+		carry = out[i] == 0;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
-		}
-		return false;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return false;
+	if (out != a) {
+		memcpy(out + i, a + i, (n - i) * sizeof(Limb));
 	}
+	return carry;
 }
 
-bool operator>(const Bint &lhs, const Bint &rhs)
+Bint::Limb Bint::_SubBorrow(const Limb *a, Limb *out, size_t n, Limb borrow)
 {
-	return rhs < lhs;
+	size_t i = 0;
+	for (; borrow && i < n; ++i) {
+		borrow = a[i] == 0;
+		out[i] = a[i] - 1;
+	}
+	if (out != a) {
+		memcpy(out + i, a + i, (n - i) * sizeof(Limb));
+	}
+	return borrow;
 }
 
-bool operator<=(const Bint &lhs, const Bint &rhs)
+int Bint::_CompareLimbs(const Limb *a, size_t na, const Limb *b, size_t nb)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
+	if (na != nb) {
+		return na < nb ? -1 : 1;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+	for (size_t i = na; i > 0; --i) {
+		if (a[i - 1] != b[i - 1]) {
+			return a[i - 1] < b[i - 1] ? -1 : 1;
 		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return true;
 	}
+	return 0;
 }
 
-bool operator>=(const Bint &lhs, const Bint &rhs)
+int compare(const Bint &lhs, const Bint &rhs)
 {
 	if (lhs.isMinus != rhs.isMinus) {
-		return lhs.isMinus;
+		return lhs.isMinus ? -1 : 1;
 	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return true;
+	int magnitude = Bint::_CompareLimbs(lhs.data, lhs.length, rhs.data, rhs.length);
+	return lhs.isMinus ? -magnitude : magnitude;
+}
+
+int compare_keys(const std::less<Bint> &, const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs);
+}
+
+bool operator==(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) == 0;
+}
+
+bool operator!=(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) != 0;
+}
+
+bool operator<(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) < 0;
+}
+
+bool operator>(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) > 0;
+}
+
+bool operator<=(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) <= 0;
+}
+
+bool operator>=(const Bint &lhs, const Bint &rhs)
+{
+	return compare(lhs, rhs) >= 0;
+}
+
+/**
+ * key_prefix(a) < key_prefix(b) implies a < b, equal prefixes decide nothing.
+ * Layout of the magnitude part: 21 bits of length, then the top limb and the
+ * high 10 bits of the one below it; lengths that do not fit leave the limbs out.
+ * Negative numbers get the magnitude part inverted under a cleared sign bit.
+ */
+unsigned long long key_prefix(const Bint &b)
+{
+	const size_t LENGTH_BITS = 21, LIMB_BITS = 32, NEXT_BITS = 10;
+	const unsigned long long lengthCap = (1ULL << LENGTH_BITS) - 1;
+	unsigned long long magnitude;
+	if (b.length >= lengthCap) {
+		magnitude = lengthCap << (LIMB_BITS + NEXT_BITS);
 	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
+		magnitude = (static_cast<unsigned long long>(b.length) << LIMB_BITS) | b.data[b.length - 1];
+		magnitude <<= NEXT_BITS;
+		if (b.length >= 2) {
+			magnitude |= b.data[b.length - 2] >> (LIMB_BITS - NEXT_BITS);
 		}
-		return true;
 	}
+	const unsigned long long signBit = 1ULL << 63;
+	return b.isMinus ? (~magnitude & (signBit - 1)) : (signBit | magnitude);
 }
 
-
 Bint operator+(const Bint &lhs, const Bint &rhs)
 {
 	if (lhs.isMinus == rhs.isMinus) {
 		size_t maxLen = std::max(lhs.length, rhs.length);
 		size_t expectLen = maxLen + 1;
 		Bint result(expectLen); // special constructor
-		for (size_t i = 0; i < maxLen; ++i) {
-			result.data[i] = lhs.data[i] + rhs.data[i];
-		}
-		for (size_t i = 0; i < maxLen; ++i) {
-			if (result.data[i] > 10000) {
-				result.data[i] -= 10000;
-				++result.data[i + 1];
-			}
-		}
+		const Bint &longer = lhs.length >= rhs.length ? lhs : rhs;
+		const Bint &shorter = lhs.length >= rhs.length ? rhs : lhs;
+		Bint::Limb carry = Bint::_AddLimbs(longer.data, shorter.data, result.data, shorter.length, 0);
+		carry = Bint::_AddCarry(longer.data + shorter.length, result.data + shorter.length, maxLen - shorter.length, carry);
+		result.data[maxLen] = carry;
 		result.length = result.data[maxLen] > 0 ? maxLen + 1 : maxLen;
 		result.isMinus = lhs.isMinus;
 		return result;
@@ -442,13 +598,13 @@ Bint operator+(const Bint &lhs, const Bint &rhs)
 Bint operator-(const Bint &b)
 {
 	Bint result(b);
-	result.isMinus = !result.isMinus;
+	result.isMinus = !result.isMinus && !result._IsZero();
 	return result;
 }
 
 Bint operator-(Bint &&b)
 {
-	b.isMinus = !b.isMinus;
+	b.isMinus = !b.isMinus && !b._IsZero();
 	return b;
 }
 
@@ -461,19 +617,12 @@ Bint operator-(const Bint &lhs, const Bint &rhs)
 			if (lhs < rhs) {
 				return -(rhs - lhs);
 			}
-			Bint result(std::max(lhs.length, rhs.length));
-			for (size_t i = 0; i < lhs.length; ++i) {
-				result.data[i] = lhs.data[i] - rhs.data[i];
-			}
-			for (size_t i = 0; i < lhs.length; ++i) {
-				if (result.data[i] < 0) {
-					result.data[i] += 10000;
-					++result.data[i + 1];
-				}
-			}
-			while (result.length > 1 && result.data[result.length - 1] == 0) {
-				--result.length;
-			}
+			// lhs >= rhs here, so lhs.length >= rhs.length
+			Bint result(lhs.length);
+			Bint::Limb borrow = Bint::_SubLimbs(lhs.data, rhs.data, result.data, rhs.length, 0);
+			Bint::_SubBorrow(lhs.data + rhs.length, result.data + rhs.length, lhs.length - rhs.length, borrow);
+			result.length = lhs.length;
+			result._Trim();
 			return result;
 		}
 	} else {
@@ -481,36 +630,504 @@ Bint operator-(const Bint &lhs, const Bint &rhs)
 	}
 }
 
-Bint operator*(const Bint &lhs, const Bint &rhs)
+// defaults close to what Calibrate picks on current x86-64, in limbs
+std::atomic<size_t> Bint::karatsubaThreshold(24);
+std::atomic<size_t> Bint::nttThreshold(4096);
+
+void Bint::_MagTrim(Mag &a)
 {
-	size_t expectLen = lhs.length + rhs.length + 2;
-	Bint result(expectLen);
-	for (size_t i = 0; i < lhs.length; ++i) {
-		for (size_t j = 0; j < rhs.length; ++j) {
-			long long tmp = result.data[i + j] + static_cast<long long>(lhs.data[i]) * rhs.data[j];
-			if (tmp >= 10000) {
-				result.data[i + j] = tmp % 10000;
-				result.data[i + j + 1] += static_cast<int>(tmp / 10000);
+	while (!a.empty() && a.back() == 0) {
+		a.pop_back();
+	}
+}
+
+int Bint::_MagCompare(const Mag &a, const Mag &b)
+{
+	return _CompareLimbs(a.data(), a.size(), b.data(), b.size());
+}
+
+// a += b * 2^(32 * offset)
+void Bint::_MagAddAt(Mag &a, const Mag &b, size_t offset)
+{
+	if (b.empty()) {
+		return;
+	}
+	if (a.size() < offset + b.size()) {
+		a.resize(offset + b.size(), 0);
+	}
+	Limb *at = a.data() + offset;
+	Limb carry = _AddLimbs(at, b.data(), at, b.size(), 0);
+	carry = _AddCarry(at + b.size(), at + b.size(), a.size() - offset - b.size(), carry);
+	if (carry) {
+		a.push_back(carry);
+	}
+}
+
+// a -= b, for a >= b
+void Bint::_MagSub(Mag &a, const Mag &b)
+{
+	Limb borrow = _SubLimbs(a.data(), b.data(), a.data(), b.size(), 0);
+	_SubBorrow(a.data() + b.size(), a.data() + b.size(), a.size() - b.size(), borrow);
+	_MagTrim(a);
+}
+
+// a = a * mul + add
+void Bint::_MagMulAdd(Mag &a, Limb mul, Limb add)
+{
+	unsigned long long carry = add;
+	for (size_t i = 0; i < a.size(); ++i) {
+		carry += static_cast<unsigned long long>(a[i]) * mul;
+		a[i] = static_cast<Limb>(carry);
+		carry >>= 32;
+	}
+	if (carry) {
+		a.push_back(static_cast<Limb>(carry));
+	}
+	_MagTrim(a);
+}
+
+// a /= d, returns the remainder
+Bint::Limb Bint::_MagDivSmall(Mag &a, Limb d)
+{
+	unsigned long long rest = 0;
+	for (size_t i = a.size(); i > 0; --i) {
+		rest = (rest << 32) | a[i - 1];
+		a[i - 1] = static_cast<Limb>(rest / d);
+		rest %= d;
+	}
+	_MagTrim(a);
+	return static_cast<Limb>(rest);
+}
+
+// out[0, na + nb) = a[0, na) * b[0, nb)
+void Bint::_MulSchool(const Limb *a, size_t na, const Limb *b, size_t nb, Limb *out)
+{
+	std::fill(out, out + na + nb, 0u);
+	for (size_t i = 0; i < na; ++i) {
+		unsigned long long carry = 0;
+		for (size_t j = 0; j < nb; ++j) {
+			carry += static_cast<unsigned long long>(a[i]) * b[j] + out[i + j];
+			out[i + j] = static_cast<Limb>(carry);
+			carry >>= 32;
+		}
+		out[i + nb] = static_cast<Limb>(carry);
+	}
+}
+
+// the modulus is a template argument so that the reductions compile to multiplications
+template <unsigned long long MOD>
+void Bint::_Ntt(std::vector<unsigned long long> &a, bool invert)
+{
+	const unsigned long long mod = MOD;
+	auto power = [](unsigned long long base, unsigned long long e) {
+		unsigned long long r = 1;
+		for (base %= mod; e; e >>= 1, base = base * base % mod) {
+			if (e & 1) {
+				r = r * base % mod;
+			}
+		}
+		return r;
+	};
+	size_t n = a.size();
+	for (size_t i = 1, j = 0; i < n; ++i) {
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(a[i], a[j]);
+		}
+	}
+	// roots[j] = w^j for an n-th root of unity w; both moduli have 3 as a primitive root
+	std::vector<unsigned long long> roots(std::max<size_t>(n >> 1, 1));
+	unsigned long long w = power(3, (mod - 1) / n);
+	if (invert) {
+		w = power(w, mod - 2);
+	}
+	roots[0] = 1;
+	for (size_t j = 1; j < roots.size(); ++j) {
+		roots[j] = roots[j - 1] * w % mod;
+	}
+	for (size_t len = 2; len <= n; len <<= 1) {
+		size_t stride = n / len;
+		for (size_t i = 0; i < n; i += len) {
+			for (size_t j = 0; j < (len >> 1); ++j) {
+				unsigned long long u = a[i + j], v = a[i + j + (len >> 1)] * roots[j * stride] % mod;
+				a[i + j] = u + v < mod ? u + v : u + v - mod;
+				a[i + j + (len >> 1)] = u >= v ? u - v : u + mod - v;
+			}
+		}
+	}
+	if (invert) {
+		unsigned long long inv = power(n, mod - 2);
+		for (size_t i = 0; i < n; ++i) {
+			a[i] = a[i] * inv % mod;
+		}
+	}
+}
+
+// a * b by NTT modulo two primes and CRT over 16-bit digits, for
+// a.size() + b.size() <= NTT_MAX_LIMBS; each coefficient is below 2^55 < p1 * p2.
+// Squaring, with b the same object as a, transforms once
+Bint::Mag Bint::_MulNtt(const Mag &a, const Mag &b)
+{
+	const unsigned long long P1 = 998244353, P2 = 469762049;
+	size_t digits = 2 * (a.size() + b.size()), n = 1;
+	while (n < digits) {
+		n <<= 1;
+	}
+	bool square = &a == &b;
+	std::vector<unsigned long long> r1(n, 0), r2(n, 0), s1, s2;
+	for (size_t i = 0; i < a.size(); ++i) {
+		r1[2 * i] = r2[2 * i] = a[i] & 0xFFFF;
+		r1[2 * i + 1] = r2[2 * i + 1] = a[i] >> 16;
+	}
+	_Ntt<P1>(r1, false);
+	_Ntt<P2>(r2, false);
+	if (square) {
+		s1 = r1;
+		s2 = r2;
+	} else {
+		s1.assign(n, 0);
+		s2.assign(n, 0);
+		for (size_t i = 0; i < b.size(); ++i) {
+			s1[2 * i] = s2[2 * i] = b[i] & 0xFFFF;
+			s1[2 * i + 1] = s2[2 * i + 1] = b[i] >> 16;
+		}
+		_Ntt<P1>(s1, false);
+		_Ntt<P2>(s2, false);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		r1[i] = r1[i] * s1[i] % P1;
+		r2[i] = r2[i] * s2[i] % P2;
+	}
+	_Ntt<P1>(r1, true);
+	_Ntt<P2>(r2, true);
+	// Garner: x = r1 + P1 * ((r2 - r1) / P1 mod P2), then carry in base 2^16
+	const unsigned long long P1_INV = 208783132; // P1^-1 mod P2
+	Mag result(a.size() + b.size(), 0);
+	unsigned long long carry = 0;
+	for (size_t i = 0; i < digits; ++i) {
+		unsigned long long t = (r2[i] + P2 - r1[i] % P2) % P2 * P1_INV % P2;
+		carry += r1[i] + P1 * t;
+		result[i >> 1] |= static_cast<Limb>(carry & 0xFFFF) << (i & 1 ? 16 : 0);
+		carry >>= 16;
+	}
+	_MagTrim(result);
+	return result;
+}
+
+// a * b: schoolbook up to karatsuba limbs in the shorter factor, NTT from ntt limbs
+// while the product fits it, Karatsuba levels in between
+Bint::Mag Bint::_Mul(const Mag &a, const Mag &b, size_t karatsuba, size_t ntt)
+{
+	if (a.empty() || b.empty()) {
+		return Mag();
+	}
+	const Mag &x = a.size() >= b.size() ? a : b;
+	const Mag &y = a.size() >= b.size() ? b : a;
+	Mag result;
+	if (y.size() <= karatsuba) {
+		result.resize(x.size() + y.size());
+		_MulSchool(x.data(), x.size(), y.data(), y.size(), result.data());
+	} else if (y.size() >= ntt && x.size() + y.size() <= NTT_MAX_LIMBS) {
+		return _MulNtt(x, y);
+	} else if (2 * y.size() <= x.size()) {
+		// split the longer factor into blocks as long as the shorter one
+		for (size_t start = 0; start < x.size(); start += y.size()) {
+			Mag block(x.begin() + start, x.begin() + std::min(x.size(), start + y.size()));
+			_MagTrim(block);
+			_MagAddAt(result, _Mul(block, y, karatsuba, ntt), start);
+		}
+	} else {
+		// y is longer than half of x, so both have a high part
+		size_t half = x.size() >> 1;
+		Mag x0(x.begin(), x.begin() + half), x1(x.begin() + half, x.end());
+		Mag y0(y.begin(), y.begin() + half), y1(y.begin() + half, y.end());
+		_MagTrim(x0);
+		_MagTrim(y0);
+		Mag low = _Mul(x0, y0, karatsuba, ntt), high = _Mul(x1, y1, karatsuba, ntt);
+		_MagAddAt(x0, x1, 0);
+		_MagAddAt(y0, y1, 0);
+		Mag middle = _Mul(x0, y0, karatsuba, ntt);
+		_MagSub(middle, low);
+		_MagSub(middle, high);
+		result.swap(low);
+		_MagAddAt(result, middle, half);
+		_MagAddAt(result, high, 2 * half);
+	}
+	_MagTrim(result);
+	return result;
+}
+
+// floor(2^(64n) / p) for n = p.size(), by Newton's iteration from the reciprocal
+// of the top half of p, or from a 64-bit estimate for two limbs
+Bint::Mag Bint::_Reciprocal(const Mag &p)
+{
+	size_t n = p.size();
+	Mag scale(2 * n + 1, 0);
+	scale[2 * n] = 1;
+	if (n == 1) {
+		_MagDivSmall(scale, p[0]);
+		return scale;
+	}
+	Mag x;
+	if (n == 2) {
+		unsigned long long top = (static_cast<unsigned long long>(p[1]) << 32) | p[0];
+		unsigned __int128 estimate = ~static_cast<unsigned __int128>(0) / top;
+		for (; estimate; estimate >>= 32) {
+			x.push_back(static_cast<Limb>(estimate));
+		}
+	} else {
+		// correct to about h limbs, so one round below leaves a few units off
+		size_t h = n / 2 + 1;
+		x = _Reciprocal(Mag(p.end() - h, p.end()));
+		x.insert(x.begin(), n - h, 0);
+	}
+	size_t k = karatsubaThreshold.load(std::memory_order_relaxed), t = nttThreshold.load(std::memory_order_relaxed);
+	// x += x * (scale - p * x) / scale, which doubles the correct limbs each round;
+	// once the step is below half the limbs, what remains is below a unit or two
+	for (int round = 0; round < 64; ++round) {
+		Mag error = _Mul(p, x, k, t);
+		int side = _MagCompare(error, scale);
+		if (side == 0) {
+			return x;
+		}
+		if (side < 0) {
+			Mag rest = scale;
+			_MagSub(rest, error);
+			error.swap(rest);
+		} else {
+			_MagSub(error, scale);
+		}
+		Mag step = _Mul(x, error, k, t);
+		step.erase(step.begin(), step.begin() + std::min(step.size(), 2 * n));
+		if (side < 0) {
+			if (step.empty()) {
+				break;
+			}
+			_MagAddAt(x, step, 0);
+		} else {
+			_MagSub(x, step.empty() ? Mag(1, 1) : step);
+		}
+		if (2 * step.size() <= n) {
+			break;
+		}
+	}
+	// off by a few units at most now
+	Mag product = _Mul(p, x, k, t), one(1, 1);
+	while (_MagCompare(product, scale) > 0) {
+		_MagSub(x, one);
+		_MagSub(product, p);
+	}
+	_MagAddAt(product, p, 0);
+	while (_MagCompare(product, scale) <= 0) {
+		_MagAddAt(x, one, 0);
+		_MagAddAt(product, p, 0);
+	}
+	return x;
+}
+
+// q, r = n / p, n % p for n < 2^(64 * p.size()), given reciprocal = _Reciprocal(p)
+void Bint::_DivMod(const Mag &n, const Mag &p, const Mag &reciprocal, Mag &q, Mag &r)
+{
+	size_t k = karatsubaThreshold.load(std::memory_order_relaxed), t = nttThreshold.load(std::memory_order_relaxed);
+	// only the top limbs of n matter to q; with those and the reciprocal rounded
+	// down, q starts at most three below the quotient
+	size_t dropped = p.size() > 1 && n.size() > p.size() + 1 ? n.size() - p.size() - 1 : 0;
+	q = _Mul(Mag(n.begin() + dropped, n.end()), reciprocal, k, t);
+	q.erase(q.begin(), q.begin() + std::min(q.size(), 2 * p.size() - dropped));
+	r = n;
+	_MagSub(r, _Mul(q, p, k, t));
+	while (_MagCompare(r, p) >= 0) {
+		_MagSub(r, p);
+		_MagAddAt(q, Mag(1, 1), 0);
+	}
+}
+
+// decimal digits without a sign to a magnitude: groups of 144 digits by multiply-add,
+// then neighbouring groups joined in pairs, one multiplication by a power of ten each
+Bint::Mag Bint::_FromDecimal(const std::string &digits)
+{
+	const size_t CHUNK = 9, GROUP = 16 * CHUNK;
+	std::vector<Mag> parts;
+	for (size_t end = digits.length(); end > 0;) {
+		size_t begin = end > GROUP ? end - GROUP : 0;
+		Mag part;
+		for (size_t i = begin; i < end;) {
+			size_t step = (end - i) % CHUNK ? (end - i) % CHUNK : CHUNK;
+			Limb chunk = 0, scale = 1;
+			for (size_t j = 0; j < step; ++j, ++i) {
+				chunk = chunk * 10 + (digits[i] - '0');
+				scale *= 10;
+			}
+			_MagMulAdd(part, scale, chunk);
+		}
+		parts.push_back(part);
+		end = begin;
+	}
+	if (parts.empty()) {
+		return Mag();
+	}
+
+	size_t k = karatsubaThreshold.load(std::memory_order_relaxed), t = nttThreshold.load(std::memory_order_relaxed);
+	// power = 10^(digits in each of parts but the last)
+	Mag power(1, 1);
+	for (size_t i = 0; i < GROUP / CHUNK; ++i) {
+		_MagMulAdd(power, 1000000000u, 0);
+	}
+	while (parts.size() > 1) {
+		std::vector<Mag> joined;
+		for (size_t i = 0; i < parts.size(); i += 2) {
+			if (i + 1 == parts.size()) {
+				joined.push_back(parts[i]);
 			} else {
-				result.data[i + j] = tmp;
+				Mag value = _Mul(parts[i + 1], power, k, t);
+				_MagAddAt(value, parts[i], 0);
+				joined.push_back(value);
 			}
 		}
+		parts.swap(joined);
+		if (parts.size() > 1) {
+			power = _Mul(power, power, k, t);
+		}
+	}
+	return parts[0];
+}
+
+// appends n as nine-digit chunks, zero-padded on the left to chunks of them
+void Bint::_AppendChunks(Mag n, size_t chunks, std::string &out)
+{
+	std::vector<Limb> low;
+	while (!n.empty()) {
+		low.push_back(_MagDivSmall(n, 1000000000u));
+	}
+	out.append(9 * (chunks - low.size()), '0');
+	for (size_t i = low.size(); i > 0; --i) {
+		char text[9];
+		Limb chunk = low[i - 1];
+		for (size_t j = 9; j > 0; --j, chunk /= 10) {
+			text[j - 1] = static_cast<char>('0' + chunk % 10);
+		}
+		out.append(text, 9);
+	}
+}
+
+// appends n < powers[k]^2 as exactly 2^(k + 1) nine-digit chunks, splitting it
+// into quotient and remainder by powers[k] = 10^(9 * 2^k)
+void Bint::_ToDecimal(const Mag &n, size_t k, const std::vector<Mag> &powers, std::vector<Mag> &reciprocals, std::string &out)
+{
+	const size_t LEAF_LIMBS = 32;
+	if (n.size() <= LEAF_LIMBS) {
+		_AppendChunks(n, size_t(2) << k, out);
+		return;
 	}
-	result.length = lhs.length + rhs.length -1;
-	while (result.data[result.length] > 0) {
-		++result.length;
+	if (reciprocals[k].empty()) {
+		reciprocals[k] = _Reciprocal(powers[k]);
 	}
-	while (result.length > 1 && result.data[result.length - 1] == 0) {
-		--result.length;
+	Mag q, r;
+	_DivMod(n, powers[k], reciprocals[k], q, r);
+	_ToDecimal(q, k - 1, powers, reciprocals, out);
+	_ToDecimal(r, k - 1, powers, reciprocals, out);
+}
+
+std::string Bint::_ToDecimal(const Mag &n)
+{
+	size_t k = karatsubaThreshold.load(std::memory_order_relaxed), t = nttThreshold.load(std::memory_order_relaxed);
+	// square 10^9 until the square of the last power exceeds n
+	std::vector<Mag> powers(1, Mag(1, 1000000000u));
+	while (2 * powers.back().size() - 1 <= n.size()) {
+		powers.push_back(_Mul(powers.back(), powers.back(), k, t));
 	}
+	std::vector<Mag> reciprocals(powers.size());
+	std::string out;
+	_ToDecimal(n, powers.size() - 1, powers, reciprocals, out);
+	size_t first = out.find_first_not_of('0');
+	return first == std::string::npos ? std::string("0") : out.substr(first);
+}
+
+void Bint::Calibrate()
+{
+	typedef std::chrono::steady_clock clock;
+	auto seconds = [](clock::time_point a, clock::time_point b) {
+		return std::chrono::duration<double>(b - a).count();
+	};
+	unsigned int seed = 12345;
+	auto limbs = [&seed](size_t n) {
+		Mag v(n);
+		for (size_t i = 0; i < n; ++i) {
+			seed = seed * 1103515245u + 12345u;
+			v[i] = seed ^ (seed << 13);
+		}
+		v[n - 1] |= 1;
+		return v;
+	};
+	const size_t NEVER = static_cast<size_t>(-1);
+
+	// Karatsuba: the smallest half size t at which one Karatsuba level over 2t beats schoolbook
+	size_t karatsuba = 256;
+	const size_t kCandidates[] = {8, 12, 16, 24, 32, 48, 64, 96, 128, 192};
+	for (size_t c = 0; c < sizeof(kCandidates) / sizeof(kCandidates[0]); ++c) {
+		size_t t = kCandidates[c], n = 2 * t;
+		Mag a = limbs(n), b = limbs(n);
+		size_t reps = 1 + 400000 / (n * n);
+		clock::time_point t0 = clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			_Mul(a, b, n, NEVER);
+		}
+		clock::time_point t1 = clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			_Mul(a, b, t, NEVER);
+		}
+		clock::time_point t2 = clock::now();
+		if (seconds(t1, t2) < seconds(t0, t1)) {
+			karatsuba = t;
+			break;
+		}
+	}
+
+	// NTT: the smallest length at which it beats Karatsuba, or 8192 limbs if none below does
+	size_t ntt = 8192;
+	for (size_t n = 64; n < 8192; n <<= 1) {
+		Mag a = limbs(n), b = limbs(n);
+		size_t reps = 1 + 4096 / n;
+		clock::time_point t0 = clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			_Mul(a, b, karatsuba, NEVER);
+		}
+		clock::time_point t1 = clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			_MulNtt(a, b);
+		}
+		clock::time_point t2 = clock::now();
+		if (seconds(t1, t2) < seconds(t0, t1)) {
+			ntt = n;
+			break;
+		}
+	}
+	karatsubaThreshold.store(karatsuba);
+	nttThreshold.store(ntt);
+}
+
+Bint operator*(const Bint &lhs, const Bint &rhs)
+{
+	size_t expectLen = lhs.length + rhs.length;
+	Bint result(expectLen);
+	size_t karatsuba = Bint::karatsubaThreshold.load(std::memory_order_relaxed);
+	if (std::min(lhs.length, rhs.length) > karatsuba) {
+		result._SetMagnitude(Bint::_Mul(lhs._Magnitude(), rhs._Magnitude(), karatsuba, Bint::nttThreshold.load(std::memory_order_relaxed)));
+	} else {
+		Bint::_MulSchool(lhs.data, lhs.length, rhs.data, rhs.length, result.data);
+		result.length = expectLen;
+		result._Trim();
+	}
+	result.isMinus = lhs.isMinus != rhs.isMinus && !result._IsZero();
 	return result;
 }
 
 Bint::~Bint()
 {
-	if (data != nullptr) {
-		delete[] data;
-		data = nullptr;
-	}
+	_Release();
 }
 }
@@ -5,28 +5,76 @@
 #include <iomanip>
 #include <vector>
 #include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+// the float and double product kernels switch to AVX2/FMA at run time where the compiler can emit them;
+// define DIAMOND_MATRIX_NO_AVX2 to keep the scalar kernel, e.g. to compare them
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(DIAMOND_MATRIX_NO_AVX2)
+#define DIAMOND_MATRIX_AVX2 1
+#include <immintrin.h>
+#endif
 
 namespace Diamond {
 
+/**
+ * Base of Matrix and of the lazy expressions built from matrices: a + b, a - b, -a,
+ *   a * x, x * a, a / x and Transpose(a) return nodes that only reference their
+ *   operands. Every such type has RowSize(), ColSize() and At(i, j); a whole chain
+ *   is evaluated element by element in one loop when it is assigned to a Matrix,
+ *   without temporaries. Nodes point into their operands' buffers, so keep results
+ *   in a Matrix rather than in auto variables that outlive the operands.
+ */
+template<typename _Td, typename _Derived>
+class MatrixExpr {
+	// row i of an expression; an element is computed when it is read
+	class ExprRow {
+		_Derived expr;
+		size_t row;
+	public:
+		ExprRow(const _Derived &_expr, const size_t &_row) : expr(_expr), row(_row) {}
+		_Td operator[](const size_t &pos) const
+		{
+			return expr.At(row, pos);
+		}
+	};
+public:
+	const _Derived & Self() const
+	{
+		return static_cast<const _Derived &>(*this);
+	}
+	// (a + b)[i][j] reads one element without evaluating the rest; Matrix hides this
+	// with its own operator[], which returns references
+	ExprRow operator[](const size_t &Kth) const
+	{
+		return ExprRow(Self(), Kth);
+	}
+};
+
 template<typename _Td>
-class Matrix {
+class Matrix : public MatrixExpr<_Td, Matrix<_Td>> {
 protected:
 	size_t n_rows = 0;
 	size_t n_cols = 0;
-	std::vector<std::vector<_Td>> data;
+	// element (i, j) is data[i * stride + j], all rows in one block
+	size_t stride = 0;
+	std::vector<_Td> data;
 	class RowProxy {
-		std::vector<_Td> &row;
+		_Td *row;
 	public:
-		RowProxy(std::vector<_Td> & _row) : row(_row) {}
+		RowProxy(_Td *_row) : row(_row) {}
 		_Td & operator[](const size_t &pos)
 		{
 			return row[pos];
 		}
 	};
 	class ConstRowProxy {
-		const std::vector<_Td> &row;
+		const _Td *row;
 	public:
-		ConstRowProxy(const std::vector<_Td> &_row) : row(_row) {}
+		ConstRowProxy(const _Td *_row) : row(_row) {}
 		const _Td & operator[](const size_t &pos) const
 		{
 			return row[pos];
@@ -35,25 +83,55 @@ protected:
 public:
 	Matrix() {};
 	Matrix(const size_t &_n_rows, const size_t &_n_cols)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols))) {}
+		: n_rows(_n_rows), n_cols(_n_cols), stride(_n_cols), data(_n_rows * _n_cols) {}
 	Matrix(const size_t &_n_rows, const size_t &_n_cols, const _Td &fillValue)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols, fillValue))) {}
+		: n_rows(_n_rows), n_cols(_n_cols), stride(_n_cols), data(_n_rows * _n_cols, fillValue) {}
 	Matrix(const Matrix<_Td> &mat)
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), stride(mat.stride), data(mat.data) {}
+	// takes the buffer over, mat is left an empty 0 x 0 matrix
 	Matrix(Matrix<_Td> &&mat) noexcept
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), stride(mat.stride), data(std::move(mat.data))
+	{
+		mat.n_rows = mat.n_cols = mat.stride = 0;
+		mat.data.clear();
+	}
+	template<typename _E>
+	Matrix(const MatrixExpr<_Td, _E> &e)
+		: n_rows(e.Self().RowSize()), n_cols(e.Self().ColSize()), stride(e.Self().ColSize()), data(n_rows * n_cols)
+	{
+		_Assign(e.Self());
+	}
 	Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
 	{
 		this->n_rows = rhs.n_rows;
 		this->n_cols = rhs.n_cols;
+		this->stride = rhs.stride;
 		this->data = rhs.data;
 		return *this;
 	}
-	Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+	Matrix<_Td> & operator=(Matrix<_Td> &&rhs) noexcept
 	{
+		if (this == &rhs) {
+			return *this;
+		}
 		this->n_rows = rhs.n_rows;
 		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
+		this->stride = rhs.stride;
+		this->data = std::move(rhs.data);
+		rhs.n_rows = rhs.n_cols = rhs.stride = 0;
+		rhs.data.clear();
+		return *this;
+	}
+	template<typename _E>
+	Matrix<_Td> & operator=(const MatrixExpr<_Td, _E> &e)
+	{
+		const _E &expr = e.Self();
+		if (_E::Transposes || n_rows != expr.RowSize() || n_cols != expr.ColSize()) {
+			// a transposed operand may be this matrix, read across what is already written
+			return *this = Matrix<_Td>(expr);
+		}
+		// otherwise element (i, j) only reads (i, j) of the operands, so in place is safe
+		_Assign(expr);
 		return *this;
 	}
 	inline const size_t & RowSize() const
@@ -64,76 +142,259 @@ public:
 	{
 		return n_cols;
 	}
+	// row i of the buffer starts at Data() + i * Stride()
+	inline const size_t & Stride() const
+	{
+		return stride;
+	}
+	_Td * Data()
+	{
+		return data.data();
+	}
+	const _Td * Data() const
+	{
+		return data.data();
+	}
 	RowProxy operator[](const size_t &Kth)
 	{
-		return RowProxy(this->data[Kth]);
+		return RowProxy(this->data.data() + Kth * stride);
 	}
 	const ConstRowProxy operator[](const size_t &Kth) const
 	{
-		return ConstRowProxy(this->data[Kth]);
+		return ConstRowProxy(this->data.data() + Kth * stride);
+	}
+	const _Td & At(const size_t &i, const size_t &j) const
+	{
+		return data[i * stride + j];
 	}
 	~Matrix() = default;
+private:
+	// the fused loop every expression is evaluated by; the inner loop runs along
+	// rows, so it vectorizes when the operands are not transposed
+	template<typename _E>
+	void _Assign(const _E &e)
+	{
+		const _E expr(e);
+		for (size_t i = 0; i < n_rows; ++i) {
+			_Td *row = data.data() + i * stride;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#endif
+			for (size_t j = 0; j < n_cols; ++j) {
+				row[j] = expr.At(i, j);
+			}
+		}
+	}
+};
+
+// the expression nodes behind the elementwise operators
+namespace expr {
+
+// how a node holds an operand: other nodes by value, a Matrix by its buffer
+template<typename _E>
+struct Operand {
+	typedef _E type;
 };
 
-/**
- * Sum of two matrics.
- */
 template<typename _Td>
-Matrix<_Td> operator+(const Matrix<_Td> &a, const Matrix<_Td> &b)
-{
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+class Leaf {
+	const _Td *p;
+	size_t n_rows, n_cols, stride;
+public:
+	static const bool Transposes = false;
+	Leaf(const Matrix<_Td> &m) : p(m.Data()), n_rows(m.RowSize()), n_cols(m.ColSize()), stride(m.Stride()) {}
+	size_t RowSize() const
+	{
+		return n_rows;
 	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] + b[i][j];
-		}
+	size_t ColSize() const
+	{
+		return n_cols;
 	}
-	return c;
-}
+	const _Td & At(const size_t &i, const size_t &j) const
+	{
+		return p[i * stride + j];
+	}
+};
 
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &a, const Matrix<_Td> &b)
-{
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+struct Operand<Matrix<_Td>> {
+	typedef Leaf<_Td> type;
+};
+
+struct Add {
+	template<typename _Td>
+	static _Td Apply(const _Td &a, const _Td &b)
+	{
+		return a + b;
 	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] - b[i][j];
+};
+
+struct Sub {
+	template<typename _Td>
+	static _Td Apply(const _Td &a, const _Td &b)
+	{
+		return a - b;
+	}
+};
+
+struct Mul {
+	template<typename _Td>
+	static _Td Apply(const _Td &a, const _Td &b)
+	{
+		return a * b;
+	}
+};
+
+struct Div {
+	template<typename _Td>
+	static _Td Apply(const _Td &a, const double &b)
+	{
+		return a / b;
+	}
+};
+
+template<typename _Td, typename _L, typename _R, typename _Op>
+class Binary : public MatrixExpr<_Td, Binary<_Td, _L, _R, _Op>> {
+	typename Operand<_L>::type lhs;
+	typename Operand<_R>::type rhs;
+public:
+	static const bool Transposes = Operand<_L>::type::Transposes || Operand<_R>::type::Transposes;
+	Binary(const _L &a, const _R &b) : lhs(a), rhs(b)
+	{
+		if (lhs.RowSize() != rhs.RowSize() || lhs.ColSize() != rhs.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
 		}
 	}
-	return c;
-}
+	size_t RowSize() const
+	{
+		return lhs.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return lhs.ColSize();
+	}
+	_Td At(const size_t &i, const size_t &j) const
+	{
+		return _Op::Apply(lhs.At(i, j), rhs.At(i, j));
+	}
+};
+
+// every element of e combined with the same number x, as e op x
+template<typename _Td, typename _E, typename _Tx, typename _Op>
+class Scalar : public MatrixExpr<_Td, Scalar<_Td, _E, _Tx, _Op>> {
+	typename Operand<_E>::type e;
+	_Tx x;
+public:
+	static const bool Transposes = Operand<_E>::type::Transposes;
+	Scalar(const _E &_e, const _Tx &_x) : e(_e), x(_x) {}
+	size_t RowSize() const
+	{
+		return e.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return e.ColSize();
+	}
+	_Td At(const size_t &i, const size_t &j) const
+	{
+		return _Op::Apply(e.At(i, j), x);
+	}
+};
+
+template<typename _Td, typename _E>
+class Negate : public MatrixExpr<_Td, Negate<_Td, _E>> {
+	typename Operand<_E>::type e;
+public:
+	static const bool Transposes = Operand<_E>::type::Transposes;
+	Negate(const _E &_e) : e(_e) {}
+	size_t RowSize() const
+	{
+		return e.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return e.ColSize();
+	}
+	_Td At(const size_t &i, const size_t &j) const
+	{
+		return -e.At(i, j);
+	}
+};
+
+template<typename _Td, typename _E>
+class Transposed : public MatrixExpr<_Td, Transposed<_Td, _E>> {
+	typename Operand<_E>::type e;
+public:
+	static const bool Transposes = true;
+	Transposed(const _E &_e) : e(_e) {}
+	size_t RowSize() const
+	{
+		return e.ColSize();
+	}
+	size_t ColSize() const
+	{
+		return e.RowSize();
+	}
+	_Td At(const size_t &i, const size_t &j) const
+	{
+		return e.At(j, i);
+	}
+};
+
+// an operand of a matrix product as a Matrix: a Matrix itself, or a node evaluated
 template<typename _Td>
-bool operator==(const Matrix<_Td> &a, const Matrix<_Td> &b)
+const Matrix<_Td> & Evaluate(const Matrix<_Td> &m)
+{
+	return m;
+}
+
+template<typename _Td, typename _E>
+Matrix<_Td> Evaluate(const MatrixExpr<_Td, _E> &e)
+{
+	return Matrix<_Td>(e);
+}
+
+}
+
+/**
+ * Sum of two matrics.
+ */
+template<typename _Td, typename _L, typename _R>
+expr::Binary<_Td, _L, _R, expr::Add> operator+(const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b)
 {
+	return expr::Binary<_Td, _L, _R, expr::Add>(a.Self(), b.Self());
+}
+
+template<typename _Td, typename _L, typename _R>
+expr::Binary<_Td, _L, _R, expr::Sub> operator-(const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b)
+{
+	return expr::Binary<_Td, _L, _R, expr::Sub>(a.Self(), b.Self());
+}
+template<typename _Td, typename _L, typename _R>
+bool operator==(const MatrixExpr<_Td, _L> &_a, const MatrixExpr<_Td, _R> &_b)
+{
+	const _L &a = _a.Self();
+	const _R &b = _b.Self();
 	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
 		return false;
 	}
 	for (size_t i = 0; i < a.RowSize(); ++i) {
 		for (size_t j = 0; j < a.ColSize(); ++j) {
-			if (a[i][j] != b[i][j])
+			if (a.At(i, j) != b.At(i, j))
 				return false;
 		}
 	}
 	return true;
 }
 
-template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &mat)
+template<typename _Td, typename _E>
+expr::Negate<_Td, _E> operator-(const MatrixExpr<_Td, _E> &mat)
 {
-	Matrix<_Td> result(mat.RowSize(), mat.ColSize());
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			result[i][j] = -mat[i][j];
-		}
-	}
-	return result;
+	return expr::Negate<_Td, _E>(mat.Self());
 }
 
+// a temporary matrix is negated in place
 template<typename _Td>
 Matrix<_Td> operator-(Matrix<_Td> &&mat)
 {
@@ -142,83 +403,264 @@ Matrix<_Td> operator-(Matrix<_Td> &&mat)
 			mat[i][j] = -mat[i][j];
 		}
 	}
-	return mat;
+	return std::move(mat);
 }
 
 /**
- * Multiplication of two matrics.
+ * Threads operator* splits a large float or double product over, by blocks of rows;
+ * 0, the default, means one per hardware thread.
  */
+inline size_t & MultiplyThreads()
+{
+	static size_t threads = 0;
+	return threads;
+}
+
+// the blocked product behind operator* for float and double
+namespace gemm {
+
+// a register tile of MR x NR, cache blocks of MC x KC from a and KC x NC from b
+// (the sizes of the BLIS Haswell kernels); Blocked selects this path in operator*
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const Matrix<_Td> &b)
+struct Shape {
+	static constexpr bool Blocked = false;
+};
+template<>
+struct Shape<double> {
+	static constexpr bool Blocked = true;
+	static constexpr size_t MR = 6, NR = 8, MC = 72, KC = 256, NC = 4080;
+};
+template<>
+struct Shape<float> {
+	static constexpr bool Blocked = true;
+	static constexpr size_t MR = 6, NR = 16, MC = 144, KC = 256, NC = 4080;
+};
+
+// tile[MR][NR] = the product of an MR x kc panel of a and a kc x NR panel of b, both packed
+template<typename _Td>
+void KernelScalar(size_t kc, const _Td *a, const _Td *b, _Td *tile)
 {
-	if (a.ColSize() != b.RowSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+	const size_t MR = Shape<_Td>::MR, NR = Shape<_Td>::NR;
+	_Td acc[MR * NR] = {};
+	for (size_t p = 0; p < kc; ++p, a += MR, b += NR) {
+		for (size_t i = 0; i < MR; ++i) {
+			for (size_t j = 0; j < NR; ++j) {
+				acc[i * NR + j] += a[i] * b[j];
+			}
+		}
 	}
-	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < b.ColSize(); ++j) {
-			for (size_t k = 0; k < a.ColSize(); ++k) {
-				c[i][j] += a[i][k] * b[k][j];
+	std::copy(acc, acc + MR * NR, tile);
+}
+
+#ifdef DIAMOND_MATRIX_AVX2
+__attribute__((target("avx2,fma"))) inline __m256d Zero(const double *) { return _mm256_setzero_pd(); }
+__attribute__((target("avx2,fma"))) inline __m256 Zero(const float *) { return _mm256_setzero_ps(); }
+__attribute__((target("avx2,fma"))) inline __m256d Load(const double *p) { return _mm256_loadu_pd(p); }
+__attribute__((target("avx2,fma"))) inline __m256 Load(const float *p) { return _mm256_loadu_ps(p); }
+__attribute__((target("avx2,fma"))) inline __m256d Broadcast(const double *p) { return _mm256_broadcast_sd(p); }
+__attribute__((target("avx2,fma"))) inline __m256 Broadcast(const float *p) { return _mm256_broadcast_ss(p); }
+__attribute__((target("avx2,fma"))) inline __m256d Fma(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+__attribute__((target("avx2,fma"))) inline __m256 Fma(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+__attribute__((target("avx2,fma"))) inline void Store(double *p, __m256d v) { _mm256_storeu_pd(p, v); }
+__attribute__((target("avx2,fma"))) inline void Store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+
+// KernelScalar with the MR x NR accumulators held in MR * NR / 4 (double) or / 8 (float) registers
+template<typename _Td>
+__attribute__((target("avx2,fma")))
+void KernelAvx2(size_t kc, const _Td *a, const _Td *b, _Td *tile)
+{
+	typedef decltype(Load(b)) Reg;
+	const size_t MR = Shape<_Td>::MR, W = sizeof(Reg) / sizeof(_Td), NV = Shape<_Td>::NR / W;
+	Reg acc[MR][NV];
+	for (size_t i = 0; i < MR; ++i) {
+		for (size_t v = 0; v < NV; ++v) {
+			acc[i][v] = Zero(b);
+		}
+	}
+	for (size_t p = 0; p < kc; ++p, a += MR, b += NV * W) {
+		Reg row[NV];
+		for (size_t v = 0; v < NV; ++v) {
+			row[v] = Load(b + v * W);
+		}
+		for (size_t i = 0; i < MR; ++i) {
+			Reg ai = Broadcast(a + i);
+			for (size_t v = 0; v < NV; ++v) {
+				acc[i][v] = Fma(ai, row[v], acc[i][v]);
 			}
 		}
 	}
-	return c;
+	for (size_t i = 0; i < MR; ++i) {
+		for (size_t v = 0; v < NV; ++v) {
+			Store(tile + i * NV * W + v * W, acc[i][v]);
+		}
+	}
 }
+#endif
 
 /**
- * Operations between a number and a matrix;
+ * c[rowBegin, rowEnd) += a[rowBegin, rowEnd) * b, where a is m x k, b is k x n.
+ * For every KC x NC block of b, packed into NR-wide panels, each MC x KC block of a
+ *   is packed into MR-tall panels and multiplied tile by tile; panels past the
+ *   edges are padded with zeros and only the valid part of a tile is added to c.
  */
 template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const _Td &b)
+void MultiplyRows(const Matrix<_Td> &a, const Matrix<_Td> &b, Matrix<_Td> &c, size_t rowBegin, size_t rowEnd,
+                  std::vector<_Td> &packA, std::vector<_Td> &packB)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
+	const size_t MR = Shape<_Td>::MR, NR = Shape<_Td>::NR, MC = Shape<_Td>::MC, KC = Shape<_Td>::KC, NC = Shape<_Td>::NC;
+	const size_t n = b.ColSize(), k = a.ColSize();
+	const _Td *A = a.Data(), *B = b.Data();
+	_Td *C = c.Data();
+	const size_t lda = a.Stride(), ldb = b.Stride(), ldc = c.Stride();
+	void (*kernel)(size_t, const _Td *, const _Td *, _Td *) = KernelScalar<_Td>;
+#ifdef DIAMOND_MATRIX_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (avx2) {
+		kernel = KernelAvx2<_Td>;
+	}
+#endif
+	_Td tile[MR * NR];
+	for (size_t jc = 0; jc < n; jc += NC) {
+		size_t nc = std::min(NC, n - jc);
+		for (size_t pc = 0; pc < k; pc += KC) {
+			size_t kc = std::min(KC, k - pc);
+			for (size_t jr = 0; jr < nc; jr += NR) {
+				_Td *panel = packB.data() + jr * kc;
+				for (size_t p = 0; p < kc; ++p) {
+					for (size_t j = 0; j < NR; ++j) {
+						panel[p * NR + j] = jr + j < nc ? B[(pc + p) * ldb + jc + jr + j] : _Td(0);
+					}
+				}
+			}
+			for (size_t ic = rowBegin; ic < rowEnd; ic += MC) {
+				size_t mc = std::min(MC, rowEnd - ic);
+				for (size_t ir = 0; ir < mc; ir += MR) {
+					_Td *panel = packA.data() + ir * kc;
+					for (size_t p = 0; p < kc; ++p) {
+						for (size_t i = 0; i < MR; ++i) {
+							panel[p * MR + i] = ir + i < mc ? A[(ic + ir + i) * lda + pc + p] : _Td(0);
+						}
+					}
+				}
+				for (size_t jr = 0; jr < nc; jr += NR) {
+					size_t nr = std::min(NR, nc - jr);
+					for (size_t ir = 0; ir < mc; ir += MR) {
+						size_t mr = std::min(MR, mc - ir);
+						kernel(kc, packA.data() + ir * kc, packB.data() + jr * kc, tile);
+						for (size_t i = 0; i < mr; ++i) {
+							_Td *row = C + (ic + ir + i) * ldc + jc + jr;
+							for (size_t j = 0; j < nr; ++j) {
+								row[j] += tile[i * NR + j];
+							}
+						}
+					}
+				}
+			}
 		}
 	}
-	return c;
 }
 
+/**
+ * c += a * b for float and double. Products of at least 2^21 multiply-adds are split
+ *   into row blocks, at least MC rows each, one per thread (see MultiplyThreads).
+ */
 template<typename _Td>
-Matrix<_Td> operator*(const _Td &b, const Matrix<_Td> &a)
+void Multiply(const Matrix<_Td> &a, const Matrix<_Td> &b, Matrix<_Td> &c, std::true_type)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
-		}
+	const size_t MR = Shape<_Td>::MR, NR = Shape<_Td>::NR, MC = Shape<_Td>::MC, KC = Shape<_Td>::KC, NC = Shape<_Td>::NC;
+	const size_t m = a.RowSize(), n = b.ColSize(), k = a.ColSize();
+	if (m == 0 || n == 0 || k == 0) {
+		return;
+	}
+	size_t threads = MultiplyThreads() ? MultiplyThreads() : std::thread::hardware_concurrency();
+	if (static_cast<double>(m) * n * k < static_cast<double>(1 << 21)) {
+		threads = 1;
+	}
+	threads = std::max<size_t>(1, std::min(threads, m / MC));
+
+	// row blocks in whole register tiles
+	size_t perThread = (m + threads - 1) / threads;
+	perThread = (perThread + MR - 1) / MR * MR;
+	size_t packBSize = std::min(KC, k) * (std::min(NC, n) + NR - 1) / NR * NR;
+	std::vector<std::vector<_Td>> packA(threads, std::vector<_Td>(MC * std::min(KC, k)));
+	std::vector<std::vector<_Td>> packB(threads, std::vector<_Td>(packBSize));
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads && t * perThread < m; ++t) {
+		size_t end = std::min(m, (t + 1) * perThread);
+		workers.emplace_back(MultiplyRows<_Td>, std::cref(a), std::cref(b), std::ref(c), t * perThread, end,
+		                     std::ref(packA[t]), std::ref(packB[t]));
+	}
+	MultiplyRows(a, b, c, 0, std::min(m, perThread), packA[0], packB[0]);
+	for (size_t t = 0; t < workers.size(); ++t) {
+		workers[t].join();
 	}
-	return c;
 }
 
+// any other _Td: the plain loop, in i-k-j order so b is read along its rows;
+// every c[i][j] still sums over k in ascending order
 template<typename _Td>
-Matrix<_Td> operator/(const Matrix<_Td> &a, const double &b)
+void Multiply(const Matrix<_Td> &a, const Matrix<_Td> &b, Matrix<_Td> &c, std::false_type)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
 	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] / b;
+		for (size_t k = 0; k < a.ColSize(); ++k) {
+			const _Td &aik = a[i][k];
+			for (size_t j = 0; j < b.ColSize(); ++j) {
+				c[i][j] += aik * b[k][j];
+			}
 		}
 	}
-	return c;
 }
 
-template<typename _Td>
-Matrix<_Td> Transpose(const Matrix<_Td> &a)
+}
+
+/**
+ * Multiplication of two matrics; an operand that is an expression is evaluated first.
+ */
+template<typename _Td, typename _L, typename _R>
+Matrix<_Td> operator*(const MatrixExpr<_Td, _L> &_a, const MatrixExpr<_Td, _R> &_b)
 {
-	Matrix<_Td> res(a.ColSize(), a.RowSize());
-	for (size_t i = 0; i < a.ColSize(); ++i) {
-		for (size_t j = 0; j < a.RowSize(); ++j) {
-			res[i][j] = a[j][i];
-		}
+	const Matrix<_Td> &a = expr::Evaluate(_a.Self());
+	const Matrix<_Td> &b = expr::Evaluate(_b.Self());
+	if (a.ColSize() != b.RowSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
 	}
-	return res;
+	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
+	gemm::Multiply(a, b, c, std::integral_constant<bool, gemm::Shape<_Td>::Blocked>());
+	return c;
 }
 
-template<typename _Td>
-std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
+/**
+ * Operations between a number and a matrix;
+ */
+template<typename _Td, typename _E>
+expr::Scalar<_Td, _E, _Td, expr::Mul> operator*(const MatrixExpr<_Td, _E> &a, const _Td &b)
 {
+	return expr::Scalar<_Td, _E, _Td, expr::Mul>(a.Self(), b);
+}
+
+template<typename _Td, typename _E>
+expr::Scalar<_Td, _E, _Td, expr::Mul> operator*(const _Td &b, const MatrixExpr<_Td, _E> &a)
+{
+	return expr::Scalar<_Td, _E, _Td, expr::Mul>(a.Self(), b);
+}
+
+template<typename _Td, typename _E>
+expr::Scalar<_Td, _E, double, expr::Div> operator/(const MatrixExpr<_Td, _E> &a, const double &b)
+{
+	return expr::Scalar<_Td, _E, double, expr::Div>(a.Self(), b);
+}
+
+// a view; assign it to a Matrix for a transposed copy
+template<typename _Td, typename _E>
+expr::Transposed<_Td, _E> Transpose(const MatrixExpr<_Td, _E> &a)
+{
+	return expr::Transposed<_Td, _E>(a.Self());
+}
+
+template<typename _Td, typename _E>
+std::ostream & operator<<(std::ostream &stream, const MatrixExpr<_Td, _E> &_mat)
+{
+	const _E &mat = _mat.Self();
 	std::ostream::fmtflags oldFlags = stream.flags();
 	stream.precision(8);
 	stream.setf(std::ios::fixed | std::ios::right);
@@ -226,7 +668,7 @@ std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
 	stream << '\n';
 	for (size_t i = 0; i < mat.RowSize(); ++i) {
 		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			stream << std::setw(15) << mat[i][j];
+			stream << std::setw(15) << mat.At(i, j);
 		}
 		stream << '\n';
 	}
@@ -262,5 +704,11 @@ Matrix<_Td> Pow(Matrix<_Td> A, size_t &b)
 	return result;
 }
 
+template<typename _Td, typename _E>
+Matrix<_Td> Pow(const MatrixExpr<_Td, _E> &a, size_t &b)
+{
+	return Pow(Matrix<_Td>(a), b);
+}
+
 }
 #endif
@@ -0,0 +1,96 @@
+#include "map.hpp"
+#include "huge_page_arena.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+// maps over huge_page_allocator against a std::map through inserts, erases,
+// copies, clear and erase_if (whose nodes go back through Node::operator delete);
+// every byte handed out must come back, and only the arena's own regions are
+// ever advised
+
+typedef sjtu::map<int, std::string, std::less<int>, sjtu::huge_page_allocator> Map;
+typedef std::map<int, std::string> Ref;
+
+// nodes bigger than MAX_BLOCK, which the arena passes on to global new
+struct big {
+	char bytes[2 * sjtu::huge_page_arena::MAX_BLOCK];
+	big() { bytes[0] = 0; }
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+bool same(const Map &m, const Ref &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::const_iterator it = m.cbegin();
+	for (Ref::const_iterator j = ref.begin(); j != ref.end(); ++j, ++it) {
+		if (it->first != j->first || it->second != j->second) return false;
+	}
+	return it == m.cend();
+}
+
+struct odd {
+	bool operator()(const Map::value_type &element) const {
+		return element.first % 2 != 0;
+	}
+};
+
+int main() {
+	sjtu::huge_page_arena &arena = sjtu::huge_page_arena::instance();
+	check(arena.used_bytes() == 0, "nothing used before the first map");
+	std::mt19937 rng(87);
+	{
+		Map m;
+		Ref ref;
+		for (int op = 0; op < 200000; ++op) {
+			int key = rng() % 50000;
+			if (rng() % 3 != 0) {
+				std::string value = std::to_string(op);
+				m.insert(Map::value_type(key, value));
+				ref.insert(Ref::value_type(key, value));
+			} else {
+				Map::iterator it = m.find(key);
+				if (it != m.end()) m.erase(it);
+				ref.erase(key);
+			}
+		}
+		check(same(m, ref), "after inserts and erases");
+		check(arena.used_bytes() >= m.size() * sizeof(Map::value_type), "nodes are counted");
+		size_t used = arena.used_bytes();
+
+		Map copy(m);
+		check(same(copy, ref) && arena.used_bytes() == 2 * used, "copy");
+		Map assigned;
+		assigned[-1] = "gone";
+		assigned = copy;
+		check(same(assigned, ref) && arena.used_bytes() == 3 * used, "assignment");
+
+		Ref kept;
+		for (Ref::iterator j = ref.begin(); j != ref.end(); ++j) {
+			if (j->first % 2 == 0) kept.insert(*j);
+		}
+		check(copy.erase_if(odd()) == ref.size() - kept.size() && same(copy, kept), "erase_if");
+		assigned.clear();
+		check(assigned.empty(), "clear");
+		check(arena.used_bytes() < 2 * used, "erase_if and clear return nodes");
+	}
+	check(arena.used_bytes() == 0, "every node returned");
+	{
+		sjtu::map<int, big, std::less<int>, sjtu::huge_page_allocator> large;
+		for (int i = 0; i < 100; ++i) large[i] = big();
+		check(arena.used_bytes() == 0, "big nodes bypass the arena");
+	}
+	check(arena.reserved_bytes() > 0 && arena.reserved_bytes() % sjtu::huge_page_arena::REGION_SIZE == 0, "reserved regions");
+	check(arena.reserved_bytes() >= arena.advised_bytes(), "advised within reserved");
+	check(arena.huge_page_bytes() <= arena.reserved_bytes(), "huge pages within reserved");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include "interned_string.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// interned_string keys against std::string keys, a pool shared by threads, and
+// default handles made on several threads
+
+std::string word(unsigned x) {
+	std::string s;
+	do {
+		s += char('a' + x % 7);
+		x /= 7;
+	} while (x);
+	return s;
+}
+
+int main() {
+	sjtu::string_pool pool;
+	sjtu::map<sjtu::interned_string, int> m;
+	std::map<std::string, int> ref;
+	unsigned seed = 1;
+	for (int i = 0; i < 20000; ++i) {
+		seed = seed * 1103515245u + 12345u;
+		std::string w = word((seed >> 8) % 500);
+		sjtu::interned_string key = pool.intern(w);
+		if (seed & 1) {
+			m[key] += i;
+			ref[w] += i;
+		} else {
+			sjtu::map<sjtu::interned_string, int>::iterator it = m.find(key);
+			if (it != m.end()) {
+				m.erase(it);
+			}
+			ref.erase(w);
+		}
+	}
+	bool same = m.size() == ref.size();
+	std::map<std::string, int>::iterator r = ref.begin();
+	for (sjtu::map<sjtu::interned_string, int>::const_iterator it = m.cbegin(); same && it != m.cend(); ++it, ++r) {
+		same = it->first.str() == r->first && it->second == r->second;
+	}
+	std::cout << "order " << (same ? "ok" : "WRONG") << ' ' << m.size() << std::endl;
+
+	// lookups of absent strings do not grow the pool
+	size_t before = pool.size();
+	sjtu::interned_string handle = pool.intern("a");
+	bool found = pool.find("zzzzzzzz", handle);
+	std::cout << "absent " << found << ' ' << pool.contains("zzzzzzzz") << ' ' << (pool.size() == before) << ' '
+	          << handle.str() << std::endl;
+	found = pool.find(word(42), handle);
+	std::cout << "present " << found << ' ' << (handle == pool.intern(word(42))) << std::endl;
+
+	// threads interning overlapping vocabularies get one entry, one id, per string
+	sjtu::string_pool shared;
+	std::vector<std::thread> threads;
+	std::vector<std::vector<unsigned> > ids(4, std::vector<unsigned>(2000));
+	for (int t = 0; t < 4; ++t) {
+		threads.push_back(std::thread([&shared, &ids, t]() {
+			for (unsigned i = 0; i < 2000; ++i) {
+				ids[t][i] = shared.intern(word((i * (t + 1)) % 1000)).id();
+				shared.contains(word(i));
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); ++t) {
+		threads[t].join();
+	}
+	bool consistent = shared.size() == 1000;
+	for (int t = 0; t < 4; ++t) {
+		for (unsigned i = 0; i < 2000; ++i) {
+			sjtu::interned_string h = shared.intern(word(0));
+			consistent = consistent && shared.find(word((i * (t + 1)) % 1000), h) && h.id() == ids[t][i];
+		}
+	}
+	std::cout << "threads " << (consistent ? "ok" : "WRONG") << ' ' << shared.size() << std::endl;
+
+	// default handles, made on many threads, all share the one "" of the global pool
+	std::vector<std::vector<sjtu::interned_string> > empties(4);
+	threads.clear();
+	for (int t = 0; t < 4; ++t) {
+		threads.push_back(std::thread([&empties, t]() {
+			empties[t].resize(5000);
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); ++t) {
+		threads[t].join();
+	}
+	sjtu::interned_string empty = sjtu::string_pool::global().intern("");
+	size_t poolSize = sjtu::string_pool::global().size();
+	bool sharedEmpty = true;
+	for (int t = 0; t < 4; ++t) {
+		for (size_t i = 0; i < empties[t].size(); ++i) {
+			sharedEmpty = sharedEmpty && same_key(empties[t][i], empty) && empties[t][i].str().empty();
+		}
+	}
+	sjtu::interned_string later;
+	std::cout << "default " << (sharedEmpty && same_key(later, empty) && later.id() == empty.id() ? "ok" : "WRONG") << ' '
+	          << (sjtu::string_pool::global().size() == poolSize) << std::endl;
+	return 0;
+}
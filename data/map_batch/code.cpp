@@ -0,0 +1,212 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+// apply_batch against a std::map taking the same ops one by one: random batches
+// with many ops per key, both overloads, the result and value fields, on_found
+// seeing each find's own turn, and the applied flags after a copy of T throws
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+// a mapped type whose copies throw once a shared countdown runs out
+int copies_left = -1;
+
+struct fragile {
+	int value;
+
+	fragile(int v = 0) : value(v) {}
+
+	fragile(const fragile &other) : value(other.value) {
+		countdown();
+	}
+
+	fragile &operator=(const fragile &other) {
+		countdown();
+		value = other.value;
+		return *this;
+	}
+
+	static void countdown() {
+		if (copies_left == 0) throw 0;
+		if (copies_left > 0) --copies_left;
+	}
+};
+
+typedef sjtu::map<int, fragile> Map;
+typedef Map::batch_op Op;
+typedef std::map<int, int> Ref;
+
+// the ops applied one at a time, in key order and in their own order within a key
+void reference(Ref &ref, std::vector<Op> &ops, std::vector<int> &want, std::vector<bool> &wantResult, bool onlyApplied) {
+	std::vector<size_t> order;
+	for (size_t i = 0; i < ops.size(); ++i) order.push_back(i);
+	for (size_t i = 1; i < order.size(); ++i) {
+		for (size_t j = i; j > 0 && ops[order[j]].key < ops[order[j - 1]].key; --j) std::swap(order[j], order[j - 1]);
+	}
+	want.assign(ops.size(), -1);
+	wantResult.assign(ops.size(), false);
+	for (size_t k = 0; k < order.size(); ++k) {
+		size_t i = order[k];
+		Op &op = ops[i];
+		if (onlyApplied && !op.applied) continue;
+		Ref::iterator it = ref.find(op.key);
+		wantResult[i] = op.kind == Map::batch_find || op.kind == Map::batch_erase ? it != ref.end() : it == ref.end();
+		if (op.kind == Map::batch_find) {
+			if (it != ref.end()) want[i] = it->second;
+		} else if (op.kind == Map::batch_erase) {
+			if (it != ref.end()) ref.erase(it);
+		} else if (op.kind == Map::batch_assign || it == ref.end()) {
+			ref[op.key] = op.value->value;
+		}
+	}
+}
+
+bool same(const Map &m, const Ref &ref) {
+	if (m.size() != ref.size()) return false;
+	Map::const_iterator it = m.cbegin();
+	for (Ref::const_iterator j = ref.begin(); j != ref.end(); ++j, ++it) {
+		if (it->first != j->first || it->second.value != j->second) return false;
+	}
+	return it == m.cend();
+}
+
+void record(Op &op, const fragile &value) {
+	// result is already set when on_found runs; value is stashed in the key's place
+	op.key = op.result ? value.value : -1;
+}
+
+int main() {
+	{
+		// one key through every kind of op in a single batch, listed out of key order
+		Map m;
+		fragile one(1), two(2), three(3);
+		std::vector<Op> ops;
+		ops.push_back(Op(Map::batch_find, 5));
+		ops.push_back(Op(Map::batch_insert, 5, &one));
+		ops.push_back(Op(Map::batch_assign, 9, &three));
+		ops.push_back(Op(Map::batch_insert, 5, &two));
+		ops.push_back(Op(Map::batch_find, 5));
+		ops.push_back(Op(Map::batch_assign, 5, &two));
+		ops.push_back(Op(Map::batch_find, 5));
+		ops.push_back(Op(Map::batch_erase, 5));
+		ops.push_back(Op(Map::batch_find, 5));
+		ops.push_back(Op(Map::batch_erase, 5));
+		ops.push_back(Op(Map::batch_assign, 5, &three));
+		ops.push_back(Op(Map::batch_erase, 1));
+		m.apply_batch(ops.data(), ops.size());
+		bool results[] = {false, true, true, false, true, false, true, true, false, false, true, false};
+		bool good = true;
+		for (size_t i = 0; i < ops.size(); ++i) good = good && ops[i].result == results[i] && ops[i].applied;
+		check(good, "results of one key's ops");
+		check(ops[0].value == nullptr && ops[8].value == nullptr, "find of an absent key");
+		check(ops[1].value == &one && ops[11].value == nullptr, "value of other ops untouched");
+		check(m.size() == 2 && m.at(5).value == 3 && m.at(9).value == 3, "state after the batch");
+	}
+	{
+		// on_found sees each find's own turn even when a later op overwrites or erases
+		Map m;
+		m[1] = fragile(10);
+		m[2] = fragile(20);
+		fragile eleven(11);
+		std::vector<Op> ops;
+		ops.push_back(Op(Map::batch_find, 1));
+		ops.push_back(Op(Map::batch_assign, 1, &eleven));
+		ops.push_back(Op(Map::batch_find, 1));
+		ops.push_back(Op(Map::batch_find, 2));
+		ops.push_back(Op(Map::batch_erase, 2));
+		ops.push_back(Op(Map::batch_find, 2));
+		ops.push_back(Op(Map::batch_find, 3));
+		for (size_t i = 0; i < ops.size(); ++i) {
+			if (ops[i].kind == Map::batch_find) ops[i].on_found = record;
+		}
+		// the scattered overload, handed the keys back to front but each key's ops in order
+		std::vector<Op *> scattered;
+		size_t handed[] = {6, 3, 4, 5, 0, 1, 2};
+		for (size_t i = 0; i < ops.size(); ++i) scattered.push_back(&ops[handed[i]]);
+		m.apply_batch(scattered.data(), scattered.size());
+		check(ops[0].key == 10 && ops[2].key == 11 && ops[3].key == 20, "on_found values");
+		check(!ops[5].result && ops[5].key == 2 && !ops[6].result && ops[6].key == 3, "on_found not called when absent");
+		check(ops[2].value == &m.at(1), "find value points into the map");
+		check(m.size() == 1 && m.at(1).value == 11, "state after on_found batch");
+	}
+
+	std::mt19937 rng(77);
+	Map m;
+	Ref ref;
+	std::vector<fragile> values;
+	for (int i = 0; i < 1000; ++i) values.push_back(fragile(i));
+	for (int round = 0; round < 300; ++round) {
+		std::vector<Op> ops;
+		size_t n = round % 10 == 0 ? 3000 : rng() % 50;
+		int range = round % 3 == 0 ? 40 : 5000;
+		for (size_t i = 0; i < n; ++i) {
+			Map::batch_kind kind = static_cast<Map::batch_kind>(rng() % 4);
+			int key = rng() % range;
+			ops.push_back(Op(kind, key, &values[rng() % values.size()]));
+		}
+		std::vector<int> want;
+		std::vector<bool> wantResult;
+		reference(ref, ops, want, wantResult, false);
+		if (round % 2) {
+			m.apply_batch(ops.data(), ops.size());
+		} else {
+			std::vector<Op *> scattered;
+			for (size_t i = 0; i < ops.size(); ++i) scattered.push_back(&ops[i]);
+			m.apply_batch(scattered.data(), scattered.size());
+		}
+		bool good = true;
+		for (size_t i = 0; i < ops.size(); ++i) {
+			good = good && ops[i].applied && ops[i].result == wantResult[i];
+			if (ops[i].kind == Map::batch_find) good = good && (ops[i].value == nullptr) == (want[i] < 0);
+		}
+		check(good, "random batch results");
+		check(same(m, ref), "random batch state");
+	}
+
+	// a copy of T throws part way through: exactly the applied ops took effect
+	int throws = 0;
+	for (int round = 0; round < 200; ++round) {
+		std::vector<Op> ops;
+		for (int i = 0; i < 60; ++i) {
+			Map::batch_kind kind = static_cast<Map::batch_kind>(rng() % 3);
+			int key = rng() % 100;
+			ops.push_back(Op(kind, key, &values[rng() % values.size()]));
+		}
+		Ref before = ref;
+		copies_left = rng() % 40;
+		try {
+			m.apply_batch(ops.data(), ops.size());
+		} catch (int) {
+			++throws;
+		}
+		copies_left = -1;
+		std::vector<int> want;
+		std::vector<bool> wantResult;
+		reference(before, ops, want, wantResult, true);
+		bool good = true;
+		for (size_t i = 0; i < ops.size(); ++i) good = good && (!ops[i].applied || ops[i].result == wantResult[i]);
+		check(good, "results of applied ops");
+		check(same(m, before), "state after a throw");
+		ref = before;
+		// the unapplied ops can simply be run again
+		std::vector<Op> rest;
+		for (size_t i = 0; i < ops.size(); ++i) {
+			if (!ops[i].applied) rest.push_back(ops[i]);
+		}
+		reference(ref, rest, want, wantResult, false);
+		m.apply_batch(rest.data(), rest.size());
+		check(same(m, ref), "state after the retry");
+	}
+	check(throws > 0, "copies threw");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
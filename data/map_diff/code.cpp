@@ -0,0 +1,133 @@
+#include "map.hpp"
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+// diff against the same report worked out from two std::maps: random pairs of
+// versions with keys added, removed and changed, one or both maps empty, a map
+// against itself and against its copy, and a descending order
+
+struct event {
+	char kind;   // '+', '-' or '~'
+	int key, before, after;
+
+	bool operator==(const event &other) const {
+		return kind == other.kind && key == other.key && before == other.before && after == other.after;
+	}
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+template<class Compare>
+std::vector<event> report(const sjtu::map<int, int, Compare> &a, const sjtu::map<int, int, Compare> &b) {
+	typedef typename sjtu::map<int, int, Compare>::value_type value_type;
+	std::vector<event> events;
+	sjtu::diff(a, b,
+	           [&events](const value_type &e) { events.push_back(event{'+', e.first, 0, e.second}); },
+	           [&events](const value_type &e) { events.push_back(event{'-', e.first, e.second, 0}); },
+	           [&events](const value_type &x, const value_type &y) { events.push_back(event{'~', x.first, x.second, y.second}); });
+	return events;
+}
+
+template<class Compare>
+std::vector<event> expected(const std::map<int, int, Compare> &a, const std::map<int, int, Compare> &b) {
+	std::map<int, event, Compare> merged;
+	for (typename std::map<int, int, Compare>::const_iterator i = a.begin(); i != a.end(); ++i) {
+		merged[i->first] = event{'-', i->first, i->second, 0};
+	}
+	for (typename std::map<int, int, Compare>::const_iterator j = b.begin(); j != b.end(); ++j) {
+		typename std::map<int, event, Compare>::iterator m = merged.find(j->first);
+		if (m == merged.end()) {
+			merged[j->first] = event{'+', j->first, 0, j->second};
+		} else if (m->second.before != j->second) {
+			m->second = event{'~', j->first, m->second.before, j->second};
+		} else {
+			merged.erase(m);
+		}
+	}
+	std::vector<event> events;
+	for (typename std::map<int, event, Compare>::const_iterator m = merged.begin(); m != merged.end(); ++m) {
+		events.push_back(m->second);
+	}
+	return events;
+}
+
+template<class Compare>
+void fill(sjtu::map<int, int, Compare> &m, std::map<int, int, Compare> &ref, int key, int value) {
+	m[key] = value;
+	ref[key] = value;
+}
+
+int main() {
+	std::mt19937 rng(76);
+	size_t added = 0, removed = 0, changed = 0;
+	for (int round = 0; round < 300; ++round) {
+		sjtu::map<int, int> a, b;
+		std::map<int, int> refA, refB;
+		int n = round % 5 == 0 ? rng() % 10 : 2000;
+		int range = round % 3 == 0 ? 3 * n + 1 : 100000;
+		for (int i = 0; i < n; ++i) {
+			int key = rng() % range;
+			fill(a, refA, key, key % 7);
+		}
+		// b starts as a copy of a, then drifts
+		b = a;
+		refB = refA;
+		for (int i = 0; i < n / 2; ++i) {
+			int kind = rng() % 3, key = rng() % range;
+			if (kind == 0) {
+				fill(b, refB, key, key % 7);
+			} else if (kind == 1) {
+				fill(b, refB, key, key % 7 + 1);
+			} else {
+				sjtu::map<int, int>::iterator it = b.find(key);
+				if (it != b.end()) b.erase(it);
+				refB.erase(key);
+			}
+		}
+		std::vector<event> got = report(a, b), want = expected(refA, refB);
+		check(got == want, "a against b");
+		check(report(b, a) == expected(refB, refA), "b against a");
+		for (size_t i = 0; i < want.size(); ++i) {
+			added += want[i].kind == '+';
+			removed += want[i].kind == '-';
+			changed += want[i].kind == '~';
+		}
+	}
+	check(added > 0 && removed > 0 && changed > 0, "every kind reported");
+
+	sjtu::map<int, int> empty, full;
+	std::map<int, int> refEmpty, refFull;
+	for (int i = 0; i < 500; ++i) fill(full, refFull, int(rng() % 10000), i);
+	check(report(empty, empty).empty(), "both empty");
+	check(report(empty, full) == expected(refEmpty, refFull) && report(empty, full).size() == full.size(), "from empty");
+	check(report(full, empty) == expected(refFull, refEmpty) && report(full, empty).size() == full.size(), "to empty");
+	check(report(full, full).empty(), "a map against itself");
+	sjtu::map<int, int> copy(full);
+	check(report(full, copy).empty() && report(copy, full).empty(), "a map against its copy");
+	copy[-1] = 0;
+	copy.erase(copy.find(-1));
+	check(report(full, copy).empty(), "a copy changed back");
+
+	// keys are reported in the map's own order
+	sjtu::map<int, int, std::greater<int> > down, up;
+	std::map<int, int, std::greater<int> > refDown, refUp;
+	for (int i = 0; i < 1000; ++i) {
+		int key = rng() % 1500;
+		fill(down, refDown, key, 0);
+		key = rng() % 1500;
+		fill(up, refUp, key, int(rng() % 2));
+	}
+	check(report(down, up) == expected(refDown, refUp), "descending order");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
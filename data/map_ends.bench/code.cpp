@@ -0,0 +1,54 @@
+#include "map.hpp"
+#include <chrono>
+#include <iostream>
+
+// take_smallest of half a million keys against erasing them one by one, and
+// draining a map with pop_front against erase(begin()); timings go to stderr,
+// the checks to stdout
+
+typedef sjtu::map<int, int> Map;
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void fill(Map &m, int n) {
+	for (int i = 0; i < n; ++i) m.insert(Map::value_type(i, i));
+}
+
+int main() {
+	const int N = 1000000;
+	Map m, other;
+	fill(m, N);
+	fill(other, N);
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	Map half = m.take_smallest(N / 2);
+	double takeTime = since(t0);
+	t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < N / 2; ++i) other.erase(other.begin());
+	double eraseTime = since(t0);
+	std::cerr << "take_smallest(" << N / 2 << ") " << takeTime << " us, " << N / 2 << " x erase(begin()) "
+	          << eraseTime << " us" << std::endl;
+	std::cout << "take_smallest " << (half.size() == size_t(N / 2) && half.back().first == N / 2 - 1 &&
+	                                  m.front().first == N / 2 && m.size() == other.size() ? "splits" : "WRONG")
+	          << std::endl;
+
+	t0 = std::chrono::steady_clock::now();
+	long long popped = 0;
+	while (!m.empty()) {
+		popped += m.front().second;
+		m.pop_front();
+	}
+	double popTime = since(t0) * 1000 / (N / 2);
+	t0 = std::chrono::steady_clock::now();
+	long long erased = 0;
+	while (!other.empty()) {
+		erased += other.begin()->second;
+		other.erase(other.begin());
+	}
+	double drainTime = since(t0) * 1000 / (N / 2);
+	std::cerr << "pop_front " << popTime << " ns, erase(begin()) " << drainTime << " ns each" << std::endl;
+	std::cout << "drains " << (popped == erased ? "agree" : "WRONG") << std::endl;
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include "map.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+
+// front, back, pop_front, pop_back, take_smallest and take_largest on a weighted
+// map against a std::map, checking both maps of a take through their whole
+// interface: ends, both directions of iteration, ranks and weight sums; then
+// moves, which hand the nodes over
+
+typedef sjtu::map<int, long long, std::less<int>, sjtu::node_allocator, sjtu::mapped_value_weight<long long> > Map;
+typedef std::map<int, long long> Ref;
+
+int failures = 0;
+
+void check(bool ok, const char *what, int round, int op) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << " in round " << round << " at " << op << std::endl;
+		++failures;
+	}
+}
+
+bool same(const Map &m, const Ref &ref) {
+	if (m.size() != ref.size() || m.empty() != ref.empty()) return false;
+	long long weight = 0;
+	Ref::const_iterator it = ref.begin();
+	for (Map::const_iterator j = m.cbegin(); j != m.cend(); ++j, ++it) {
+		if (j->first != it->first || j->second != it->second) return false;
+		weight += it->second;
+	}
+	if (m.total_weight() != weight) return false;
+	if (ref.empty()) return m.cbegin() == m.cend();
+	Map::const_iterator last = m.cend();
+	--last;
+	return m.front().first == ref.begin()->first && m.back().first == ref.rbegin()->first &&
+	       last->first == ref.rbegin()->first && m.at_index(ref.size() / 2).first == std::next(ref.begin(), ref.size() / 2)->first;
+}
+
+int main() {
+	std::mt19937 rng(99);
+	size_t taken = 0;
+	for (int round = 0; round < 300; ++round) {
+		Map m;
+		Ref ref;
+		for (int op = 0; op < 400; ++op) {
+			int kind = rng() % 12, key = rng() % 300;
+			if (kind < 5) {
+				long long v = rng() % 100;
+				if (m.insert(Map::value_type(key, v)).second) ref[key] = v;
+			} else if (kind < 7) {
+				Map::iterator it = m.find(key);
+				if (it != m.end()) m.erase(it);
+				ref.erase(key);
+			} else if (kind == 7 || kind == 8) {
+				bool front = kind == 7;
+				if (ref.empty()) {
+					try {
+						front ? m.pop_front() : m.pop_back();
+						check(false, "pop of empty", round, op);
+					} catch (sjtu::container_is_empty &) {}
+					try {
+						front ? m.front() : m.back();
+						check(false, "end of empty", round, op);
+					} catch (sjtu::container_is_empty &) {}
+				} else {
+					front ? m.pop_front() : m.pop_back();
+					ref.erase(front ? ref.begin() : std::prev(ref.end()));
+				}
+			} else if (kind == 9 || kind == 10) {
+				bool smallest = kind == 9;
+				size_t k = rng() % (ref.size() + 3);
+				Map part = smallest ? m.take_smallest(k) : m.take_largest(k);
+				Ref refPart;
+				for (size_t i = std::min(k, ref.size()); i > 0; --i) {
+					Ref::iterator it = smallest ? ref.begin() : std::prev(ref.end());
+					refPart.insert(*it);
+					ref.erase(it);
+				}
+				check(same(part, refPart), "taken part", round, op);
+				taken += part.size();
+				// put it back half the time
+				if (rng() % 2) {
+					for (Map::const_iterator it = part.cbegin(); it != part.cend(); ++it) {
+						if (m.insert(*it).second) ref[it->first] = it->second;
+					}
+				}
+			} else {
+				Map copy(m);
+				check(same(copy, ref), "copy", round, op);
+				m = copy;
+			}
+			check(same(m, ref), "map", round, op);
+		}
+	}
+	std::cout << taken << " elements taken" << std::endl;
+
+	// moves hand the nodes over and leave an empty map that can be used again
+	Map a;
+	Ref ref;
+	for (int i = 0; i < 1000; ++i) {
+		a.insert(Map::value_type(i * 3, i % 50));
+		ref[i * 3] = i % 50;
+	}
+	const Map::value_type *first = &a.front(), *last = &a.back();
+	Map b(std::move(a));
+	check(same(a, Ref()) && same(b, ref) && &b.front() == first && &b.back() == last, "move constructor", 0, 0);
+	a.insert(Map::value_type(1, 7));
+	Ref one;
+	one[1] = 7;
+	check(same(a, one), "moved-from map reused", 0, 0);
+	a = std::move(b);
+	check(same(b, Ref()) && same(a, ref) && &a.front() == first, "move assignment", 0, 0);
+	Map &alias = a;
+	a = std::move(alias);
+	check(same(a, ref), "move assignment to itself", 0, 0);
+	// the taken part is moved out, not copied: its nodes are the ones it had in the map
+	Map smallest(a.take_smallest(10));
+	Map largest;
+	largest = a.take_largest(10);
+	check(&smallest.front() == first && &largest.back() == last && smallest.size() == 10 && largest.size() == 10 &&
+	      a.size() == 980, "take moves its result out", 0, 0);
+
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
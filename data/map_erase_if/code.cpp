@@ -0,0 +1,186 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+// erase_if and retain against a std::map, with removal shares on both sides of the
+// point where erase_if stops erasing node by node and rebuilds the tree from the
+// survivors, iterators to survivors kept across the call, and predicates that throw
+// part way through the walk
+
+typedef sjtu::map<int, int> Map;
+typedef std::map<int, int> Ref;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+// iteration both ways, the cached ends and the subtree sizes all agree with ref
+bool same(Map &m, const Ref &ref) {
+	if (m.size() != ref.size() || m.empty() != ref.empty()) return false;
+	Map::iterator it = m.begin();
+	size_t i = 0;
+	for (Ref::const_iterator j = ref.begin(); j != ref.end(); ++j, ++it, ++i) {
+		if (it == m.end() || it->first != j->first || it->second != j->second) return false;
+		if (m.at_index(i).first != j->first || m.index_of(j->first) != i) return false;
+	}
+	if (it != m.end()) return false;
+	for (Ref::const_reverse_iterator j = ref.rbegin(); j != ref.rend(); ++j) {
+		--it;
+		if (it->first != j->first) return false;
+	}
+	return it == m.begin();
+}
+
+// removes the keys of a random share, decided up front; may throw at the visit numbered throwAt
+struct doomed {
+	const std::vector<bool> *remove;
+	std::vector<int> *visited;
+	int throwAt;
+
+	bool operator()(const Map::value_type &element) const {
+		if (int(visited->size()) == throwAt) throw 0;
+		visited->push_back(element.first);
+		return (*remove)[element.first];
+	}
+};
+
+int main() {
+	std::mt19937 rng(78);
+	const int KEYS = 4000;
+	int rebuilt = 0, stepped = 0;
+	for (int round = 0; round < 400; ++round) {
+		int n = round % 4 == 0 ? rng() % 200 : KEYS;
+		// removal shares from none to all; the rebuild starts after removed > 2 * kept + 64
+		unsigned share = rng() % 101;
+		Map m;
+		Ref ref;
+		std::vector<bool> remove(KEYS, false);
+		for (int i = 0; i < n; ++i) {
+			int key = rng() % KEYS;
+			m[key] = i;
+			ref[key] = i;
+		}
+		for (int k = 0; k < KEYS; ++k) remove[k] = rng() % 100 < share;
+
+		// remember an iterator to every survivor
+		std::vector<Map::iterator> survivors;
+		std::vector<int> survivorKeys;
+		size_t removedRef = 0;
+		for (Map::iterator it = m.begin(); it != m.end(); ++it) {
+			if (remove[it->first]) {
+				++removedRef;
+			} else {
+				survivors.push_back(it);
+				survivorKeys.push_back(it->first);
+			}
+		}
+		// whether the walk reaches the rebuild, in the same order erase_if counts
+		size_t removedSoFar = 0, keptSoFar = 0;
+		bool rebuilds = false;
+		for (Ref::iterator j = ref.begin(); j != ref.end() && !rebuilds; ++j) {
+			if (remove[j->first]) ++removedSoFar;
+			else ++keptSoFar;
+			rebuilds = removedSoFar > 2 * keptSoFar + 64;
+		}
+		rebuilt += rebuilds;
+		stepped += !rebuilds && removedRef > 0;
+
+		std::vector<int> visited;
+		doomed pred = {&remove, &visited, -1};
+		size_t removed;
+		if (round % 2) {
+			removed = m.erase_if(pred);
+		} else {
+			std::vector<bool> keep(KEYS);
+			for (int k = 0; k < KEYS; ++k) keep[k] = !remove[k];
+			doomed kept = {&keep, &visited, -1};
+			removed = m.retain(kept);
+		}
+		for (Ref::iterator j = ref.begin(); j != ref.end();) {
+			if (remove[j->first]) ref.erase(j++);
+			else ++j;
+		}
+		check(removed == removedRef, "removed count");
+		check(visited.size() == removedRef + survivors.size(), "every element visited once");
+		check(same(m, ref), "survivors");
+		bool valid = true;
+		for (size_t i = 0; i < survivors.size(); ++i) {
+			valid = valid && survivors[i]->first == survivorKeys[i];
+			Map::iterator next = survivors[i];
+			++next;
+			valid = valid && (i + 1 < survivors.size() ? next == survivors[i + 1] : next == m.end());
+		}
+		check(valid, "iterators to survivors");
+		survivors.clear();
+		// the tree keeps working afterwards
+		for (int i = 0; i < 300; ++i) {
+			int key = rng() % KEYS;
+			m[key] = -i;
+			ref[key] = -i;
+			key = rng() % KEYS;
+			Map::iterator it = m.find(key);
+			if (it != m.end()) m.erase(it);
+			ref.erase(key);
+		}
+		check(same(m, ref), "operations after erase_if");
+	}
+	check(rebuilt > 50 && stepped > 50, "both sides of the rebuild");
+
+	// a predicate throwing at every point of the walk, before and after the rebuild starts
+	int thrown = 0;
+	for (int round = 0; round < 300; ++round) {
+		unsigned share = round % 3 == 0 ? 30 : 95;
+		Map m;
+		Ref ref;
+		std::vector<bool> remove(KEYS, false);
+		for (int k = 0; k < 1000; ++k) {
+			int key = rng() % KEYS;
+			m[key] = k;
+			ref[key] = k;
+		}
+		for (int k = 0; k < KEYS; ++k) remove[k] = rng() % 100 < share;
+		std::vector<Map::iterator> before;
+		for (Map::iterator it = m.begin(); it != m.end(); ++it) before.push_back(it);
+		std::vector<int> visited;
+		doomed pred = {&remove, &visited, int(rng() % ref.size())};
+		try {
+			m.erase_if(pred);
+		} catch (int) {
+			++thrown;
+		}
+		// visited elements are gone or kept as decided; every unvisited one is still there
+		for (size_t i = 0; i < visited.size(); ++i) {
+			if (remove[visited[i]]) ref.erase(visited[i]);
+		}
+		check(same(m, ref), "tree after a throwing predicate");
+		// and keeps its node, so iterators to it stay valid
+		bool valid = true;
+		for (size_t i = 0; i < before.size(); ++i) {
+			// the walk is in key order, so the first visited.size() elements are the visited ones
+			if (i < visited.size() && remove[visited[i]]) continue;
+			valid = valid && m.find(before[i]->first) == before[i];
+		}
+		check(valid, "iterators to survivors after a throw");
+		for (int i = 0; i < 300; ++i) {
+			int key = rng() % KEYS;
+			m[key] = i;
+			ref[key] = i;
+			Map::iterator it = m.find(rng() % KEYS);
+			if (it != m.end()) {
+				ref.erase(it->first);
+				m.erase(it);
+			}
+		}
+		check(same(m, ref), "operations after a throw");
+	}
+	check(thrown == 300, "every predicate threw");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
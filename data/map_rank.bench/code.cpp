@@ -0,0 +1,44 @@
+#include "map.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// paging through a million keys: jumping to a page with begin() + k against
+// walking to it with ++; timings go to stderr, the checks to stdout
+
+typedef sjtu::map<int, int> Map;
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+	srand(97);
+	const int N = 1000000, PAGE = 50;
+	Map m;
+	for (int i = 0; i < N; ++i) m.insert(Map::value_type(i * 2, i));
+
+	const int JUMPS = 10000, WALKS = 20;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	long jumped = 0;
+	for (int q = 0; q < JUMPS; ++q) {
+		int page = rand() % (N / PAGE);
+		Map::iterator it = m.begin() + page * PAGE;
+		for (int j = 0; j < PAGE; ++j, ++it) jumped += it->second == page * PAGE + j;
+	}
+	double jumpTime = since(t0) / JUMPS;
+	t0 = std::chrono::steady_clock::now();
+	long walked = 0;
+	for (int q = 0; q < WALKS; ++q) {
+		int page = rand() % (N / PAGE);
+		Map::iterator it = m.begin();
+		for (int j = 0; j < page * PAGE; ++j) ++it;
+		walked += it->second == page * PAGE && m.index_of(it->first) == static_cast<size_t>(page * PAGE);
+	}
+	double walkTime = since(t0) / WALKS;
+	std::cerr << "page of " << PAGE << ": " << jumpTime << " us with begin() + k, " << walkTime
+	          << " us walking to it" << std::endl;
+	std::cout << "jumped pages " << (jumped == long(JUMPS) * PAGE ? "match" : "WRONG") << ", walked pages "
+	          << (walked == WALKS ? "match" : "WRONG") << std::endl;
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include "map.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// the order statistics of map, i.e. iterator + k, iterator difference, at_index
+// and index_of, against the sorted keys of a std::map under random updates
+
+typedef sjtu::map<int, int> Map;
+
+int failures = 0;
+
+void check(bool ok, const char *what, int round, int op) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << " in round " << round << " at " << op << std::endl;
+		++failures;
+	}
+}
+
+void compare(Map &m, const std::map<int, int> &ref, int round, int op) {
+	std::vector<int> keys;
+	for (std::map<int, int>::const_iterator it = ref.begin(); it != ref.end(); ++it) keys.push_back(it->first);
+	ptrdiff_t n = static_cast<ptrdiff_t>(keys.size());
+	check(m.end() - m.begin() == n && m.begin() + n == m.end(), "size", round, op);
+	for (int t = 0; t < 20 && n > 0; ++t) {
+		ptrdiff_t i = rand() % n, j = rand() % n;
+		Map::iterator it = m.find(keys[i]);
+		check((m.begin() + i)->first == keys[i] && m.at_index(i).first == keys[i], "at index", round, op);
+		check(it - m.begin() == i && m.end() - it == n - i, "difference", round, op);
+		check((it + (j - i))->first == keys[j] && it[j - i].first == keys[j], "offset", round, op);
+		Map::iterator back = m.end();
+		back -= n - j;
+		Map::const_iterator c = m.cbegin();
+		c += i;
+		check(back->first == keys[j] && c->first == keys[i] && c - m.cbegin() == i, "compound", round, op);
+		int probe = rand() % 2000 - 1000;
+		check(m.index_of(probe) == static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin()),
+		      "index of", round, op);
+	}
+	try {
+		m.begin() + (n + 1);
+		check(false, "past end", round, op);
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		m.begin() - 1;
+		check(false, "before begin", round, op);
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		m.at_index(n);
+		check(false, "index n", round, op);
+	} catch (sjtu::index_out_of_bound &) {}
+}
+
+int main() {
+	srand(97);
+	for (int round = 0; round < 40; ++round) {
+		Map m;
+		std::map<int, int> ref;
+		for (int op = 0; op < 1500; ++op) {
+			int kind = rand() % 12, key = rand() % 1000 - 500;
+			if (kind < 5) {
+				m.insert(Map::value_type(key, op));
+				ref.insert(std::make_pair(key, op));
+			} else if (kind < 9) {
+				Map::iterator it = m.find(key);
+				if (it != m.end()) m.erase(it);
+				ref.erase(key);
+			} else if (kind == 9 && op % 50 == 0) {
+				int divisor = 1 + rand() % 5;
+				m.erase_if([divisor](const Map::value_type &v) { return v.first % divisor == 0; });
+				for (std::map<int, int>::iterator it = ref.begin(); it != ref.end();) {
+					if (it->first % divisor == 0) {
+						ref.erase(it++);
+					} else {
+						++it;
+					}
+				}
+			} else if (kind == 10 && op % 100 == 0) {
+				Map copy(m);
+				m = copy;
+			}
+			if (op % 25 == 0) compare(m, ref, round, op);
+		}
+	}
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,64 @@
+#include "map.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+// sample, sample_k and sample_range on a million keys, against picking the same
+// with begin() + k; timings go to stderr, the checks to stdout
+
+typedef sjtu::map<int, int> Map;
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+	std::mt19937 rng(98);
+	const int N = 1000000;
+	Map m;
+	for (int i = 0; i < N; ++i) m.insert(Map::value_type(i, i));
+
+	const int DRAWS = 1000000;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	long sampled = 0;
+	for (int i = 0; i < DRAWS; ++i) sampled += m.sample(rng)->second;
+	double sampleTime = since(t0) * 1000 / DRAWS;
+	t0 = std::chrono::steady_clock::now();
+	long offset = 0;
+	for (int i = 0; i < DRAWS; ++i) offset += (m.begin() + static_cast<int>(rng() % N))->second;
+	double offsetTime = since(t0) * 1000 / DRAWS;
+
+	const int BATCHES = 100, K = 1000;
+	t0 = std::chrono::steady_clock::now();
+	bool ordered = true;
+	for (int b = 0; b < BATCHES; ++b) {
+		std::vector<Map::iterator> picked;
+		ordered = ordered && m.sample_k(rng, K, std::back_inserter(picked)) == K;
+		for (size_t i = 1; i < picked.size(); ++i) ordered = ordered && picked[i - 1]->first < picked[i]->first;
+	}
+	double sampleKTime = since(t0) / BATCHES;
+
+	const int RANGES = 1000, RANGE_K = 100;
+	t0 = std::chrono::steady_clock::now();
+	bool inRange = true;
+	for (int r = 0; r < RANGES; ++r) {
+		Map::iterator out[RANGE_K];
+		inRange = inRange && m.sample_range(rng, N / 4, N / 2, RANGE_K, out) == RANGE_K;
+		for (int i = 0; i < RANGE_K; ++i) inRange = inRange && out[i]->first >= N / 4 && out[i]->first < N / 2;
+	}
+	double rangeTime = since(t0) / RANGES;
+
+	std::cerr << "sample " << sampleTime << " ns, begin() + random k " << offsetTime << " ns, sample_k(" << K
+	          << ") " << sampleKTime << " us, sample_range(" << RANGE_K << " of " << N / 4 << ") " << rangeTime
+	          << " us" << std::endl;
+	// the mean of a million uniform picks over [0, N) is within 1% of N of N / 2
+	long sampledMean = sampled / DRAWS, offsetMean = offset / DRAWS;
+	std::cout << "sample mean " << (std::labs(sampledMean - N / 2) < N / 100 ? "centred" : "WRONG")
+	          << ", begin() + k mean " << (std::labs(offsetMean - N / 2) < N / 100 ? "centred" : "WRONG") << std::endl;
+	std::cout << "sample_k " << (ordered ? "ordered" : "WRONG") << ", sample_range " << (inRange ? "in range" : "WRONG")
+	          << std::endl;
+	return 0;
+}
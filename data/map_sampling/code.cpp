@@ -0,0 +1,185 @@
+#include "map.hpp"
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+// sample, sample_k, sample_weighted and sample_range: a chi-squared test of each
+// distribution against its 0.1% critical value, the shape of the results, and the
+// weight sums a weighted map keeps through inserts, erases, reweigh, erase_if
+// and apply_batch
+
+typedef sjtu::map<int, int> Map;
+typedef sjtu::map<int, long long, std::less<int>, sjtu::node_allocator, sjtu::mapped_value_weight<long long> > Weighted;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+// chi-squared statistic of counts against expected[i], over the expected > 0
+double chiSquared(const std::vector<long> &counts, const std::vector<double> &expected) {
+	double x = 0;
+	for (size_t i = 0; i < counts.size(); ++i) {
+		if (expected[i] > 0) x += (counts[i] - expected[i]) * (counts[i] - expected[i]) / expected[i];
+	}
+	return x;
+}
+
+void report(const char *name, double x, double critical) {
+	std::cout << name << ": " << (x < critical ? "distribution fits" : "BIASED") << std::endl;
+}
+
+template<class Rng>
+void uniform(const char *name, Rng rng) {
+	Map m;
+	for (int i = 0; i < 20; ++i) m.insert(Map::value_type(i * 3, i));
+	const int DRAWS = 400000;
+	std::vector<long> counts(20);
+	for (int i = 0; i < DRAWS; ++i) ++counts[m.sample(rng)->second];
+	report(name, chiSquared(counts, std::vector<double>(20, DRAWS / 20.0)), 43.8);
+}
+
+int main() {
+	std::mt19937 rng(98);
+	uniform("sample with mt19937", std::mt19937(1));
+	uniform("sample with mt19937_64", std::mt19937_64(2));
+	uniform("sample with minstd_rand", std::minstd_rand(3));
+
+	{
+		Map m;
+		for (int i = 0; i < 30; ++i) m.insert(Map::value_type(i, i));
+		const int ROUNDS = 100000;
+		std::vector<long> counts(30);
+		bool shape = true;
+		for (int r = 0; r < ROUNDS; ++r) {
+			std::vector<Map::iterator> picked;
+			shape = shape && m.sample_k(rng, 7, std::back_inserter(picked)) == 7 && picked.size() == 7;
+			for (size_t i = 0; i < picked.size(); ++i) {
+				shape = shape && (i == 0 || picked[i - 1]->first < picked[i]->first);
+				++counts[picked[i]->second];
+			}
+		}
+		check(shape, "sample_k picks 7 in key order");
+		report("sample_k", chiSquared(counts, std::vector<double>(30, ROUNDS * 7.0 / 30)), 58.3);
+		std::vector<Map::iterator> all, none;
+		check(m.sample_k(rng, 100, std::back_inserter(all)) == 30 && all.front() == m.begin(), "sample_k of more than size");
+		Map empty;
+		check(empty.sample_k(rng, 3, std::back_inserter(none)) == 0, "sample_k of empty");
+		try {
+			empty.sample(rng);
+			check(false, "sample of empty");
+		} catch (sjtu::container_is_empty &) {}
+	}
+
+	for (int round = 0; round < 20; ++round) {
+		Weighted w;
+		std::map<int, long long> ref;
+		for (int op = 0; op < 3000; ++op) {
+			int key = rng() % 500, kind = rng() % 10;
+			if (kind < 5) {
+				long long v = rng() % 100;
+				if (w.insert(Weighted::value_type(key, v)).second) ref[key] = v;
+			} else if (kind < 8) {
+				Weighted::iterator it = w.find(key);
+				if (it != w.end()) w.erase(it);
+				ref.erase(key);
+			} else if (kind < 9) {
+				Weighted::iterator it = w.find(key);
+				if (it != w.end()) {
+					it->second = rng() % 100;
+					ref[key] = it->second;
+					w.reweigh(it);
+				}
+			} else if (op % 300 == 0) {
+				w.erase_if([](const Weighted::value_type &v) { return v.second % 3 == 0; });
+				for (std::map<int, long long>::iterator it = ref.begin(); it != ref.end();) {
+					if (it->second % 3 == 0) {
+						ref.erase(it++);
+					} else {
+						++it;
+					}
+				}
+			}
+			if (op % 100 == 0) {
+				long long sum = 0;
+				for (std::map<int, long long>::const_iterator it = ref.begin(); it != ref.end(); ++it) sum += it->second;
+				Weighted copy(w);
+				check(w.total_weight() == sum && copy.total_weight() == sum, "total weight");
+			}
+		}
+	}
+	std::cout << "weights kept" << std::endl;
+
+	{
+		Weighted w;
+		for (int i = 0; i < 10; ++i) w.insert(Weighted::value_type(i, i));
+		const int DRAWS = 450000;
+		std::vector<long> counts(10);
+		std::vector<double> expected(10);
+		for (int i = 0; i < DRAWS; ++i) ++counts[w.sample_weighted(rng)->first];
+		for (int i = 0; i < 10; ++i) expected[i] = DRAWS * i / 45.0;
+		check(counts[0] == 0, "zero weight drawn");
+		report("sample_weighted", chiSquared(counts, expected), 26.1);
+		Weighted zero;
+		zero.insert(Weighted::value_type(1, 0));
+		try {
+			zero.sample_weighted(rng);
+			check(false, "sample_weighted of zero total");
+		} catch (sjtu::container_is_empty &) {}
+	}
+
+	{
+		// weights overwritten through apply_batch must reach the sums sample_weighted descends by
+		Weighted w;
+		for (int i = 0; i < 10; ++i) w.insert(Weighted::value_type(i, 1));
+		long long weights[10] = {0, 9, 1, 8, 2, 7, 3, 6, 4, 5};
+		std::vector<Weighted::batch_op> ops;
+		for (int i = 0; i < 10; ++i) ops.push_back(Weighted::batch_op(Weighted::batch_assign, i, &weights[i]));
+		w.apply_batch(ops.data(), ops.size());
+		check(w.total_weight() == 45, "total weight after apply_batch");
+		const int DRAWS = 450000;
+		std::vector<long> counts(10);
+		std::vector<double> expected(10);
+		for (int i = 0; i < DRAWS; ++i) ++counts[w.sample_weighted(rng)->first];
+		for (int i = 0; i < 10; ++i) expected[i] = DRAWS * weights[i] / 45.0;
+		check(counts[0] == 0, "zero weight drawn after apply_batch");
+		report("sample_weighted after apply_batch", chiSquared(counts, expected), 26.1);
+	}
+
+	{
+		Map m;
+		for (int i = 0; i < 1000; ++i) m.insert(Map::value_type(i, i));
+		const int ROUNDS = 20000, LO = 100, HI = 400, K = 10;
+		std::vector<long> counts(1000);
+		std::vector<double> expected(1000);
+		bool shape = true;
+		for (int r = 0; r < ROUNDS; ++r) {
+			Map::iterator out[K];
+			size_t got = m.sample_range(rng, LO, HI, K, out);
+			std::set<int> seen;
+			shape = shape && got == K;
+			for (size_t i = 0; i < got; ++i) {
+				int key = out[i]->first;
+				shape = shape && key >= LO && key < HI && seen.insert(key).second;
+				++counts[key];
+			}
+		}
+		for (int i = LO; i < HI; ++i) expected[i] = ROUNDS * static_cast<double>(K) / (HI - LO);
+		check(shape, "sample_range picks 10 distinct keys in range");
+		report("sample_range", chiSquared(counts, expected), 385.0);
+		Map::iterator out[10];
+		check(m.sample_range(rng, 995, 2000, 10, out) == 5 && out[0]->first == 995 && out[4]->first == 999,
+		      "sample_range of a short range");
+		check(m.sample_range(rng, 500, 500, 3, out) == 0 && m.sample_range(rng, 600, 500, 3, out) == 0,
+		      "sample_range of an empty range");
+	}
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "class-matrix.hpp"
+#include <cstdlib>
+#include <iostream>
+
+// the lazy elementwise operators against explicit loops: mixed chains, results
+// assigned back to an operand, transposes, indexing an expression without
+// evaluating it, and size mismatches
+
+using namespace Diamond;
+
+int failures = 0;
+
+void Check(bool ok, const char *what)
+{
+	if (!ok) {
+		std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+// small integers and quarters, so every result below is exact
+Matrix<double> Random(size_t rows, size_t cols)
+{
+	Matrix<double> m(rows, cols);
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = 0; j < cols; ++j) {
+			m[i][j] = rand() % 41 - 20;
+		}
+	}
+	return m;
+}
+
+int main()
+{
+	srand(95);
+	const size_t R = 13, C = 7;
+	Matrix<double> a = Random(R, C), b = Random(R, C), c = Random(R, C);
+
+	Matrix<double> d = a + b - c * 2.0 + a / 4.0 - (-b) + 3.0 * c;
+	bool same = d.RowSize() == R && d.ColSize() == C;
+	for (size_t i = 0; i < R; ++i) {
+		for (size_t j = 0; j < C; ++j) {
+			same = same && d[i][j] == a[i][j] + b[i][j] - c[i][j] * 2 + a[i][j] / 4 + b[i][j] + 3 * c[i][j];
+		}
+	}
+	Check(same, "mixed chain");
+
+	Matrix<double> t = Transpose(a + b) - Transpose(c);
+	same = t.RowSize() == C && t.ColSize() == R;
+	for (size_t i = 0; i < C; ++i) {
+		for (size_t j = 0; j < R; ++j) same = same && t[i][j] == a[j][i] + b[j][i] - c[j][i];
+	}
+	Check(same, "transposed chain");
+
+	// indexing a node reads one element, as indexing the evaluated matrix does
+	Check((a + b)[0][0] == a[0][0] + b[0][0] && (a - b * 2.0)[R - 1][C - 1] == a[R - 1][C - 1] - b[R - 1][C - 1] * 2,
+	      "indexing a sum");
+	Check(Transpose(a)[C - 1][0] == a[0][C - 1] && Transpose(a + c)[2][5] == a[5][2] + c[5][2], "indexing a transpose");
+	Check((-a)[3][4] == -a[3][4] && (a / 2.0)[1][1] == a[1][1] / 2, "indexing a negation and a quotient");
+	const Matrix<double> &constA = a;
+	Check(constA[2][3] == a.At(2, 3), "indexing a const matrix");
+
+	// assigning to an operand
+	Matrix<double> x = a, y = a;
+	x = x + b;
+	Check(x == a + b, "x = x + b");
+	x = b - x * 2.0 + x;
+	Check(x == b - (a + b), "x = b - x * 2 + x");
+	y = Transpose(y);
+	Check(y.RowSize() == C && y.ColSize() == R && y == Transpose(a), "y = Transpose(y)");
+	Matrix<double> square = Random(9, 9), original = square;
+	square = Transpose(square) + square;
+	Check(square == Transpose(original) + original, "square = Transpose(square) + square");
+
+	// products and Pow take expressions
+	Matrix<double> p = (a + b) * Transpose(c), q = Matrix<double>(a + b) * Matrix<double>(Transpose(c));
+	Check(p == q && p.RowSize() == R && p.ColSize() == R, "product of expressions");
+	size_t power = 3;
+	Matrix<double> cube = Pow(original - original + I<double>(9) * 2.0, power);
+	Check(cube == I<double>(9) * 8.0, "Pow of an expression");
+
+	try {
+		Matrix<double> bad = a + Transpose(b);
+		Check(false, "size mismatch");
+	} catch (std::invalid_argument &) {
+		std::cout << "size mismatch throws" << std::endl;
+	}
+	Check(!(a == Transpose(a)) && a == a + Matrix<double>(R, C, 0), "comparisons");
+
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "class-matrix.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// GFLOP/s of the blocked double and float product against the plain i-k-j loop
+// over square sizes, on one thread and on all; timings go to stderr, the checks
+// to stdout. Build with -DDIAMOND_MATRIX_NO_AVX2 to time the scalar kernel.
+
+using namespace Diamond;
+
+template<typename _Td>
+Matrix<_Td> Random(size_t n)
+{
+	Matrix<_Td> m(n, n);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			m[i][j] = static_cast<_Td>(rand() % 2001 - 1000) / 1000;
+		}
+	}
+	return m;
+}
+
+double Since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template<typename _Td>
+void Sweep(const char *name, double epsilon)
+{
+	const size_t sizes[] = {32, 64, 128, 256, 512, 1024};
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		size_t n = sizes[s];
+		double flops = 2.0 * n * n * n;
+		int reps = static_cast<int>(2e9 / flops) + 1;
+		Matrix<_Td> a = Random<_Td>(n), b = Random<_Td>(n);
+		Matrix<_Td> plain(n, n, 0);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		gemm::Multiply(a, b, plain, std::false_type());
+		double plainTime = Since(t0);
+		MultiplyThreads() = 1;
+		t0 = std::chrono::steady_clock::now();
+		for (int r = 1; r < reps; ++r) Matrix<_Td> discard = a * b;
+		Matrix<_Td> single = a * b;
+		double singleTime = Since(t0) / reps;
+		MultiplyThreads() = 0;
+		t0 = std::chrono::steady_clock::now();
+		for (int r = 1; r < reps; ++r) Matrix<_Td> discard = a * b;
+		Matrix<_Td> threaded = a * b;
+		double threadedTime = Since(t0) / reps;
+		std::cerr << name << " " << n << ": i-k-j " << flops / plainTime / 1e9 << ", blocked "
+		          << flops / singleTime / 1e9 << ", threaded " << flops / threadedTime / 1e9 << " GFLOP/s" << std::endl;
+		double error = 0;
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j < n; ++j) {
+				error = std::max(error, std::fabs(static_cast<double>(single[i][j]) - plain[i][j]));
+				error = std::max(error, std::fabs(static_cast<double>(threaded[i][j]) - plain[i][j]));
+			}
+		}
+		std::cout << name << " " << n << ": " << (error <= epsilon * n ? "within tolerance" : "WRONG") << std::endl;
+	}
+}
+
+int main()
+{
+	srand(94);
+	Sweep<double>("double", 1e-15);
+	Sweep<float>("float", 1e-6);
+	return 0;
+}
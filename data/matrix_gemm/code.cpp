@@ -0,0 +1,79 @@
+#include "class-matrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// the blocked float and double product of operator* against the plain i-k-j loop,
+// over random and edge shapes, one thread and several; build it again with
+// -DDIAMOND_MATRIX_NO_AVX2 to cover the scalar kernel, the output is the same
+
+using namespace Diamond;
+
+int failures = 0;
+
+template<typename _Td>
+Matrix<_Td> Random(size_t rows, size_t cols)
+{
+	Matrix<_Td> m(rows, cols);
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = 0; j < cols; ++j) {
+			m[i][j] = static_cast<_Td>(rand() % 2001 - 1000) / 1000;
+		}
+	}
+	return m;
+}
+
+// both sum the same k products of terms in [-1, 1], in different orders
+template<typename _Td>
+void Check(size_t m, size_t k, size_t n, double epsilon)
+{
+	Matrix<_Td> a = Random<_Td>(m, k), b = Random<_Td>(k, n);
+	Matrix<_Td> c = a * b, expected(m, n, 0);
+	gemm::Multiply(a, b, expected, std::false_type());
+	double error = 0;
+	for (size_t i = 0; i < m; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			error = std::max(error, std::fabs(static_cast<double>(c[i][j]) - static_cast<double>(expected[i][j])));
+		}
+	}
+	if (c.RowSize() != m || c.ColSize() != n || !(error <= epsilon * k)) {
+		if (failures < 10) {
+			std::cout << "mismatch at " << m << " x " << k << " x " << n << ": error " << error << std::endl;
+		}
+		++failures;
+	}
+}
+
+void CheckBoth(size_t m, size_t k, size_t n)
+{
+	Check<double>(m, k, n, 1e-15);
+	Check<float>(m, k, n, 1e-6);
+}
+
+int main()
+{
+	srand(94);
+	const size_t shapes[][3] = {
+		{1, 1, 1}, {7, 5, 3}, {73, 257, 9}, {200, 1, 200}, {1, 1000, 1}, {6, 256, 8}, {6, 256, 16},
+		{72, 256, 4080}, {73, 513, 4081}, {145, 300, 17}, {300, 300, 300}, {500, 100, 33},
+	};
+	const size_t threadCounts[] = {1, 3, 0};
+	for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+		MultiplyThreads() = threadCounts[t];
+		for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+			CheckBoth(shapes[s][0], shapes[s][1], shapes[s][2]);
+		}
+		for (int r = 0; r < 100; ++r) {
+			CheckBoth(1 + rand() % 40, 1 + rand() % 300, 1 + rand() % 40);
+		}
+		CheckBoth(1000, 200, 100);
+		std::cout << "threads " << threadCounts[t] << " checked" << std::endl;
+	}
+	MultiplyThreads() = 0;
+
+	Matrix<int> ia(3, 4, 2), ib(4, 5, 3);
+	std::cout << "int " << (ia * ib)[2][4] << std::endl;
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include "class-matrix.hpp"
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// the one-buffer storage of Matrix: rows laid out at Data() + i * Stride(), moves
+// that take the buffer over and leave the source an empty 0 x 0 matrix that can be
+// used again, deep copies, and a vector of matrices growing without copying buffers
+
+using namespace Diamond;
+
+int failures = 0;
+
+void Check(bool ok, const char *what)
+{
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+template<typename _Td>
+bool IsEmpty(const Matrix<_Td> &m)
+{
+	return m.RowSize() == 0 && m.ColSize() == 0 && m.Stride() == 0;
+}
+
+Matrix<int> Numbered(size_t rows, size_t cols, int base)
+{
+	Matrix<int> m(rows, cols);
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = 0; j < cols; ++j) m[i][j] = base + int(i * cols + j);
+	}
+	return m;
+}
+
+bool IsNumbered(const Matrix<int> &m, size_t rows, size_t cols, int base)
+{
+	if (m.RowSize() != rows || m.ColSize() != cols) return false;
+	for (size_t i = 0; i < rows; ++i) {
+		for (size_t j = 0; j < cols; ++j) {
+			if (m[i][j] != base + int(i * cols + j) || m.At(i, j) != m[i][j]) return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	Matrix<int> a = Numbered(5, 7, 0);
+	bool contiguous = a.Stride() >= a.ColSize();
+	for (size_t i = 0; i < 5; ++i) contiguous = contiguous && &a[i][0] == a.Data() + i * a.Stride();
+	Check(contiguous, "rows in one buffer");
+
+	const int *buffer = a.Data();
+	Matrix<int> b(std::move(a));
+	Check(IsEmpty(a) && b.Data() == buffer && IsNumbered(b, 5, 7, 0), "move constructor");
+
+	Matrix<int> c = Numbered(3, 2, 100);
+	c = std::move(b);
+	Check(IsEmpty(b) && c.Data() == buffer && IsNumbered(c, 5, 7, 0), "move assignment over a smaller matrix");
+	Matrix<int> d = Numbered(9, 9, 5);
+	Matrix<int> small = Numbered(2, 2, 7);
+	d = std::move(small);
+	Check(IsEmpty(small) && IsNumbered(d, 2, 2, 7), "move assignment over a larger matrix");
+	Matrix<int> &alias = c;
+	c = std::move(alias);
+	Check(c.Data() == buffer && IsNumbered(c, 5, 7, 0), "move assignment to itself");
+
+	// moved-from matrices take new values, by copy, by move and from expressions
+	a = Numbered(4, 4, 1);
+	b = c;
+	Check(IsNumbered(a, 4, 4, 1) && IsNumbered(b, 5, 7, 0) && b.Data() != c.Data(), "moved-from matrices reused");
+	b[0][0] = -1;
+	Check(c[0][0] == 0, "copies are deep");
+	Matrix<int> e(std::move(d));
+	d = e + e;
+	Check(IsNumbered(e, 2, 2, 7) && d.RowSize() == 2 && d.ColSize() == 2 && d[1][1] == 2 * 10, "moved-from matrix assigned an expression");
+
+	// a vector of matrices moves them as it grows, so no buffer is copied
+	std::vector<Matrix<int> > many;
+	std::vector<const int *> buffers;
+	for (int k = 0; k < 100; ++k) {
+		many.push_back(Numbered(k % 7 + 1, k % 5 + 1, k));
+		buffers.push_back(many.back().Data());
+	}
+	bool kept = true;
+	for (int k = 0; k < 100; ++k) kept = kept && many[k].Data() == buffers[k] && IsNumbered(many[k], k % 7 + 1, k % 5 + 1, k);
+	Check(kept, "buffers kept across vector growth");
+
+	// elements that own memory themselves
+	Matrix<std::string> words(3, 3, std::string(40, 'w'));
+	Matrix<std::string> taken(std::move(words));
+	Check(IsEmpty(words) && taken[2][2] == std::string(40, 'w'), "move of non-trivial elements");
+	words = taken;
+	taken = std::move(words);
+	Check(IsEmpty(words) && taken.RowSize() == 3 && taken[0][1].size() == 40, "copy then move back");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
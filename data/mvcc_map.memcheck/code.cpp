@@ -0,0 +1,72 @@
+#include "mvcc_map.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// one writer raises every key to the next generation in key order while scanners
+// walk snapshots and a background collector frees old versions; each scan must see
+// one consistent moment: a prefix of keys at generation g, the rest at g - 1.
+// Build with -fsanitize=address (or thread) to check no freed version is read
+
+const int KEYS = 2000;
+const int SCANNERS = 3;
+const int SCANS = 200;
+
+int main() {
+	sjtu::mvcc_map<int, long> m;
+	for (int k = 0; k < KEYS; ++k) m.assign(k, 0);
+	m.start_collector(std::chrono::milliseconds(1));
+
+	std::atomic<bool> stop(false);
+	std::thread writer([&m, &stop]() {
+		for (long g = 1; !stop.load(); ++g) {
+			for (int k = 0; k < KEYS; ++k) m.assign(k, g);
+			// keys beyond KEYS come and go so the collector has whole keys to erase
+			m.insert(KEYS + int(g % 50), g);
+			m.erase(KEYS + int((g + 25) % 50));
+		}
+	});
+
+	std::atomic<int> consistent(0);
+	std::vector<std::thread> scanners;
+	for (int r = 0; r < SCANNERS; ++r) {
+		scanners.push_back(std::thread([&m, &consistent]() {
+			for (int n = 0; n < SCANS; ++n) {
+				sjtu::mvcc_map<int, long>::snapshot s = m.begin_snapshot();
+				int seen = 0, drops = 0;
+				long previous = -1;
+				bool good = true;
+				for (sjtu::mvcc_map<int, long>::const_iterator it = s.begin(); it != s.end(); ++it) {
+					if (it->first >= KEYS) continue;
+					good = good && it->first == seen;
+					if (seen > 0 && it->second != previous) {
+						good = good && it->second == previous - 1;
+						++drops;
+					}
+					previous = it->second;
+					++seen;
+				}
+				if (good && seen == KEYS && drops <= 1) ++consistent;
+			}
+		}));
+	}
+	for (size_t i = 0; i < scanners.size(); ++i) scanners[i].join();
+	stop.store(true);
+	writer.join();
+	m.stop_collector();
+	std::cout << "consistent scans " << consistent.load() << std::endl;
+
+	// stopping twice, restarting and dropping the map with the collector running
+	m.stop_collector();
+	m.start_collector(std::chrono::milliseconds(1));
+	m.start_collector(std::chrono::milliseconds(2));
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	m.collect_garbage();
+	sjtu::mvcc_map<int, long>::snapshot last = m.begin_snapshot();
+	long generation = last.at(0);
+	bool settled = last.at(KEYS - 1) == generation;
+	std::cout << (settled && m.size() >= size_t(KEYS) ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
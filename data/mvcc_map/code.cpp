@@ -0,0 +1,128 @@
+#include "mvcc_map.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// mvcc_map against a std::map under random inserts, assigns and erases, with
+// snapshots taken along the way compared against copies of the std::map made at
+// the same moment, and collect_garbage run with and without snapshots alive
+
+typedef sjtu::mvcc_map<int, std::string> Map;
+typedef std::map<int, std::string> Ref;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+bool sameView(const Map::snapshot &s, const Ref &ref) {
+	Map::const_iterator it = s.begin();
+	for (Ref::const_iterator j = ref.begin(); j != ref.end(); ++j, ++it) {
+		if (it == s.end() || it->first != j->first || (*it).second != j->second) return false;
+	}
+	return it == s.end();
+}
+
+int main() {
+	{
+		// one key through insert, assign, erase and re-insert, a snapshot after each step
+		Map m;
+		Map::snapshot empty = m.begin_snapshot();
+		check(m.insert(1, "a"), "insert");
+		check(!m.insert(1, "x"), "insert over a live key");
+		Map::snapshot inserted = m.begin_snapshot();
+		m.assign(1, "b");
+		Map::snapshot assigned = m.begin_snapshot();
+		check(m.erase(1) == 1 && m.erase(1) == 0, "erase");
+		Map::snapshot erased = m.begin_snapshot();
+		check(m.insert(1, "c"), "re-insert");
+		Map::snapshot reinserted = m.begin_snapshot();
+		m.assign(1, "d");
+
+		check(empty.count(1) == 0 && empty.begin() == empty.end(), "view before insert");
+		check(inserted.at(1) == "a", "view after insert");
+		check(assigned.at(1) == "b", "view after assign");
+		check(erased.count(1) == 0 && erased.begin() == erased.end(), "view after erase");
+		check(reinserted.at(1) == "c", "view after re-insert");
+		check(m.at(1) == "d" && m.size() == 1, "current value");
+		try {
+			erased.at(1);
+			check(false, "at on an erased key");
+		} catch (sjtu::index_out_of_bound &) {}
+		try {
+			Map::const_iterator it = inserted.end();
+			++it;
+			check(false, "++end");
+		} catch (sjtu::invalid_iterator &) {}
+
+		// a live snapshot keeps what it sees; dropping it lets the rest go
+		check(m.collect_garbage() == 0, "collect with snapshots alive");
+		check(inserted.at(1) == "a" && reinserted.at(1) == "c" && erased.count(1) == 0, "views after collect");
+		m.erase(1);
+		check(m.collect_garbage() == 0, "collect keeps an erased key a snapshot sees");
+		check(reinserted.at(1) == "c", "erased key still seen");
+	}
+	{
+		Map m;
+		m.insert(1, "a");
+		m.erase(1);
+		m.insert(2, "b");
+		check(m.collect_garbage() == 1, "collect without snapshots");
+		Map::snapshot s = m.begin_snapshot();
+		check(s.count(1) == 0 && s.at(2) == "b" && m.size() == 1, "view after collect");
+	}
+
+	std::mt19937 rng(85);
+	Map m;
+	Ref ref;
+	std::vector<std::pair<Ref, Map::snapshot *> > snapshots;
+	size_t collected = 0;
+	for (int op = 0; op < 30000; ++op) {
+		int kind = rng() % 20, key = rng() % 300;
+		std::string value = std::to_string(op);
+		if (kind < 6) {
+			check(m.insert(key, value) == ref.insert(Ref::value_type(key, value)).second, "random insert");
+		} else if (kind < 11) {
+			m.assign(key, value);
+			ref[key] = value;
+		} else if (kind < 16) {
+			check(m.erase(key) == ref.erase(key), "random erase");
+		} else if (kind < 18) {
+			Ref::iterator it = ref.find(key);
+			check(m.count(key) == size_t(it != ref.end()), "random count");
+			if (it != ref.end()) check(m.at(key) == it->second, "random at");
+		} else if (kind < 19) {
+			if (rng() % 8 == 0) snapshots.push_back(std::make_pair(ref, new Map::snapshot(m.begin_snapshot())));
+		} else if (rng() % 4 == 0) {
+			if (!snapshots.empty() && rng() % 2) {
+				size_t which = rng() % snapshots.size();
+				delete snapshots[which].second;
+				snapshots.erase(snapshots.begin() + which);
+			}
+			collected += m.collect_garbage();
+		}
+		check(m.size() == ref.size(), "random size");
+		if (op % 1000 == 0) {
+			for (size_t i = 0; i < snapshots.size(); ++i) {
+				check(sameView(*snapshots[i].second, snapshots[i].first), "snapshot view");
+				for (int k = 0; k < 300; k += 7) check(snapshots[i].second->count(k) == snapshots[i].first.count(k), "snapshot count");
+			}
+		}
+	}
+	for (size_t i = 0; i < snapshots.size(); ++i) {
+		check(sameView(*snapshots[i].second, snapshots[i].first), "final snapshot view");
+		delete snapshots[i].second;
+	}
+	collected += m.collect_garbage();
+	Map::snapshot now = m.begin_snapshot();
+	check(sameView(now, ref), "view after the last collect");
+	check(collected > 0, "keys collected");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
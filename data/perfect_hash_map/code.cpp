@@ -0,0 +1,121 @@
+#include "perfect_hash_map.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// perfect_hash_map built from a map: lookups, ordered iteration, save and load,
+// loads of malformed files, keys without a default constructor and colliding hashes
+
+struct Point {
+	int x, y;
+	Point(int x_, int y_) : x(x_), y(y_) {}   // no default constructor
+	bool operator<(const Point &rhs) const {
+		return x != rhs.x ? x < rhs.x : y < rhs.y;
+	}
+	bool operator==(const Point &rhs) const {
+		return x == rhs.x && y == rhs.y;
+	}
+};
+
+struct PointHash {
+	size_t operator()(const Point &p) const {
+		return static_cast<size_t>(static_cast<unsigned>(p.x)) << 32 | static_cast<unsigned>(p.y);
+	}
+};
+
+struct WeakHash {
+	size_t operator()(int key) const {
+		return static_cast<size_t>(key / 2);
+	}
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+void writeFile(const char *path, const void *data, size_t bytes) {
+	FILE *file = fopen(path, "wb");
+	fwrite(data, 1, bytes, file);
+	fclose(file);
+}
+
+int main() {
+	sjtu::map<int, long> source;
+	srand(84);
+	for (int i = 0; i < 100000; ++i) source[rand() - RAND_MAX / 2] = i;
+	sjtu::perfect_hash_map<int, long> frozen(source);
+	check(frozen.size() == source.size(), "size");
+	bool same = true;
+	sjtu::perfect_hash_map<int, long>::const_iterator it = frozen.cbegin();
+	for (sjtu::map<int, long>::const_iterator jt = source.cbegin(); jt != source.cend(); ++jt, ++it) {
+		same = same && it->first == jt->first && frozen.at(jt->first) == jt->second
+		       && frozen.find(jt->first) == it;
+	}
+	check(same && it == frozen.cend(), "contents");
+	int absent = 0;
+	for (int i = 0; i < 100000; ++i) {
+		int key = rand();
+		absent += source.count(key) == 0 && frozen.count(key) == 0 && frozen.find(key) == frozen.cend();
+	}
+	std::cout << "built " << frozen.size() << ", absent " << absent << std::endl;
+
+	const char *path = "perfect_hash_map.tmp";
+	check(frozen.save(path), "save");
+	sjtu::perfect_hash_map<int, long> loaded;
+	check(loaded.load(path), "load");
+	same = loaded.size() == frozen.size();
+	for (it = frozen.cbegin(); it != frozen.cend() && same; ++it) same = loaded.at(it->first) == it->second;
+	check(same, "loaded contents");
+
+	// truncated, garbage and lying headers all fail and leave the map empty
+	FILE *file = fopen(path, "rb");
+	std::vector<char> bytes(1 << 22);
+	bytes.resize(fread(bytes.data(), 1, bytes.size(), file));
+	fclose(file);
+	writeFile(path, bytes.data(), bytes.size() - 1);
+	check(!loaded.load(path) && loaded.empty(), "truncated");
+	writeFile(path, bytes.data(), 10);
+	check(!loaded.load(path) && loaded.empty(), "short header");
+	unsigned long long header[4] = {0x5348504dULL, 1ULL << 60, (1ULL << 59) + 1, 1};
+	writeFile(path, header, sizeof(header));
+	check(!loaded.load(path) && loaded.empty(), "huge slot count");
+	header[1] = ~0ULL;
+	header[2] = header[1] / 2 + 1;
+	writeFile(path, header, sizeof(header));
+	check(!loaded.load(path) && loaded.empty(), "largest slot count");
+	std::vector<char> corrupt(bytes);
+	for (size_t i = sizeof(header); i < corrupt.size(); i += 7) corrupt[i] = static_cast<char>(rand());
+	writeFile(path, corrupt.data(), corrupt.size());
+	loaded.load(path);   // may or may not parse, must not crash
+	check(!loaded.load("no/such/file") && loaded.empty(), "missing");
+	std::cout << "malformed files rejected" << std::endl;
+
+	sjtu::map<Point, int> points;
+	for (int i = 0; i < 1000; ++i) points[Point(i % 37, i)] = i;
+	sjtu::perfect_hash_map<Point, int, PointHash> frozenPoints(points);
+	check(frozenPoints.save(path), "save points");
+	sjtu::perfect_hash_map<Point, int, PointHash> loadedPoints;
+	check(loadedPoints.load(path) && loadedPoints.size() == 1000 && loadedPoints.at(Point(5, 5)) == 5,
+	      "load points");
+	remove(path);
+	std::cout << "points " << loadedPoints.size() << std::endl;
+
+	sjtu::map<int, int> colliding;
+	colliding[2] = 0;
+	colliding[3] = 1;
+	try {
+		sjtu::perfect_hash_map<int, int, WeakHash> weak(colliding);
+		check(false, "equal hashes");
+	} catch (sjtu::runtime_error &) {
+		std::cout << "equal hashes rejected" << std::endl;
+	}
+
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include "map.hpp"
+#include "prefixed_key.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// prefixed_key<std::string> must order exactly as std::string does: every pair of
+// keys from a set built to stress the prefix (long shared prefixes, embedded NULs
+// and 0xff bytes, keys shorter than the 8-byte prefix and keys that are prefixes
+// of others), then a map over prefixed keys against a std::map over strings
+
+typedef sjtu::prefixed_key<std::string> Key;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+int main() {
+	std::mt19937 rng(80);
+	const char alphabet[] = {'\0', '\x01', 'a', 'b', '\x7f', '\x80', '\xff'};
+	std::vector<std::string> keys;
+	keys.push_back(std::string());
+	keys.push_back(std::string(1, '\0'));
+	keys.push_back(std::string(8, '\0'));
+	keys.push_back(std::string(9, '\0'));
+	keys.push_back(std::string(8, '\xff'));
+	keys.push_back(std::string(8, '\xff') + '\0');
+	keys.push_back("abc");
+	keys.push_back(std::string("abc\0", 4));
+	keys.push_back(std::string("ab\0c", 4));
+	std::string shared = "common-prefix-longer-than-eight-bytes/";
+	for (int i = 0; i < 600; ++i) {
+		std::string key;
+		int shape = rng() % 4;
+		if (shape == 0) key = shared.substr(0, rng() % (shared.size() + 1));
+		if (shape == 1) key = std::string(rng() % 10, '\0');
+		size_t length = rng() % (shape == 3 ? 8 : 14);
+		for (size_t j = 0; j < length; ++j) key += alphabet[rng() % sizeof(alphabet)];
+		keys.push_back(key);
+	}
+
+	size_t samePrefix = 0;
+	bool good = true;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		Key a(keys[i]);
+		good = good && a.key() == keys[i] && a.prefix() == sjtu::key_prefix(keys[i]);
+		for (size_t j = 0; j < keys.size(); ++j) {
+			Key b(keys[j]);
+			good = good && (a < b) == (keys[i] < keys[j]) && (a == b) == (keys[i] == keys[j]) && (a != b) == (keys[i] != keys[j]);
+			// the prefix alone may only ever agree with the string order
+			if (a.prefix() < b.prefix()) good = good && keys[i] < keys[j];
+			samePrefix += a.prefix() == b.prefix() && keys[i] != keys[j];
+		}
+	}
+	check(good, "order of every pair");
+	check(samePrefix > 1000, "pairs decided by the full key");
+
+	sjtu::map<Key, int> m;
+	std::map<std::string, int> ref;
+	for (int i = 0; i < 20000; ++i) {
+		const std::string &key = keys[rng() % keys.size()];
+		if (rng() % 4 == 0) {
+			sjtu::map<Key, int>::iterator it = m.find(key);
+			if (it != m.end()) m.erase(it);
+			ref.erase(key);
+		} else {
+			m[key] = i;
+			ref[key] = i;
+		}
+	}
+	good = m.size() == ref.size();
+	sjtu::map<Key, int>::const_iterator it = m.cbegin();
+	for (std::map<std::string, int>::iterator j = ref.begin(); good && j != ref.end(); ++j, ++it) {
+		good = it->first.key() == j->first && it->second == j->second && m.at(j->first) == j->second;
+	}
+	check(good && it == m.cend(), "map over prefixed keys");
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
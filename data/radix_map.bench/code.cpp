@@ -0,0 +1,63 @@
+#include "map.hpp"
+#include "radix_map.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// radix_map against map on int keys: the sequential pattern of corner_data/3
+// (ascending and descending inserts, erasing through a walking iterator) and
+// random inserts and lookups; timings go to stderr, the checks to stdout
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template<class Map>
+void sequential(const char *name) {
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	Map mp;
+	typename Map::iterator x = mp.insert(typename Map::value_type(666, 1)).first;
+	for (int i = 0; i <= 114514; ++i) mp.insert(typename Map::value_type(i, i));
+	while (x != ++--mp.end()) mp.erase(x++);
+	size_t first = mp.size();
+	for (int i = 0; i < 10; ++i) mp.clear();
+	x = mp.insert(typename Map::value_type(19198, 1)).first;
+	for (int i = 114514; i >= 0; --i) mp.insert(typename Map::value_type(i, i));
+	while (x != --++mp.begin()) mp.erase(x--);
+	std::cerr << name << " sequential: " << since(t0) << " ms" << std::endl;
+	std::cout << name << " sequential " << first << " " << mp.size() << std::endl;
+}
+
+template<class Map>
+void random(const char *name, const std::vector<int> &keys) {
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	Map mp;
+	for (size_t i = 0; i < keys.size(); ++i) mp[keys[i]] = static_cast<int>(i);
+	double built = since(t0);
+	t0 = std::chrono::steady_clock::now();
+	long found = 0;
+	for (int pass = 0; pass < 4; ++pass) {
+		for (size_t i = 0; i < keys.size(); ++i) found += mp.count(keys[i] + pass);
+	}
+	double looked = since(t0);
+	t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < keys.size(); i += 2) {
+		typename Map::iterator it = mp.find(keys[i]);
+		if (it != mp.end()) mp.erase(it);
+	}
+	std::cerr << name << " random: insert " << built << " ms, lookups " << looked << " ms, erase "
+	          << since(t0) << " ms" << std::endl;
+	std::cout << name << " random " << found << " " << mp.size() << std::endl;
+}
+
+int main() {
+	sequential<sjtu::radix_map<int, int> >("radix_map");
+	sequential<sjtu::map<int, int> >("map");
+	std::vector<int> keys;
+	srand(82);
+	for (int i = 0; i < 500000; ++i) keys.push_back(rand() % 4000000 - 2000000);
+	random<sjtu::radix_map<int, int> >("radix_map", keys);
+	random<sjtu::map<int, int> >("map", keys);
+	return 0;
+}
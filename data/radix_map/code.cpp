@@ -0,0 +1,97 @@
+#include "radix_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+// radix_map against std::map under random inserts, lookups and erases, for
+// fixed-width keys (int, short, double with -0.0) and strings with embedded NULs
+
+int failures = 0;
+
+void check(bool ok, const char *what, int step) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << " at " << step << std::endl;
+		++failures;
+	}
+}
+
+template<class Key, class Gen>
+void run(const char *name, Gen gen, int ops) {
+	sjtu::radix_map<Key, int> r;
+	std::map<Key, int> s;
+	for (int i = 0; i < ops; ++i) {
+		Key k = gen();
+		int op = rand() % 4;
+		if (op < 2) {
+			bool inserted = r.insert(sjtu::pair<const Key, int>(k, i)).second;
+			check(inserted == s.insert(std::make_pair(k, i)).second, "insert", i);
+		} else if (op == 2) {
+			typename sjtu::radix_map<Key, int>::iterator it = r.find(k);
+			if (s.count(k)) {
+				check(it != r.end() && it->second == s[k], "find", i);
+				if (it != r.end()) r.erase(it);
+				s.erase(k);
+			} else {
+				check(it == r.end(), "find absent", i);
+			}
+		} else {
+			r[k] += 1;
+			s[k] += 1;
+		}
+		check(r.size() == s.size(), "size", i);
+		if (i % 997 == 0) {
+			typename sjtu::radix_map<Key, int>::const_iterator it = r.cbegin();
+			for (typename std::map<Key, int>::const_iterator jt = s.begin(); jt != s.end(); ++jt, ++it) {
+				check(it != r.cend() && !(it->first < jt->first) && !(jt->first < it->first) &&
+				      it->second == jt->second, "order", i);
+			}
+			check(it == r.cend(), "end", i);
+		}
+	}
+	sjtu::radix_map<Key, int> copy(r);
+	r.clear();
+	check(copy.size() == s.size() && r.size() == 0, "copy", ops);
+	std::cout << name << " " << s.size() << std::endl;
+}
+
+int main() {
+	srand(82);
+	run<int>("int", [] { return rand() % 2000 - 1000; }, 200000);
+	run<short>("short", [] { return static_cast<short>(rand()); }, 200000);
+	run<unsigned long long>("unsigned long long", [] {
+		unsigned long long high = static_cast<unsigned long long>(rand());
+		return high << (rand() % 33);
+	}, 200000);
+	run<double>("double", [] {
+		int v = rand() % 4000 - 2000;
+		return v == 0 && rand() % 2 ? -0.0 : v / 7.0;
+	}, 200000);
+	run<std::string>("string", [] {
+		std::string s;
+		for (int n = rand() % 5; n > 0; --n) s += "a\0b\xff"[rand() % 4];
+		return s;
+	}, 200000);
+	run<std::string>("shared prefix", [] {
+		std::string s = "prefix/common/";
+		for (int n = rand() % 6; n > 0; --n) s += static_cast<char>(rand() % 256);
+		return s;
+	}, 200000);
+
+	sjtu::radix_map<double, int> zeros;
+	zeros[0.0] = 1;
+	check(zeros.count(-0.0) == 1 && zeros.find(-0.0) == zeros.begin(), "-0.0", 0);
+	try {
+		sjtu::radix_map<int, int> m;
+		m.at(3);
+		check(false, "at", 0);
+	} catch (sjtu::index_out_of_bound &) {}
+	try {
+		sjtu::radix_map<int, int> m;
+		--m.end();
+		check(false, "--end", 0);
+	} catch (sjtu::invalid_iterator &) {}
+
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include "map.hpp"
+#include "range_map.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// rectangle counts of range_map against scanning a map keyed by x and filtering
+// on y, for squares a tenth of the plane wide; timings go to stderr, the checks
+// to stdout
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int coordinate() {
+	return rand() % (1 << 20);
+}
+
+int main() {
+	srand(96);
+	const int sizes[] = {10000, 100000, 1000000};
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		int n = sizes[s];
+		sjtu::range_map<int, int, int> rm;
+		sjtu::map<int, std::vector<std::pair<int, int> > > byX;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < n; ++i) {
+			int x = coordinate(), y = coordinate();
+			if (rm.insert(x, y, i)) byX[x].push_back(std::make_pair(y, i));
+		}
+		double inserted = since(t0) / n;
+
+		const int QUERIES = 2000, WIDTH = (1 << 20) / 10;
+		std::vector<int> corners;
+		for (int q = 0; q < 2 * QUERIES; ++q) corners.push_back(coordinate());
+		t0 = std::chrono::steady_clock::now();
+		size_t counted = 0;
+		for (int q = 0; q < QUERIES; ++q) {
+			int x = corners[2 * q], y = corners[2 * q + 1];
+			counted += rm.count(x, x + WIDTH, y, y + WIDTH);
+		}
+		double rangeTime = since(t0) / QUERIES;
+		t0 = std::chrono::steady_clock::now();
+		size_t scanned = 0;
+		for (int q = 0; q < QUERIES; ++q) {
+			int x = corners[2 * q], y = corners[2 * q + 1];
+			sjtu::map<int, std::vector<std::pair<int, int> > >::const_iterator it = byX.lower_bound(x);
+			for (; it != byX.cend() && it->first <= x + WIDTH; ++it) {
+				for (size_t j = 0; j < it->second.size(); ++j) {
+					scanned += it->second[j].first >= y && it->second[j].first <= y + WIDTH;
+				}
+			}
+		}
+		double scanTime = since(t0) / QUERIES;
+		std::cerr << n << " points: insert " << inserted << " us, count " << rangeTime << " us, x scan "
+		          << scanTime << " us" << std::endl;
+		std::cout << n << " points: " << (counted == scanned ? "counts agree" : "WRONG") << std::endl;
+	}
+	return 0;
+}
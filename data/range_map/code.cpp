@@ -0,0 +1,75 @@
+#include "range_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+
+// range_map against a std::map keyed by (x, y) under random inserts, erases and
+// rectangle queries, on grids from dense to sparse so both tree families rebuild
+
+int failures = 0;
+
+void check(bool ok, const char *what, int round, int op) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << " in round " << round << " at " << op << std::endl;
+		++failures;
+	}
+}
+
+int main() {
+	srand(96);
+	size_t queries = 0, reported = 0;
+	for (int round = 0; round < 30; ++round) {
+		sjtu::range_map<int, int, int> rm;
+		std::map<std::pair<int, int>, int> ref;
+		int side = 5 + round * 3;
+		for (int op = 0; op < 3000; ++op) {
+			int kind = rand() % 10, x = rand() % side, y = rand() % side;
+			if (kind < 4) {
+				check(rm.insert(x, y, op) == ref.insert(std::make_pair(std::make_pair(x, y), op)).second,
+				      "insert", round, op);
+			} else if (kind < 7) {
+				check(rm.erase(x, y) == ref.erase(std::make_pair(x, y)), "erase", round, op);
+			} else {
+				// sometimes an empty x range
+				int x2 = rand() % 8 == 0 ? x - 1 : x + rand() % side / 2, y2 = y + rand() % side / 2;
+				std::set<std::tuple<int, int, int> > want, got;
+				for (std::map<std::pair<int, int>, int>::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+					if (it->first.first >= x && it->first.first <= x2 && it->first.second >= y && it->first.second <= y2) {
+						want.insert(std::make_tuple(it->first.first, it->first.second, it->second));
+					}
+				}
+				size_t calls = 0;
+				rm.report(x, x2, y, y2, [&](const int &a, const int &b, const int &v) {
+					++calls;
+					got.insert(std::make_tuple(a, b, v));
+				});
+				check(rm.count(x, x2, y, y2) == want.size() && calls == want.size() && got == want, "query", round, op);
+				++queries;
+				reported += calls;
+			}
+			check(rm.size() == ref.size(), "size", round, op);
+		}
+		for (std::map<std::pair<int, int>, int>::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+			check(rm.count(it->first.first, it->first.second) == 1 && rm.at(it->first.first, it->first.second) == it->second,
+			      "at", round, 3000);
+		}
+	}
+	std::cout << queries << " queries, " << reported << " points reported" << std::endl;
+
+	sjtu::range_map<std::string, double, int> names;
+	names.insert("b", 1.5, 1);
+	names.insert("a", 2.5, 2);
+	names.insert("c", 0.5, 3);
+	std::cout << names.count("a", "b", 1.0, 3.0) << " " << names.count("a", "z", 0.0, 1.0) << std::endl;
+	try {
+		names.at("q", 1);
+		check(false, "at absent", 0, 0);
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "at absent throws" << std::endl;
+	}
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
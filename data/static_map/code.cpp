@@ -0,0 +1,136 @@
+#include "static_map.hpp"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// static_map: lookups on a table built by the compiler checked with static_assert,
+// then the same table and larger runtime-built ones against a std::map, the
+// iterator's ends, at on absent keys and duplicate keys rejected at runtime
+
+constexpr auto table = sjtu::make_static_map<int, int>({{30, 3}, {10, 1}, {50, 5}, {20, 2}, {40, 4}});
+constexpr auto reversed = sjtu::make_static_map<char, int, std::greater<char> >({{'a', 1}, {'c', 3}, {'b', 2}});
+
+static_assert(table.size() == 5 && !table.empty(), "size");
+static_assert(table.at(10) == 1 && table.at(30) == 3 && table[50] == 5, "at");
+static_assert(table.count(20) == 1 && table.count(25) == 0 && table.count(0) == 0 && table.count(60) == 0, "count");
+static_assert(table.find(40)->second == 4 && table.find(45) == table.end(), "find");
+static_assert(table.lower_bound(25)->first == 30 && table.lower_bound(0) == table.begin(), "lower_bound");
+static_assert(table.lower_bound(60) == table.end(), "lower_bound past the end");
+static_assert(table.begin()->first == 10 && (*table.cbegin()).second == 1, "begin is the smallest key");
+static_assert(reversed.begin()->first == 'c' && reversed.at('b') == 2 && reversed.lower_bound('b')->second == 2, "descending order");
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << std::endl;
+		++failures;
+	}
+}
+
+template<class Map, class Ref>
+bool same(const Map &m, const Ref &ref) {
+	if (m.size() != ref.size()) return false;
+	typename Map::const_iterator it = m.begin();
+	for (typename Ref::const_iterator j = ref.begin(); j != ref.end(); ++j) {
+		if (it->first != j->first || it->second != j->second) return false;
+		++it;
+	}
+	if (it != m.end()) return false;
+	for (typename Ref::const_reverse_iterator j = ref.rbegin(); j != ref.rend(); ++j) {
+		--it;
+		if (it->first != j->first) return false;
+	}
+	return it == m.begin();
+}
+
+const int N = 500;
+
+int main() {
+	std::map<int, int> small;
+	for (int i = 1; i <= 5; ++i) small[i * 10] = i;
+	check(same(table, small), "constexpr table iterated at runtime");
+
+	// both ends of the iterator throw, and so does a default one
+	sjtu::static_map<int, int, 5>::const_iterator it = table.end();
+	try {
+		++it;
+		check(false, "++end");
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		*it;
+		check(false, "*end");
+	} catch (sjtu::invalid_iterator &) {}
+	it = table.begin();
+	try {
+		--it;
+		check(false, "--begin");
+	} catch (sjtu::invalid_iterator &) {}
+	check(it == table.begin() && it->first == 10, "begin unchanged after the throw");
+	it = sjtu::static_map<int, int, 5>::const_iterator();
+	try {
+		++it;
+		check(false, "++ on a default iterator");
+	} catch (sjtu::invalid_iterator &) {}
+	try {
+		table.at(25);
+		check(false, "at on an absent key");
+	} catch (sjtu::index_out_of_bound &) {}
+	try {
+		table[60];
+		check(false, "[] past the last key");
+	} catch (sjtu::index_out_of_bound &) {}
+
+	// built at runtime from shuffled keys, with a non-literal mapped type
+	std::mt19937 rng(83);
+	for (int round = 0; round < 50; ++round) {
+		std::map<int, std::string> ref;
+		while (ref.size() < size_t(N)) {
+			int key = rng() % 100000;
+			ref[key] = std::to_string(key);
+		}
+		std::vector<sjtu::static_map_entry<int, std::string> > entries;
+		for (std::map<int, std::string>::iterator j = ref.begin(); j != ref.end(); ++j) {
+			entries.push_back(sjtu::static_map_entry<int, std::string>(j->first, j->second));
+		}
+		std::shuffle(entries.begin(), entries.end(), rng);
+		sjtu::static_map_entry<int, std::string> init[N];
+		for (int i = 0; i < N; ++i) init[i] = entries[i];
+		sjtu::static_map<int, std::string, N> m(init);
+		check(same(m, ref), "runtime table");
+		bool good = true;
+		for (int q = 0; q < 2000; ++q) {
+			int key = rng() % 100001;
+			std::map<int, std::string>::iterator j = ref.find(key);
+			good = good && m.count(key) == (j != ref.end() ? 1u : 0u);
+			good = good && (j == ref.end() ? m.find(key) == m.end() : m.find(key)->second == j->second && m.at(key) == j->second);
+			std::map<int, std::string>::iterator lower = ref.lower_bound(key);
+			good = good && (lower == ref.end() ? m.lower_bound(key) == m.end() : m.lower_bound(key)->first == lower->first);
+		}
+		check(good, "runtime lookups");
+
+		// a repeated key anywhere in the list is rejected
+		int from = rng() % N, to = rng() % N;
+		init[to].first = init[from].first;
+		bool duplicated = false;
+		for (int i = 0; i < N && !duplicated; ++i) {
+			for (int j = i + 1; j < N && !duplicated; ++j) duplicated = init[i].first == init[j].first;
+		}
+		try {
+			sjtu::static_map<int, std::string, N> bad(init);
+			check(!duplicated, "duplicate key accepted");
+		} catch (sjtu::runtime_error &) {
+			check(duplicated, "distinct keys rejected");
+		}
+	}
+	try {
+		sjtu::make_static_map<int, int>({{1, 1}, {2, 2}, {1, 3}});
+		check(false, "duplicate key accepted");
+	} catch (sjtu::runtime_error &) {}
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
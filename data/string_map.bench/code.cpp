@@ -0,0 +1,45 @@
+#include "string_map.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <string>
+#include <vector>
+
+// heap bytes and lookup time of string_map against map<std::string, int> on
+// keys sharing long prefixes; timings go to stderr, the checks to stdout
+
+template<class Map>
+void run(const char *name, const std::vector<std::string> &keys) {
+	size_t before = mallinfo2().uordblks;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	long found = 0;
+	{
+		Map m;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			m[keys[i]] = static_cast<int>(i);
+		}
+		size_t after = mallinfo2().uordblks;
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < keys.size(); ++i) {
+			found += m.count(keys[i]);
+		}
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+		std::cerr << name << ": " << (after - before) / 1e6 << " MB, build "
+		          << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, lookups "
+		          << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms" << std::endl;
+		std::cout << name << " size " << m.size() << " found " << found << std::endl;
+	}
+}
+
+int main() {
+	std::vector<std::string> keys;
+	srand(1);
+	for (int i = 0; i < 500000; ++i) {
+		keys.push_back("/srv/data/customers/region-" + std::to_string(rand() % 8) + "/account/" +
+		               std::to_string(rand() % 100000) + "/events");
+	}
+	run<sjtu::string_map<int> >("string_map", keys);
+	run<sjtu::map<std::string, int> >("map", keys);
+	return 0;
+}
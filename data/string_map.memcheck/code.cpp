@@ -0,0 +1,153 @@
+#include "string_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+
+// string_map inserts and erases with allocations failing part way through: global
+// new is replaced by one that throws std::bad_alloc after a countdown. A failed
+// operation must leave the elements as they were and no value behind; build with
+// -fsanitize=address to check nothing leaks or is read after it is freed
+
+int allocationsLeft = -1;   // throw on the allocation after this many, if not negative
+
+void *operator new(size_t size) {
+	if (allocationsLeft == 0) {
+		throw std::bad_alloc();
+	}
+	if (allocationsLeft > 0) {
+		--allocationsLeft;
+	}
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+class Value {
+public:
+	static int live;
+	std::string text;
+
+	explicit Value(int v) : text(std::to_string(v) + std::string(30, '.')) {
+		++live;
+	}
+
+	Value(const Value &rhs) : text(rhs.text) {
+		++live;
+	}
+
+	Value &operator=(const Value &rhs) {
+		text = rhs.text;
+		return *this;
+	}
+
+	~Value() {
+		--live;
+	}
+};
+
+int Value::live = 0;
+
+std::string randomKey() {
+	static const char *prefixes[] = {"/usr/share/doc/", "/usr/lib/", "/var/log/app/", "", "\xff\xfe"};
+	std::string s = prefixes[rand() % 5];
+	int n = rand() % 6;
+	for (int i = 0; i < n; ++i) {
+		s += char('a' + rand() % 4);
+	}
+	if (rand() % 50 == 0) {
+		s += std::string(rand() % 300, 'q');
+	}
+	return s;
+}
+
+bool same(const sjtu::string_map<Value> &m, const std::map<std::string, std::string> &ref) {
+	if (m.size() != ref.size()) {
+		return false;
+	}
+	std::map<std::string, std::string>::const_iterator j = ref.begin();
+	for (sjtu::string_map<Value>::const_iterator i = m.cbegin(); i != m.cend(); ++i, ++j) {
+		if (i->first != j->first || i->second.text != j->second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	srand(81);
+	{
+		sjtu::string_map<Value> m;
+		std::map<std::string, std::string> ref;
+		bool ok = true;
+		int failedInserts = 0, failedErases = 0;
+		for (int step = 0; step < 60000 && ok; ++step) {
+			std::string k = randomKey();
+			Value v(step);
+			bool insert = rand() % 10 < 6;
+			sjtu::string_map<Value>::iterator it = m.find(k);
+			int countdown = rand() % 3 == 0 ? rand() % 8 : -1;
+			allocationsLeft = countdown;
+			try {
+				if (insert) {
+					m.insert(sjtu::string_map<Value>::value_type(k, v));
+				} else if (it != m.end()) {
+					m.erase(it);
+				}
+				allocationsLeft = -1;
+				if (insert) {
+					ref.insert(std::make_pair(k, v.text));
+				} else {
+					ref.erase(k);
+				}
+			} catch (std::bad_alloc &) {
+				allocationsLeft = -1;
+				++(insert ? failedInserts : failedErases);
+			}
+			ok = Value::live == static_cast<int>(ref.size()) + 1;
+			if (step % 500 == 0 || ref.size() < 3) {
+				ok = ok && same(m, ref);
+			}
+		}
+		std::cout << "random " << (ok && same(m, ref) ? "ok" : "WRONG") << ' '
+		          << (failedInserts > 0 ? "inserts failed" : "no insert failed") << ' '
+		          << (failedErases > 0 ? "erases failed" : "no erase failed") << std::endl;
+		// re-coding a page after erasing its first key takes an allocation per long key
+		while (!m.empty()) {
+			allocationsLeft = rand() % 2 ? rand() % 100 : -1;
+			try {
+				m.erase(m.begin());
+			} catch (std::bad_alloc &) {
+			}
+			allocationsLeft = -1;
+		}
+		std::cout << "drained " << m.page_count() << ' ' << Value::live << std::endl;
+		// a first insert into an empty map that fails leaves it empty
+		sjtu::string_map<Value>::value_type first("the first key, too long to be stored inline", Value(1));
+		int failed = 0;
+		for (int countdown = 0; m.empty(); ++countdown) {
+			allocationsLeft = countdown;
+			try {
+				m.insert(first);
+			} catch (std::bad_alloc &) {
+				allocationsLeft = -1;
+				failed += m.empty() && m.page_count() == 0 && m.begin() == m.end() && Value::live == 1;
+			}
+			allocationsLeft = -1;
+		}
+		std::cout << "failed first inserts " << failed << ", then " << m.size() << ' ' << m.page_count() << std::endl;
+	}
+	std::cout << "live after destruction " << Value::live << std::endl;
+	return 0;
+}
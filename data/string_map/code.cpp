@@ -0,0 +1,135 @@
+#include "string_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+// string_map against std::map, with values that count themselves, have no
+// default constructor and whose copies can be made to throw
+
+class Value {
+public:
+	static int live;
+	static int copiesLeft;   // throw on the copy after this many, if not negative
+	int val;
+
+	explicit Value(int v) : val(v) {
+		++live;
+	}
+
+	Value(const Value &rhs) : val(rhs.val) {
+		if (copiesLeft == 0) {
+			throw std::runtime_error("copy");
+		}
+		if (copiesLeft > 0) {
+			--copiesLeft;
+		}
+		++live;
+	}
+
+	Value &operator=(const Value &rhs) {
+		val = rhs.val;
+		return *this;
+	}
+
+	~Value() {
+		--live;
+	}
+};
+
+int Value::live = 0;
+int Value::copiesLeft = -1;
+
+std::string randomKey() {
+	static const char *prefixes[] = {"/usr/share/doc/", "/usr/lib/", "/var/log/app/", "", "\xff\xfe"};
+	std::string s = prefixes[rand() % 5];
+	if (rand() % 7 == 0) {
+		s += std::string("x\0y", 3);
+	}
+	int n = rand() % 6;
+	for (int i = 0; i < n; ++i) {
+		s += char('a' + rand() % 4);
+	}
+	if (rand() % 50 == 0) {
+		s += std::string(rand() % 3000, 'q');
+	}
+	return s;
+}
+
+bool same(const sjtu::string_map<Value> &m, const std::map<std::string, int> &ref) {
+	if (m.size() != ref.size()) {
+		return false;
+	}
+	std::map<std::string, int>::const_iterator j = ref.begin();
+	for (sjtu::string_map<Value>::const_iterator i = m.cbegin(); i != m.cend(); ++i, ++j) {
+		if (i->first != j->first || i->second.val != j->second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	srand(11);
+	{
+		sjtu::string_map<Value> m;
+		std::map<std::string, int> ref;
+		bool ok = true;
+		int thrown = 0;
+		for (int step = 0; step < 200000 && ok; ++step) {
+			std::string k = randomKey();
+			int op = rand() % 10;
+			if (op < 5) {
+				// now and then the copy of the new value, or one made while a page splits, throws
+				if (rand() % 100 == 0) {
+					Value::copiesLeft = rand() % 3;
+				}
+				try {
+					sjtu::pair<sjtu::string_map<Value>::iterator, bool> r =
+						m.insert(sjtu::string_map<Value>::value_type(k, Value(step)));
+					bool inserted = ref.insert(std::make_pair(k, step)).second;
+					ok = r.second == inserted && r.first->first == k && r.first->second.val == ref[k];
+				} catch (std::runtime_error &) {
+					++thrown;
+				}
+				Value::copiesLeft = -1;
+			} else if (op < 8) {
+				sjtu::string_map<Value>::iterator it = m.find(k);
+				ok = (it == m.end()) == (ref.count(k) == 0);
+				if (it != m.end()) {
+					m.erase(it);
+					ref.erase(k);
+				}
+			} else {
+				sjtu::string_map<Value>::iterator it = m.find(k);
+				if (it != m.end()) {
+					it->second.val += 1;
+					ref[k] += 1;
+				}
+			}
+			if (step % 5000 == 0) {
+				ok = ok && same(m, ref);
+			}
+		}
+		std::cout << "random " << (ok && same(m, ref) ? "ok" : "WRONG") << ' ' << m.size() << ' '
+		          << (thrown > 0 ? "threw" : "never threw") << std::endl;
+		std::cout << "live values " << (Value::live == static_cast<int>(m.size())) << std::endl;
+
+		sjtu::string_map<Value> copy(m);
+		std::cout << "copy " << same(copy, ref) << std::endl;
+		Value::copiesLeft = 100;
+		try {
+			sjtu::string_map<Value> failed(m);
+			std::cout << "copy did not throw" << std::endl;
+		} catch (std::runtime_error &) {
+			std::cout << "failed copy left " << (Value::live - 2 * static_cast<int>(m.size())) << std::endl;
+		}
+		Value::copiesLeft = -1;
+		while (!m.empty()) {
+			m.erase(m.begin());
+		}
+		std::cout << "drained pages " << m.page_count() << std::endl;
+	}
+	std::cout << "live after destruction " << Value::live << std::endl;
+	return 0;
+}
@@ -0,0 +1,64 @@
+#include "map.hpp"
+#include "thread_node_cache.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the ends of a thread's cache: a thread_local map constructed before the cache and
+// so destroyed after it, an object whose destructor builds a map once the cache is
+// gone, and maps built on one thread and destroyed on another. Build with
+// -fsanitize=address to check no block is used after it was handed on
+
+typedef sjtu::map<int, std::string, std::less<int>, sjtu::thread_cache_allocator> Map;
+
+std::atomic<int> late_ok(0);
+
+// constructed before the cache's first use, so destroyed after the cache
+struct late_user {
+	Map nodes;
+
+	~late_user() {
+		bool fine = nodes.size() == 500;
+		for (int i = 0; i < 500; i += 2) nodes.erase(nodes.find(i));
+		Map fresh;
+		for (int i = 0; i < 300; ++i) fresh[i] = std::string(30, 'x');
+		fresh.erase(fresh.find(7));
+		if (fine && nodes.size() == 250 && fresh.size() == 299) ++late_ok;
+	}
+};
+
+void fill_late(int seed) {
+	static thread_local late_user user;
+	for (int i = 0; i < 500; ++i) user.nodes[i] = std::to_string(seed * 1000 + i);
+}
+
+int main() {
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) threads.push_back(std::thread(fill_late, t));
+	for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+	std::cout << "destroyed after the cache " << late_ok.load() << std::endl;
+
+	// the blocks the exited threads gave back serve new threads
+	std::atomic<int> handed(0);
+	for (int pass = 0; pass < 20; ++pass) {
+		Map *built = nullptr;
+		std::thread producer([&built, pass]() {
+			built = new Map;
+			for (int i = 0; i < 2000; ++i) (*built)[i] = std::to_string(pass + i);
+		});
+		producer.join();
+		std::thread consumer([&built, &handed, pass]() {
+			bool fine = built->size() == 2000 && built->at(1999) == std::to_string(pass + 1999);
+			for (int i = 0; i < 2000; i += 3) built->erase(built->find(i));
+			Map own(*built);
+			delete built;
+			if (fine && own.size() == 1333) ++handed;
+		});
+		consumer.join();
+	}
+	std::cout << "destroyed on another thread " << handed.load() << std::endl;
+	std::cout << (late_ok.load() == 4 && handed.load() == 20 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
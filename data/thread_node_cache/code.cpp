@@ -0,0 +1,106 @@
+#include "map.hpp"
+#include "thread_node_cache.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// threads churning private maps over thread_cache_allocator, each against a
+// std::map, with node sizes in several size classes; then maps handed between
+// threads so nodes are freed by threads that did not allocate them
+
+typedef sjtu::map<int, long long, std::less<int>, sjtu::thread_cache_allocator> Small;
+typedef sjtu::map<long long, std::string, std::less<long long>, sjtu::thread_cache_allocator> Medium;
+
+const int THREADS = 4;
+
+template<class Map, class Ref>
+bool same(const Map &m, const Ref &ref) {
+	if (m.size() != ref.size()) return false;
+	typename Map::const_iterator it = m.cbegin();
+	for (typename Ref::const_iterator j = ref.begin(); j != ref.end(); ++j, ++it) {
+		if (it->first != j->first || it->second != j->second) return false;
+	}
+	return it == m.cend();
+}
+
+// several rounds of a private map built up and torn down, so magazines overflow to the depot and come back
+bool churn(unsigned seed) {
+	std::mt19937 rng(seed);
+	bool good = true;
+	for (int round = 0; round < 20; ++round) {
+		Small small;
+		Medium medium;
+		std::map<int, long long> smallRef;
+		std::map<long long, std::string> mediumRef;
+		int range = round % 2 ? 300 : 5000;
+		for (int op = 0; op < 10000; ++op) {
+			int key = rng() % range;
+			if (rng() % 3 != 0) {
+				small[key] = op;
+				smallRef[key] = op;
+				medium[key] = std::to_string(op);
+				mediumRef[key] = std::to_string(op);
+			} else {
+				Small::iterator it = small.find(key);
+				if (it != small.end()) small.erase(it);
+				smallRef.erase(key);
+				Medium::iterator jt = medium.find(key);
+				if (jt != medium.end()) medium.erase(jt);
+				mediumRef.erase(key);
+			}
+		}
+		good = good && same(small, smallRef) && same(medium, mediumRef);
+		if (round % 5 == 4) small.clear();
+	}
+	return good;
+}
+
+int main() {
+	std::vector<std::thread> threads;
+	std::vector<char> results(THREADS, 0);
+	for (int t = 0; t < THREADS; ++t) {
+		threads.push_back(std::thread([t, &results]() { results[t] = churn(88 + t); }));
+	}
+	for (int t = 0; t < THREADS; ++t) threads[t].join();
+	int good = 0;
+	for (int t = 0; t < THREADS; ++t) good += results[t];
+	std::cout << "private maps " << good << " of " << THREADS << std::endl;
+
+	// each thread builds a map and hands it to the next, which checks and erases it
+	std::vector<Small *> built(THREADS, nullptr);
+	for (int pass = 0; pass < 10; ++pass) {
+		threads.clear();
+		for (int t = 0; t < THREADS; ++t) {
+			threads.push_back(std::thread([t, pass, &built, &results]() {
+				Small *theirs = built[t];
+				built[t] = new Small;
+				for (int i = 0; i < 3000; ++i) (*built[t])[i * THREADS + t] = pass;
+				if (theirs != nullptr) {
+					bool fine = theirs->size() == 3000;
+					for (Small::const_iterator it = theirs->cbegin(); it != theirs->cend(); ++it) {
+						fine = fine && it->second == pass - 1;
+					}
+					for (int i = 0; i < 3000; i += 2) theirs->erase(theirs->find(i * THREADS + (t + THREADS - 1) % THREADS));
+					delete theirs;
+					results[t] = results[t] && fine;
+				}
+			}));
+		}
+		for (int t = 0; t < THREADS; ++t) threads[t].join();
+		// rotate, so every map is finished by a thread other than its builder
+		Small *last = built[THREADS - 1];
+		for (int t = THREADS - 1; t > 0; --t) built[t] = built[t - 1];
+		built[0] = last;
+	}
+	good = 0;
+	for (int t = 0; t < THREADS; ++t) {
+		good += results[t];
+		delete built[t];
+	}
+	std::cout << "handed over " << good << " of " << THREADS << std::endl;
+	std::cout << (good == THREADS ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
@@ -0,0 +1,50 @@
+#include "map.hpp"
+#include "ttl_map.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+// a session table of a million entries with a 1 to 30 minute lifetime, 1000 ticks
+// a second: sweeping it every second with ttl_map::expire against an erase_if scan
+// of a map of expiries every 20 seconds; timings go to stderr, the checks to stdout
+
+typedef sjtu::map<int, unsigned long long> Expiries;
+
+double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+	const int N = 1000000;
+	const unsigned long long SECOND = 1000, END = 1900 * SECOND;
+	sjtu::ttl_map<int, int> sessions;
+	Expiries expiries;
+	std::mt19937 rng(100);
+	for (int i = 0; i < N; ++i) {
+		unsigned long long expiry = SECOND * (60 + rng() % 1800);
+		sessions.insert(i, i, expiry, 0);
+		expiries.insert(Expiries::value_type(i, expiry));
+	}
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	size_t wheelRemoved = 0;
+	int wheelSweeps = 0;
+	for (unsigned long long now = SECOND; now <= END; now += SECOND, ++wheelSweeps) wheelRemoved += sessions.expire(now);
+	double wheelTime = since(t0);
+
+	t0 = std::chrono::steady_clock::now();
+	size_t scanRemoved = 0;
+	int scanSweeps = 0;
+	for (unsigned long long now = SECOND; now <= END; now += 20 * SECOND, ++scanSweeps) {
+		scanRemoved += expiries.erase_if([now](const Expiries::value_type &e) { return e.second <= now; });
+	}
+	scanRemoved += expiries.erase_if([END](const Expiries::value_type &e) { return e.second <= END; });
+	double scanTime = since(t0);
+
+	std::cerr << "timer wheel: " << wheelSweeps << " sweeps in " << wheelTime << " ms, " << wheelTime / wheelSweeps
+	          << " ms each; erase_if scan: " << scanSweeps << " sweeps in " << scanTime << " ms, "
+	          << scanTime / scanSweeps << " ms each" << std::endl;
+	std::cout << "expired " << wheelRemoved << " by the wheel, " << scanRemoved << " by scans, "
+	          << sessions.size() << " and " << expiries.size() << " left" << std::endl;
+	return 0;
+}
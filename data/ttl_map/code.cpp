@@ -0,0 +1,99 @@
+#include "ttl_map.hpp"
+#include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+
+// ttl_map against a std::map of (value, expiry) under random inserts, assigns,
+// touches, erases, lookups and jumps of time from a tick to 2^44, some rounds
+// starting near the top of the 64-bit clock
+
+typedef sjtu::ttl_map<int, int> Map;
+typedef unsigned long long time_type;
+typedef std::map<int, std::pair<int, time_type> > Ref;
+
+int failures = 0;
+
+void check(bool ok, const char *what, int round, int op) {
+	if (!ok) {
+		if (failures < 10) std::cout << "mismatch: " << what << " in round " << round << " at " << op << std::endl;
+		++failures;
+	}
+}
+
+int main() {
+	std::mt19937_64 rng(100);
+	size_t expired = 0;
+	for (int round = 0; round < 400; ++round) {
+		Map m;
+		Ref ref;
+		time_type now = rng() % 1000;
+		if (round % 4 == 3) now = ~0ULL - 5000 - rng() % 100000;
+		for (int op = 0; op < 2000; ++op) {
+			int kind = rng() % 14, key = rng() % 200;
+			time_type span = kind % 3 == 0 ? rng() % 70 : kind % 3 == 1 ? rng() % 5000 : rng() % 2 ? rng() % (1ULL << 40) : 0;
+			time_type expiry = now + span < now ? ~0ULL : now + span;
+			Ref::iterator it = ref.find(key);
+			bool live = it != ref.end() && now < it->second.second;
+			if (kind < 4) {
+				bool inserted = m.insert(key, op, expiry, now);
+				check(inserted != live, "insert", round, op);
+				if (inserted) ref[key] = std::make_pair(op, expiry);
+			} else if (kind < 5) {
+				m.assign(key, op, expiry);
+				ref[key] = std::make_pair(op, expiry);
+			} else if (kind < 6) {
+				bool touched = m.touch(key, expiry, now);
+				check(touched == live, "touch", round, op);
+				if (touched) {
+					it->second.second = expiry;
+				} else if (it != ref.end()) {
+					ref.erase(it);
+				}
+			} else if (kind < 7) {
+				check(m.erase(key) == ref.erase(key), "erase", round, op);
+			} else if (kind < 9) {
+				const Map &constMap = m;
+				check(constMap.count(key, now) == size_t(live), "const count", round, op);
+				check(m.count(key, now) == size_t(live), "count", round, op);
+				if (live) {
+					check(m.at(key, now) == it->second.first && m.expiry(key, now) == it->second.second, "at", round, op);
+				} else {
+					if (it != ref.end()) ref.erase(it);
+					try {
+						m.at(key, now);
+						check(false, "at dead", round, op);
+					} catch (sjtu::index_out_of_bound &) {}
+				}
+			} else {
+				time_type step = rng() % 20;
+				if (rng() % 4 == 0) {
+					int bits = rng() % 44;
+					step = rng() % (1ULL << bits);
+				}
+				now = now + step < now ? now : now + step;
+				if (rng() % 2) {
+					std::map<int, int> seen;
+					size_t removed = m.expire(now, [&seen](const int &k, const int &v) { seen[k] = v; });
+					size_t want = 0;
+					for (Ref::iterator j = ref.begin(); j != ref.end();) {
+						if (j->second.second <= now) {
+							++want;
+							check(seen.count(j->first) && seen[j->first] == j->second.first, "expired entry", round, op);
+							ref.erase(j++);
+						} else {
+							++j;
+						}
+					}
+					check(removed == want && seen.size() == want && m.size() == ref.size(), "expire", round, op);
+					expired += removed;
+				}
+			}
+		}
+		m.expire(~0ULL);
+		check(m.empty(), "expire all", round, 2000);
+	}
+	std::cout << expired << " entries expired" << std::endl;
+	std::cout << (failures == 0 ? "ok" : "FAILED") << std::endl;
+	return 0;
+}
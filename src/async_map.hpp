@@ -0,0 +1,324 @@
+/**
+* a map owned by one service thread, driven through a lock-free request queue
+*/
+#ifndef SJTU_ASYNC_MAP_HPP
+#define SJTU_ASYNC_MAP_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * async_map<Key, T> shares one sjtu::map between any number of threads without
+ *   locking it: callers enqueue requests into a bounded lock-free multi-producer
+ *   ring, and a single owner thread drains them in batches of up to batch_limit,
+ *   applying each batch with map::apply_batch, i.e. sorted by key in one finger
+ *   search pass. Requests on the same key take effect in the order they were enqueued.
+ * Every operation returns a std::future, or takes a callback that the owner thread
+ *   calls with the result; callbacks must be quick and must not wait on this map.
+ * If a copy of T throws, the batch is finished one op at a time, so every op still
+ *   gets its own result, and the op that threw gets the exception.
+ * Enqueueing into a full ring spins (yielding) until the owner makes room.
+ */
+template<class Key, class T, class Compare = std::less<Key> >
+class async_map {
+  public:
+   typedef map<Key, T, Compare> map_type;
+   typedef typename map_type::batch_op batch_op;
+
+   /**
+  * called with the result of a write (true if inserted / key was new / erased),
+  *   or of a lookup (true if found, then value points at a copy of the mapped value
+  *   as of the lookup, for the duration of the call).
+  * If the operation threw, the call is made inside a handler of the exception:
+  *   std::current_exception() returns it, result is false and value nullptr.
+    */
+   typedef std::function<void(bool result, const T *value)> callback_type;
+
+  private:
+   struct request : batch_op {
+       bool has_value;
+       // the value to write, or the copy a lookup found
+       typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+       std::exception_ptr error;
+       callback_type done;
+       request(typename map_type::batch_kind kind, const Key &key, const T *v, const callback_type &cb)
+           : batch_op(kind, key), has_value(false), done(cb) {
+           if (v != nullptr) {
+               batch_op::value = new (&value) T(*v);
+               has_value = true;
+           }
+           if (kind == map_type::batch_find) this->on_found = &request::copyFound;
+       }
+       ~request() {
+           if (has_value) reinterpret_cast<T *>(&value)->~T();
+       }
+
+       // during the pass, before a later op of the batch can erase or overwrite it
+       static void copyFound(batch_op &op, const T &found) {
+           request &r = static_cast<request &>(op);
+           r.batch_op::value = new (&r.value) T(found);
+           r.has_value = true;
+       }
+   };
+
+   // Vyukov's bounded queue: a cell is free for the producer of ticket t when its
+   //   sequence is t, and holds that producer's request once it is t + 1.
+   // Requests are built inside the cells, and the owner hands a cell back only
+   //   after its batch is done, so a request costs no allocation.
+   struct cell {
+       std::atomic<size_t> sequence;
+       bool valid;   // false if building the request threw
+       typename std::aligned_storage<sizeof(request), alignof(request)>::type storage;
+
+       request *item() {
+           return reinterpret_cast<request *>(&storage);
+       }
+   };
+
+   map_type data;
+   cell *ring;
+   size_t mask;
+   size_t batch_limit;
+   std::atomic<size_t> enqueue_pos;
+   size_t dequeue_pos;   // owner thread only
+
+   std::atomic<bool> sleeping;
+   std::atomic<bool> stopping;
+   std::mutex wake_lock;
+   std::condition_variable wake;
+   std::thread owner;
+
+   void submit(typename map_type::batch_kind kind, const Key &key, const T *value, const callback_type &done) {
+       cell *c;
+       size_t pos;
+       while (true) {
+           pos = enqueue_pos.load(std::memory_order_relaxed);
+           c = &ring[pos & mask];
+           size_t seq = c->sequence.load(std::memory_order_acquire);
+           if (seq == pos) {
+               if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+           } else if (seq < pos) {
+               // full: the owner has not consumed this lap yet
+               std::this_thread::yield();
+           }
+       }
+       // the ticket is taken, so the cell must be published even if building fails
+       try {
+           new (&c->storage) request(kind, key, value, done);
+           c->valid = true;
+       } catch (...) {
+           c->valid = false;
+           publish(c, pos);
+           throw;
+       }
+       publish(c, pos);
+   }
+
+   void publish(cell *c, size_t pos) {
+       c->sequence.store(pos + 1, std::memory_order_release);
+       // pairs with the fence in serve: either the owner sees the request or we see it asleep
+       std::atomic_thread_fence(std::memory_order_seq_cst);
+       if (sleeping.load()) {
+           std::lock_guard<std::mutex> guard(wake_lock);
+           wake.notify_one();
+       }
+   }
+
+   bool ready(size_t pos) const {
+       return ring[pos & mask].sequence.load(std::memory_order_acquire) == pos + 1;
+   }
+
+   void serve() {
+       batch_op **ops = new batch_op*[batch_limit];
+       while (true) {
+           size_t n = 0, count = 0;
+           while (count < batch_limit && ready(dequeue_pos + count)) {
+               cell &c = ring[(dequeue_pos + count++) & mask];
+               if (c.valid) ops[n++] = c.item();
+           }
+           if (count == 0) {
+               if (stopping.load()) break;
+               std::unique_lock<std::mutex> guard(wake_lock);
+               sleeping.store(true);
+               std::atomic_thread_fence(std::memory_order_seq_cst);
+               if (!ready(dequeue_pos) && !stopping.load()) {
+                   wake.wait_for(guard, std::chrono::milliseconds(10));
+               }
+               sleeping.store(false);
+               continue;
+           }
+           try {
+               data.apply_batch(ops, n);
+           } catch (...) {
+               // a throwing copy of T: the map stays consistent, and the ops the pass did
+               //   not get to are applied one at a time, in enqueue order, which keeps the
+               //   order of ops on the same key
+               for (size_t i = 0; i < n; ++i) {
+                   if (ops[i]->applied) continue;
+                   try {
+                       data.apply_batch(ops + i, 1);
+                   } catch (...) {
+                       static_cast<request *>(ops[i])->error = std::current_exception();
+                   }
+               }
+           }
+           for (size_t i = 0; i < count; ++i, ++dequeue_pos) {
+               cell &c = ring[dequeue_pos & mask];
+               if (c.valid) {
+                   request *r = c.item();
+                   if (r->done) {
+                       try {
+                           if (r->error) {
+                               try {
+                                   std::rethrow_exception(r->error);
+                               } catch (...) {
+                                   r->done(false, nullptr);
+                               }
+                           } else {
+                               r->done(r->result, r->kind == map_type::batch_find ? r->batch_op::value : nullptr);
+                           }
+                       } catch (...) {
+                       }
+                   }
+                   r->~request();
+               }
+               c.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+           }
+       }
+       delete[] ops;
+   }
+
+   template<class Result>
+   static callback_type fulfil(std::shared_ptr<std::promise<Result> > promise) {
+       return [promise](bool result, const T *) {
+           if (std::current_exception()) {
+               promise->set_exception(std::current_exception());
+           } else {
+               promise->set_value(static_cast<Result>(result));
+           }
+       };
+   }
+
+  public:
+   /**
+  * start the owner thread; capacity is rounded up to a power of two,
+  *   and a batch takes at most half of it.
+    */
+   explicit async_map(size_t capacity = 4096, size_t batch_limit_ = 256)
+       : ring(nullptr), mask(0), batch_limit(batch_limit_),
+         enqueue_pos(0), dequeue_pos(0), sleeping(false), stopping(false) {
+       size_t size = 2;
+       while (size < capacity) size <<= 1;
+       ring = new cell[size];
+       mask = size - 1;
+       // a batch holds its cells until it is done, leave room for producers
+       if (batch_limit == 0 || batch_limit > size / 2) batch_limit = size / 2;
+       for (size_t i = 0; i < size; ++i) {
+           ring[i].sequence.store(i, std::memory_order_relaxed);
+       }
+       owner = std::thread(&async_map::serve, this);
+   }
+
+   async_map(const async_map &) = delete;
+   async_map &operator=(const async_map &) = delete;
+
+   /**
+  * completes every request enqueued before, then stops the owner thread.
+    */
+   ~async_map() {
+       stopping.store(true);
+       {
+           std::lock_guard<std::mutex> guard(wake_lock);
+           wake.notify_one();
+       }
+       owner.join();
+       delete[] ring;
+   }
+
+   void insert(const Key &key, const T &value, callback_type done) {
+       submit(map_type::batch_insert, key, &value, done);
+   }
+
+   /**
+  * true if (key, value) was inserted, false if key was present.
+    */
+   std::future<bool> insert(const Key &key, const T &value) {
+       std::shared_ptr<std::promise<bool> > promise(new std::promise<bool>);
+       std::future<bool> result = promise->get_future();
+       insert(key, value, fulfil(promise));
+       return result;
+   }
+
+   void assign(const Key &key, const T &value, callback_type done) {
+       submit(map_type::batch_assign, key, &value, done);
+   }
+
+   /**
+  * insert or overwrite; true if key was new.
+    */
+   std::future<bool> assign(const Key &key, const T &value) {
+       std::shared_ptr<std::promise<bool> > promise(new std::promise<bool>);
+       std::future<bool> result = promise->get_future();
+       assign(key, value, fulfil(promise));
+       return result;
+   }
+
+   void erase(const Key &key, callback_type done) {
+       submit(map_type::batch_erase, key, nullptr, done);
+   }
+
+   /**
+  * true if key existed.
+    */
+   std::future<bool> erase(const Key &key) {
+       std::shared_ptr<std::promise<bool> > promise(new std::promise<bool>);
+       std::future<bool> result = promise->get_future();
+       erase(key, fulfil(promise));
+       return result;
+   }
+
+   void find(const Key &key, callback_type done) {
+       submit(map_type::batch_find, key, nullptr, done);
+   }
+
+   /**
+  * a copy of the mapped value of key; the future throws index_out_of_bound if absent.
+    */
+   std::future<T> at(const Key &key) {
+       std::shared_ptr<std::promise<T> > promise(new std::promise<T>);
+       std::future<T> result = promise->get_future();
+       find(key, [promise](bool found, const T *value) {
+           if (std::current_exception()) {
+               promise->set_exception(std::current_exception());
+           } else if (found) {
+               promise->set_value(*value);
+           } else {
+               promise->set_exception(std::make_exception_ptr(index_out_of_bound()));
+           }
+       });
+       return result;
+   }
+
+   std::future<size_t> count(const Key &key) {
+       std::shared_ptr<std::promise<size_t> > promise(new std::promise<size_t>);
+       std::future<size_t> result = promise->get_future();
+       find(key, fulfil(promise));
+       return result;
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+/**
+* node storage for map carved out of 2 MB regions backed by transparent huge pages
+*/
+#ifndef SJTU_HUGE_PAGE_ARENA_HPP
+#define SJTU_HUGE_PAGE_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#if defined(__unix__)
+#include <sys/mman.h>
+#endif
+
+namespace sjtu {
+
+/**
+ * a process-wide arena for small fixed-size blocks such as map nodes.
+ * Memory is reserved in 2 MB regions aligned to 2 MB and advised with
+ *   madvise(MADV_HUGEPAGE), so the kernel can back each one with a single
+ *   huge page and a tree of millions of nodes needs few dTLB entries.
+ *   Where THP is disabled or unsupported, the regions are ordinary pages
+ *   and everything else works the same.
+ * Blocks are handed out by bumping through the current region and are
+ *   recycled through per-size free lists; regions are never returned to the
+ *   system. Blocks larger than MAX_BLOCK go to global new.
+ * All members are trivially destructible, so maps destroyed during static
+ *   destruction can still return their nodes.
+ * There is one arena per process, so used_bytes() and the other counters sum
+ *   over every map using huge_page_allocator, not over any one tree.
+ */
+class huge_page_arena {
+  public:
+   static const size_t REGION_SIZE = size_t(2) << 20;
+   static const size_t GRANULE = 16;
+   static const size_t MAX_BLOCK = 1024;
+
+  private:
+   static const size_t CLASS_COUNT = MAX_BLOCK / GRANULE;
+
+   struct free_block {
+       free_block *next;
+   };
+
+   std::atomic_flag busy;
+   free_block *free_lists[CLASS_COUNT];
+   char *cursor, *limit;       // unused tail of the current region
+   char *regions[4096];        // for huge_page_bytes; regions past the cap are just not counted
+   size_t region_count;
+   size_t advised_count;
+   size_t used;
+
+   huge_page_arena() : cursor(nullptr), limit(nullptr), region_count(0), advised_count(0), used(0) {
+       busy.clear();
+       for (size_t i = 0; i < CLASS_COUNT; ++i) free_lists[i] = nullptr;
+   }
+
+   void acquire() {
+       while (busy.test_and_set(std::memory_order_acquire)) {
+       }
+   }
+
+   void release() {
+       busy.clear(std::memory_order_release);
+   }
+
+   // a fresh aligned region, or throws std::bad_alloc
+   char *reserveRegion() {
+#if defined(__unix__)
+       // over-map by one region and trim both ends to get 2 MB alignment
+       void *raw = mmap(nullptr, 2 * REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+       if (raw == MAP_FAILED) throw std::bad_alloc();
+       char *start = static_cast<char *>(raw);
+       char *aligned = reinterpret_cast<char *>((reinterpret_cast<size_t>(start) + REGION_SIZE - 1) & ~(REGION_SIZE - 1));
+       if (aligned != start) munmap(start, aligned - start);
+       munmap(aligned + REGION_SIZE, start + 2 * REGION_SIZE - (aligned + REGION_SIZE));
+#if defined(MADV_HUGEPAGE)
+       if (madvise(aligned, REGION_SIZE, MADV_HUGEPAGE) == 0) ++advised_count;
+#endif
+       return aligned;
+#else
+       return static_cast<char *>(::operator new(REGION_SIZE));
+#endif
+   }
+
+  public:
+   huge_page_arena(const huge_page_arena &) = delete;
+   huge_page_arena &operator=(const huge_page_arena &) = delete;
+
+   static huge_page_arena &instance() {
+       static huge_page_arena arena;
+       return arena;
+   }
+
+   void *allocate(size_t size) {
+       if (size > MAX_BLOCK) return ::operator new(size);
+       size_t index = (size + GRANULE - 1) / GRANULE - 1;
+       size_t rounded = (index + 1) * GRANULE;
+       acquire();
+       free_block *block = free_lists[index];
+       if (block != nullptr) {
+           free_lists[index] = block->next;
+           used += rounded;
+           release();
+           return block;
+       }
+       if (static_cast<size_t>(limit - cursor) < rounded) {
+           // the tail of the old region is simply left unused
+           try {
+               cursor = reserveRegion();
+           } catch (...) {
+               release();
+               throw;
+           }
+           limit = cursor + REGION_SIZE;
+           if (region_count < sizeof(regions) / sizeof(regions[0])) regions[region_count] = cursor;
+           ++region_count;
+       }
+       void *p = cursor;
+       cursor += rounded;
+       used += rounded;
+       release();
+       return p;
+   }
+
+   void deallocate(void *p, size_t size) {
+       if (size > MAX_BLOCK) {
+           ::operator delete(p);
+           return;
+       }
+       size_t index = (size + GRANULE - 1) / GRANULE - 1;
+       free_block *block = static_cast<free_block *>(p);
+       acquire();
+       block->next = free_lists[index];
+       free_lists[index] = block;
+       used -= (index + 1) * GRANULE;
+       release();
+   }
+
+   /**
+  * bytes currently handed out, rounded up to the block sizes.
+    */
+   size_t used_bytes() {
+       acquire();
+       size_t result = used;
+       release();
+       return result;
+   }
+
+   /**
+  * bytes of regions reserved, and of those the kernel accepted MADV_HUGEPAGE for.
+    */
+   size_t reserved_bytes() {
+       acquire();
+       size_t result = region_count * REGION_SIZE;
+       release();
+       return result;
+   }
+
+   size_t advised_bytes() {
+       acquire();
+       size_t result = advised_count * REGION_SIZE;
+       release();
+       return result;
+   }
+
+   /**
+  * bytes of the arena the kernel actually backs with huge pages right now,
+  *   summed from the AnonHugePages lines of /proc/self/smaps (0 where unavailable).
+  * Reads a proc file, so it is for monitoring, not for hot paths.
+    */
+   size_t huge_page_bytes() {
+       acquire();
+       size_t count = region_count < sizeof(regions) / sizeof(regions[0]) ? region_count : sizeof(regions) / sizeof(regions[0]);
+       char *mine[sizeof(regions) / sizeof(regions[0])];
+       for (size_t i = 0; i < count; ++i) mine[i] = regions[i];
+       release();
+
+       size_t total = 0;
+       FILE *smaps = fopen("/proc/self/smaps", "r");
+       if (smaps == nullptr) return 0;
+       char line[512];
+       size_t lo = 0, hi = 0;   // the mapping the following fields belong to
+       while (fgets(line, sizeof(line), smaps) != nullptr) {
+           unsigned long start, end, kb;
+           if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+               lo = start;
+               hi = end;
+           } else if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 && kb > 0) {
+               // a mapping may span several adjacent regions; count the huge pages inside ours
+               size_t ours = 0;
+               for (size_t i = 0; i < count; ++i) {
+                   size_t r = reinterpret_cast<size_t>(mine[i]);
+                   if (r >= lo && r + REGION_SIZE <= hi) ours += REGION_SIZE;
+               }
+               size_t reported = kb * 1024;
+               total += reported < ours ? reported : ours;
+           }
+       }
+       fclose(smaps);
+       return total;
+   }
+};
+
+/**
+ * the map storage policy over huge_page_arena:
+ *   sjtu::map<Key, T, std::less<Key>, sjtu::huge_page_allocator>.
+ */
+struct huge_page_allocator {
+   static void *allocate(size_t size) {
+       return huge_page_arena::instance().allocate(size);
+   }
+
+   static void deallocate(void *p, size_t size) {
+       huge_page_arena::instance().deallocate(p, size);
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+/**
+* string interning for maps keyed by strings drawn from a small vocabulary
+*/
+#ifndef SJTU_INTERNED_STRING_HPP
+#define SJTU_INTERNED_STRING_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include "map.hpp"
+
+namespace sjtu {
+
+class interned_string;
+
+/**
+ * stores every distinct string once and hands out interned_string handles to it.
+ * Pooled strings live in the nodes of an sjtu::map, which never move,
+ *   so a handle stays valid for the lifetime of its pool.
+ * Each string gets a stable id, its rank in order of first interning.
+ * intern, find, contains and size lock the pool, so threads may share one; reading
+ *   through a handle needs no lock since pooled strings are never modified.
+ * Interning is permanent: look up strings that may be absent with find or contains,
+ *   which never add to the pool.
+ */
+class string_pool {
+  public:
+   typedef map<std::string, unsigned> table_type;
+   typedef table_type::value_type entry_type;
+
+  private:
+   table_type table;
+   mutable std::mutex lock;
+
+  public:
+   string_pool() {}
+
+   string_pool(const string_pool &) = delete;
+   string_pool &operator=(const string_pool &) = delete;
+
+   /**
+  * the handle of s, adding s to the pool if it is not there yet.
+    */
+   interned_string intern(const std::string &s);
+
+   /**
+  * set handle to the handle of s and return true if s has been interned;
+  *   otherwise return false and leave both the pool and handle alone.
+    */
+   bool find(const std::string &s, interned_string &handle) const;
+
+   /**
+  * whether s has been interned, without adding it.
+    */
+   bool contains(const std::string &s) const {
+       std::lock_guard<std::mutex> guard(lock);
+       return table.count(s) != 0;
+   }
+
+   size_t size() const {
+       std::lock_guard<std::mutex> guard(lock);
+       return table.size();
+   }
+
+   /**
+  * the pool used by interned_string's constructors from strings.
+    */
+   static string_pool &global() {
+       static string_pool pool;
+       return pool;
+   }
+};
+
+/**
+ * an 8-byte handle to a pooled string, usable as a map key.
+ * Handles from the same pool are equal exactly when they point to the same entry,
+ *   so equality is a pointer compare; ordering compares the pooled strings.
+ * Handles from different pools still order and compare by content.
+ * Constructing one from a string interns it, so the constructors are explicit:
+ *   a lookup by a plain string must not grow the pool behind the caller's back.
+ */
+class interned_string {
+  private:
+   const string_pool::entry_type *entry;
+
+   explicit interned_string(const string_pool::entry_type *e) : entry(e) {}
+
+   // "" in the global pool, interned by the first default constructor only
+   static const string_pool::entry_type *emptyEntry() {
+       static const string_pool::entry_type *empty = string_pool::global().intern(std::string()).entry;
+       return empty;
+   }
+
+   friend class string_pool;
+   friend bool same_key(const interned_string &a, const interned_string &b);
+
+  public:
+   interned_string() : entry(emptyEntry()) {}
+
+   explicit interned_string(const std::string &s) : entry(string_pool::global().intern(s).entry) {}
+
+   explicit interned_string(const char *s) : entry(string_pool::global().intern(std::string(s)).entry) {}
+
+   const std::string &str() const {
+       return entry->first;
+   }
+
+   /**
+  * stable id of the string within its pool.
+    */
+   unsigned id() const {
+       return entry->second;
+   }
+
+   bool operator==(const interned_string &rhs) const {
+       return entry == rhs.entry || entry->first == rhs.entry->first;
+   }
+
+   bool operator!=(const interned_string &rhs) const {
+       return !(*this == rhs);
+   }
+
+   bool operator<(const interned_string &rhs) const {
+       return entry != rhs.entry && entry->first < rhs.entry->first;
+   }
+};
+
+inline interned_string string_pool::intern(const std::string &s) {
+   std::lock_guard<std::mutex> guard(lock);
+   pair<table_type::iterator, bool> result = table.insert(entry_type(s, static_cast<unsigned>(table.size())));
+   return interned_string(&*result.first);
+}
+
+inline bool string_pool::find(const std::string &s, interned_string &handle) const {
+   std::lock_guard<std::mutex> guard(lock);
+   table_type::const_iterator it = table.find(s);
+   if (it == table.cend()) return false;
+   handle = interned_string(&*it);
+   return true;
+}
+
+/**
+ * same pooled entry means same key, so map lookups stop without comparing characters.
+ */
+inline bool same_key(const interned_string &a, const interned_string &b) {
+   return a.entry == b.entry;
+}
+
+}
+
+#endif
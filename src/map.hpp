@@ -7,15 +7,96 @@
 // only for std::less<T>
 #include <functional>
 #include <cstddef>
+#include <cmath>
 #include "utility.hpp"
 #include "exceptions.hpp"
 
 namespace sjtu {
 
+/**
+ * key identity hook for map lookups.
+ * Key types that can tell two keys are the same more cheaply than by ordering
+ *   (e.g. interned_string, a pointer compare) overload this in namespace sjtu;
+ *   findNode tries it before falling back to Compare.
+ */
+template<class Key>
+inline bool same_key(const Key &, const Key &) {
+   return false;
+}
+
+/**
+ * three-way comparison hook for map descents: negative, zero or positive as a
+ *   orders before, equivalent to or after b under comp.
+ * The default asks comp up to twice. Key types that order in one pass overload it
+ *   for their Compare, found by argument-dependent lookup (Util::Bint does for
+ *   std::less, see data/class-bint.hpp), and every node visit costs one comparison.
+ */
+template<class Key, class Compare>
+inline int compare_keys(const Compare &comp, const Key &a, const Key &b) {
+   if (comp(a, b)) return -1;
+   return comp(b, a) ? 1 : 0;
+}
+
+/**
+ * the default node storage policy of map: plain global new and delete.
+ * A policy is a class with
+ *   static void *allocate(size_t size);
+ *   static void deallocate(void *p, size_t size);
+ *   and every node of a map<Key, T, Compare, Alloc> is obtained from and returned to it
+ *   (see huge_page_arena.hpp for one backed by huge pages).
+ */
+struct node_allocator {
+   static void *allocate(size_t size) {
+       return ::operator new(size);
+   }
+
+   static void deallocate(void *p, size_t) {
+       ::operator delete(p);
+   }
+};
+
+/**
+ * the default weight policy of map: elements weigh nothing and nodes carry no weight sum.
+ * A weight policy is a class with
+ *   typedef ... weight_type;   (an arithmetic type)
+ *   template<class Value> static weight_type weight(const Value &element);
+ *   and every node of a map<Key, T, Compare, Alloc, Weight> caches the total weight of
+ *   its subtree, which sample_weighted descends by. Weights must not be negative.
+ */
+struct unweighted {};
+
+/**
+ * a weight policy weighing every element by its mapped value, converted to W.
+ * A map with it must hear of every change to a mapped value: map.reweigh(it).
+ */
+template<class W>
+struct mapped_value_weight {
+   typedef W weight_type;
+
+   template<class Value>
+   static W weight(const Value &element) {
+       return static_cast<W>(element.second);
+   }
+};
+
+// the cached subtree weight a node carries under a weight policy; none when unweighted
+template<class Weight>
+struct subtree_weight {
+   static const bool enabled = true;
+   typename Weight::weight_type weight_sum;
+};
+
+template<>
+struct subtree_weight<unweighted> {
+   static const bool enabled = false;
+};
+
 template<
    class Key,
    class T,
-   class Compare = std::less <Key>
+   class Compare = std::less <Key>,
+   class Alloc = node_allocator,
+   class Weight = unweighted
    > class map {
   public:
    /**
@@ -27,19 +108,69 @@ template<
 
   private:
    // Red-Black Tree node structure
-   struct Node {
+   struct Node : subtree_weight<Weight> {
        value_type data;
        Node *left, *right, *parent;
+       // nodes in this subtree, for rank and select; 32 bits (so below 2^32 elements)
+       //   keep a small node in the allocator size class it had without the count
+       unsigned int size;
        bool color; // true for red, false for black
 
        Node(const value_type &val, Node *p = nullptr)
-           : data(val), left(nullptr), right(nullptr), parent(p), color(true) {}
+           : data(val), left(nullptr), right(nullptr), parent(p), size(1), color(true) {}
+
+       // every new Node / delete node goes through the storage policy
+       static void *operator new(size_t size) {
+           return Alloc::allocate(size);
+       }
+
+       static void operator delete(void *p, size_t size) {
+           Alloc::deallocate(p, size);
+       }
    };
 
    Node *root;
+   // the first and last nodes in key order, nullptr when empty
+   Node *leftmost, *rightmost;
    size_t tree_size;
    Compare comp;
 
+   static unsigned int sizeOf(const Node *node) {
+       return node == nullptr ? 0 : node->size;
+   }
+
+   template<class W>
+   static typename W::weight_type weightOf(const Node *node, W *) {
+       return node == nullptr ? typename W::weight_type() : node->weight_sum;
+   }
+
+   // recompute node's cached weight from its own and its children's
+   static void pullWeight(Node *, unweighted *) {}
+
+   template<class W>
+   static void pullWeight(Node *node, W *) {
+       node->weight_sum = W::weight(node->data) + weightOf(node->left, static_cast<W *>(nullptr)) +
+                          weightOf(node->right, static_cast<W *>(nullptr));
+   }
+
+   static void pullWeight(Node *node) {
+       pullWeight(node, static_cast<Weight *>(nullptr));
+   }
+
+   // recompute node's subtree size and weight from its children's
+   static void pullNode(Node *node) {
+       node->size = 1 + sizeOf(node->left) + sizeOf(node->right);
+       pullWeight(node);
+   }
+
+   // pullWeight from node up to the root, after node's subtree changed
+   static void pullWeights(Node *node) {
+       if (!subtree_weight<Weight>::enabled) return;
+       for (; node != nullptr; node = node->parent) {
+           pullWeight(node);
+       }
+   }
+
    // Helper functions for Red-Black Tree operations
    void leftRotate(Node *x) {
        Node *y = x->right;
@@ -57,6 +188,10 @@ template<
        }
        y->left = x;
        x->parent = y;
+       y->size = x->size;
+       x->size = 1 + sizeOf(x->left) + sizeOf(x->right);
+       pullWeight(x);
+       pullWeight(y);
    }
 
    void rightRotate(Node *x) {
@@ -75,6 +210,10 @@ template<
        }
        y->right = x;
        x->parent = y;
+       y->size = x->size;
+       x->size = 1 + sizeOf(x->left) + sizeOf(x->right);
+       pullWeight(x);
+       pullWeight(y);
    }
 
    void fixInsert(Node *z) {
@@ -129,56 +268,59 @@ template<
        }
    }
 
-   void fixDelete(Node *x) {
+   // x may be nullptr, so its parent is passed explicitly
+   void fixDelete(Node *x, Node *xParent) {
        while (x != root && (x == nullptr || !x->color)) {
-           if (x == x->parent->left) {
-               Node *w = x->parent->right;
+           if (x == xParent->left) {
+               Node *w = xParent->right;
                if (w->color) {
                    w->color = false;
-                   x->parent->color = true;
-                   leftRotate(x->parent);
-                   w = x->parent->right;
+                   xParent->color = true;
+                   leftRotate(xParent);
+                   w = xParent->right;
                }
                if ((w->left == nullptr || !w->left->color) &&
                    (w->right == nullptr || !w->right->color)) {
                    w->color = true;
-                   x = x->parent;
+                   x = xParent;
+                   xParent = x->parent;
                } else {
                    if (w->right == nullptr || !w->right->color) {
                        if (w->left != nullptr) w->left->color = false;
                        w->color = true;
                        rightRotate(w);
-                       w = x->parent->right;
+                       w = xParent->right;
                    }
-                   w->color = x->parent->color;
-                   x->parent->color = false;
+                   w->color = xParent->color;
+                   xParent->color = false;
                    if (w->right != nullptr) w->right->color = false;
-                   leftRotate(x->parent);
+                   leftRotate(xParent);
                    x = root;
                }
            } else {
-               Node *w = x->parent->left;
+               Node *w = xParent->left;
                if (w->color) {
                    w->color = false;
-                   x->parent->color = true;
-                   rightRotate(x->parent);
-                   w = x->parent->left;
+                   xParent->color = true;
+                   rightRotate(xParent);
+                   w = xParent->left;
                }
                if ((w->right == nullptr || !w->right->color) &&
                    (w->left == nullptr || !w->left->color)) {
                    w->color = true;
-                   x = x->parent;
+                   x = xParent;
+                   xParent = x->parent;
                } else {
                    if (w->left == nullptr || !w->left->color) {
                        if (w->right != nullptr) w->right->color = false;
                        w->color = true;
                        leftRotate(w);
-                       w = x->parent->left;
+                       w = xParent->left;
                    }
-                   w->color = x->parent->color;
-                   x->parent->color = false;
+                   w->color = xParent->color;
+                   xParent->color = false;
                    if (w->left != nullptr) w->left->color = false;
-                   rightRotate(x->parent);
+                   rightRotate(xParent);
                    x = root;
                }
            }
@@ -189,9 +331,13 @@ template<
    Node* findNode(const Key &key) const {
        Node *current = root;
        while (current != nullptr) {
-           if (comp(key, current->data.first)) {
+           if (same_key(key, current->data.first)) {
+               return current;
+           }
+           int order = compare_keys(comp, key, current->data.first);
+           if (order < 0) {
                current = current->left;
-           } else if (comp(current->data.first, key)) {
+           } else if (order > 0) {
                current = current->right;
            } else {
                return current;
@@ -200,6 +346,20 @@ template<
        return nullptr;
    }
 
+   // first node whose key is not less than key (strict: greater than key)
+   Node* boundNode(const Key &key, bool strict) const {
+       Node *current = root, *result = nullptr;
+       while (current != nullptr) {
+           if (strict ? comp(key, current->data.first) : !comp(current->data.first, key)) {
+               result = current;
+               current = current->left;
+           } else {
+               current = current->right;
+           }
+       }
+       return result;
+   }
+
    Node* minimum(Node *node) const {
        while (node != nullptr && node->left != nullptr) {
            node = node->left;
@@ -225,11 +385,422 @@ template<
        if (node == nullptr) return nullptr;
        Node *newNode = new Node(node->data, parent);
        newNode->color = node->color;
+       newNode->size = node->size;
        newNode->left = copyTree(node->left, newNode);
        newNode->right = copyTree(node->right, newNode);
+       pullWeight(newNode);
+       return newNode;
+   }
+
+   // link a new node below parent (nullptr for an empty tree) and rebalance
+   Node* insertAt(const value_type &value, Node *parent, bool asLeft) {
+       Node *newNode = new Node(value, parent);
+       if (parent == nullptr) {
+           root = leftmost = rightmost = newNode;
+       } else if (asLeft) {
+           parent->left = newNode;
+           if (parent == leftmost) leftmost = newNode;
+       } else {
+           parent->right = newNode;
+           if (parent == rightmost) rightmost = newNode;
+       }
+       for (Node *p = parent; p != nullptr; p = p->parent) {
+           ++p->size;
+       }
+       pullWeights(newNode);
+       fixInsert(newNode);
+       tree_size++;
        return newNode;
    }
 
+   void eraseNode(Node *z) {
+       // O(1): an extreme's neighbour is its parent or its only child, a red leaf
+       if (z == leftmost) leftmost = const_cast<Node *>(successor(z));
+       if (z == rightmost) rightmost = predecessor(z);
+       Node *y = z;
+       Node *x = nullptr;
+       Node *xParent = nullptr;
+       bool y_original_color = y->color;
+
+       // the node unlinked from its place is z, or its successor when z has two children
+       Node *unlinked = z->left != nullptr && z->right != nullptr ? minimum(z->right) : z;
+       for (Node *p = unlinked->parent; p != nullptr; p = p->parent) {
+           --p->size;
+       }
+
+       if (z->left == nullptr) {
+           x = z->right;
+           xParent = z->parent;
+           transplant(z, z->right);
+       } else if (z->right == nullptr) {
+           x = z->left;
+           xParent = z->parent;
+           transplant(z, z->left);
+       } else {
+           y = unlinked;
+           y_original_color = y->color;
+           x = y->right;
+           if (y->parent == z) {
+               xParent = y;
+           } else {
+               xParent = y->parent;
+               transplant(y, y->right);
+               y->right = z->right;
+               y->right->parent = y;
+           }
+           transplant(z, y);
+           y->left = z->left;
+           y->left->parent = y;
+           y->color = z->color;
+           y->size = z->size;
+       }
+
+       // every subtree that lost a node is on the path up from xParent
+       pullWeights(xParent);
+       if (!y_original_color) {
+           fixDelete(x, xParent);
+       }
+
+       delete z;
+       tree_size--;
+   }
+
+   // link sorted nodes[lo, hi) into a balanced subtree; nodes at redDepth are coloured red
+   Node* buildBalanced(Node **nodes, size_t lo, size_t hi, Node *parent, size_t depth, size_t redDepth) {
+       if (lo >= hi) return nullptr;
+       size_t mid = lo + (hi - lo) / 2;
+       Node *node = nodes[mid];
+       node->parent = parent;
+       node->color = depth == redDepth;
+       node->size = static_cast<unsigned int>(hi - lo);
+       node->left = buildBalanced(nodes, lo, mid, node, depth + 1, redDepth);
+       node->right = buildBalanced(nodes, mid + 1, hi, node, depth + 1, redDepth);
+       pullWeight(node);
+       return node;
+   }
+
+   // make the tree consist of exactly the n sorted nodes, reusing them in O(n)
+   void rebuild(Node **nodes, size_t n) {
+       // the top `full` levels are complete and black, a partial last level is red
+       size_t full = 0;
+       while ((static_cast<size_t>(2) << full) - 1 <= n) ++full;
+       root = buildBalanced(nodes, 0, n, nullptr, 0, full);
+       tree_size = n;
+       leftmost = n > 0 ? nodes[0] : nullptr;
+       rightmost = n > 0 ? nodes[n - 1] : nullptr;
+   }
+
+   template<class Predicate>
+   struct negation {
+       Predicate pred;
+       explicit negation(Predicate p) : pred(p) {}
+       bool operator()(const value_type &value) { return !pred(value); }
+   };
+
+   // in-order successor, or nullptr past the last node
+   static const Node* successor(const Node *node) {
+       if (node->right != nullptr) {
+           node = node->right;
+           while (node->left != nullptr) {
+               node = node->left;
+           }
+           return node;
+       }
+       const Node *parent = node->parent;
+       while (parent != nullptr && node == parent->right) {
+           node = parent;
+           parent = parent->parent;
+       }
+       return parent;
+   }
+
+   // the next step of an in-order walk goes through one of these
+   static void prefetchNext(const Node *node) {
+#if defined(__GNUC__)
+       __builtin_prefetch(node->right);
+       __builtin_prefetch(node->parent);
+#endif
+   }
+
+   static Node* predecessor(Node *node) {
+       if (node->left != nullptr) {
+           node = node->left;
+           while (node->right != nullptr) {
+               node = node->right;
+           }
+           return node;
+       }
+       Node *parent = node->parent;
+       while (parent != nullptr && node == parent->left) {
+           node = parent;
+           parent = parent->parent;
+       }
+       return parent;
+   }
+
+   // the in-order index of node, tree_size for nullptr (end())
+   size_t rankOf(const Node *node) const {
+       if (node == nullptr) return tree_size;
+       size_t rank = sizeOf(node->left);
+       for (; node->parent != nullptr; node = node->parent) {
+           if (node == node->parent->right) rank += sizeOf(node->parent->left) + 1;
+       }
+       return rank;
+   }
+
+   // the node at in-order index k, nullptr for k == tree_size
+   Node* select(size_t k) const {
+       Node *current = root;
+       while (current != nullptr) {
+           size_t leftSize = sizeOf(current->left);
+           if (k < leftSize) {
+               current = current->left;
+           } else if (k == leftSize) {
+               return current;
+           } else {
+               k -= leftSize + 1;
+               current = current->right;
+           }
+       }
+       return nullptr;
+   }
+
+   // the node k places after node (before, for negative k); throw if that leaves [begin(), end()]
+   Node* advance(const Node *node, ptrdiff_t k) const {
+       size_t rank = rankOf(node);
+       if (k < 0 ? static_cast<size_t>(-k) > rank : static_cast<size_t>(k) > tree_size - rank) {
+           throw invalid_iterator();
+       }
+       return select(rank + k);
+   }
+
+   // black nodes on a path from node down to a leaf
+   static size_t blackHeight(const Node *node) {
+       size_t height = 0;
+       for (; node != nullptr; node = node->left) {
+           if (!node->color) ++height;
+       }
+       return height;
+   }
+
+   /*
+    * link the red-black trees l and r with the lone node k between them (every key of
+    *   l is less than k's, every key of r greater) and return the root. k takes the place
+    *   of the node of r's black height on the facing spine of the taller tree, then
+    *   fixInsert repairs it: O(difference of black heights + 1).
+    * root is used as scratch.
+    */
+   Node* join(Node *l, Node *k, Node *r) {
+       if (l != nullptr) {
+           l->parent = nullptr;
+           l->color = false;
+       }
+       if (r != nullptr) {
+           r->parent = nullptr;
+           r->color = false;
+       }
+       size_t hl = blackHeight(l), hr = blackHeight(r);
+       Node *c, *parent = nullptr;
+       k->color = true;
+       if (hl >= hr) {
+           for (c = l; hl > hr || (c != nullptr && c->color); c = c->right) {
+               if (!c->color) --hl;
+               parent = c;
+           }
+           k->left = c;
+           k->right = r;
+           if (parent != nullptr) parent->right = k;
+           root = parent != nullptr ? l : k;
+       } else {
+           for (c = r; hr > hl || (c != nullptr && c->color); c = c->left) {
+               if (!c->color) --hr;
+               parent = c;
+           }
+           k->left = l;
+           k->right = c;
+           if (parent != nullptr) parent->left = k;
+           root = parent != nullptr ? r : k;
+       }
+       k->parent = parent;
+       if (k->left != nullptr) k->left->parent = k;
+       if (k->right != nullptr) k->right->parent = k;
+       for (Node *p = k; p != nullptr; p = p->parent) {
+           pullNode(p);
+       }
+       fixInsert(k);
+       return root;
+   }
+
+   // split the tree t into its first k nodes, l, and the rest, r, by a join per level; root is scratch
+   void split(Node *t, size_t k, Node *&l, Node *&r) {
+       if (t == nullptr) {
+           l = r = nullptr;
+           return;
+       }
+       Node *a = t->left, *b = t->right, *middle;
+       if (a != nullptr) a->parent = nullptr;
+       if (b != nullptr) b->parent = nullptr;
+       t->left = t->right = nullptr;
+       if (k <= sizeOf(a)) {
+           split(a, k, l, middle);
+           r = join(middle, t, b);
+       } else {
+           split(b, k - sizeOf(a) - 1, middle, r);
+           l = join(a, t, middle);
+       }
+   }
+
+   // move the last tree_size - k elements into other, an empty map
+   void splitInto(size_t k, map &other) {
+       Node *l, *r;
+       split(root, k, l, r);
+       if (l != nullptr) {
+           l->parent = nullptr;
+           l->color = false;
+       }
+       if (r != nullptr) {
+           r->parent = nullptr;
+           r->color = false;
+       }
+       other.root = r;
+       other.tree_size = tree_size - k;
+       other.leftmost = minimum(r);
+       other.rightmost = r == nullptr ? nullptr : rightmost;
+       root = l;
+       tree_size = k;
+       rightmost = maximum(l);
+       if (l == nullptr) leftmost = nullptr;
+   }
+
+   // bits (at most 64) uniformly random low bits from a UniformRandomBitGenerator
+   template<class Rng>
+   static unsigned long long randomBits(Rng &rng, unsigned int bits) {
+       unsigned long long span = static_cast<unsigned long long>(rng.max() - rng.min());
+       // every draw gives the bits below its largest power-of-two range, the rest is rejected
+       unsigned int per = 0;
+       if (span == ~0ULL) {
+           per = 64;
+       } else {
+           while ((2ULL << per) - 1 <= span) ++per;
+       }
+       unsigned long long result = 0;
+       for (unsigned int have = 0; have < bits;) {
+           unsigned long long draw = static_cast<unsigned long long>(rng() - rng.min());
+           if (per < 64 && (draw >> per) != 0) continue;
+           result |= draw << have;
+           have += per;
+       }
+       return bits >= 64 ? result : result & ((1ULL << bits) - 1);
+   }
+
+   // uniform in [0, n), n > 0
+   template<class Rng>
+   static size_t randomBelow(Rng &rng, size_t n) {
+       unsigned int bits = 0;
+       while (bits < 64 && ((n - 1) >> bits) != 0) ++bits;
+       for (;;) {
+           unsigned long long value = randomBits(rng, bits);
+           if (value < n) return static_cast<size_t>(value);
+       }
+   }
+
+   // uniform in (0, 1)
+   template<class Rng>
+   static double randomUnit(Rng &rng) {
+       return (static_cast<double>(randomBits(rng, 53)) + 0.5) / 9007199254740992.0;
+   }
+
+   // the node sample_weighted picks: a uniform point of [0, total weight) located by the sums
+   template<class Rng>
+   Node* weightedNode(Rng &rng) const {
+       Weight *policy = nullptr;
+       typename Weight::weight_type total = weightOf(root, policy);
+       if (!(total > typename Weight::weight_type())) {
+           throw container_is_empty();
+       }
+       double target = randomUnit(rng) * static_cast<double>(total);
+       Node *current = root;
+       for (;;) {
+           double left = static_cast<double>(weightOf(current->left, policy));
+           if (target < left) {
+               current = current->left;
+               continue;
+           }
+           target -= left;
+           // rounding may run past the last positive weight; it stays on this node then
+           if (target < static_cast<double>(Weight::weight(current->data)) ||
+               !(weightOf(current->right, policy) > typename Weight::weight_type())) {
+               return current;
+           }
+           target -= static_cast<double>(Weight::weight(current->data));
+           current = current->right;
+       }
+   }
+
+   /*
+    * finger search: returns the node holding key (found = true), or the node a new
+    * key would be linked below (found = false, nullptr for an empty tree).
+    * The descent starts at the lowest ancestor of finger whose subtree covers key,
+    * so finger must be nullptr or a node whose key is not greater than key.
+    */
+   Node* fingerSearch(Node *finger, const Key &key, bool &found) const {
+       Node *current = root;
+       if (finger != nullptr) {
+           if (!comp(finger->data.first, key)) {
+               found = true;
+               return finger;
+           }
+           current = finger;
+           while (current->parent != nullptr &&
+                  !(current == current->parent->left && comp(key, current->parent->data.first))) {
+               current = current->parent;
+           }
+       }
+       Node *parent = nullptr;
+       while (current != nullptr) {
+           parent = current;
+           int order = compare_keys(comp, key, current->data.first);
+           if (order < 0) {
+               current = current->left;
+           } else if (order > 0) {
+               current = current->right;
+           } else {
+               found = true;
+               return current;
+           }
+       }
+       found = false;
+       return parent;
+   }
+
+   // stable bottom-up merge sort of a batch by key, buffer is scratch space of the same size
+   template<class Op>
+   void sortBatch(Op **ops, Op **buffer, size_t n) const {
+       Op **src = ops, **dst = buffer;
+       for (size_t width = 1; width < n; width <<= 1) {
+           for (size_t lo = 0; lo < n; lo += width << 1) {
+               size_t mid = lo + width < n ? lo + width : n;
+               size_t hi = mid + width < n ? mid + width : n;
+               size_t i = lo, j = mid, k = lo;
+               while (i < mid && j < hi) {
+                   dst[k++] = comp(src[j]->key, src[i]->key) ? src[j++] : src[i++];
+               }
+               while (i < mid) dst[k++] = src[i++];
+               while (j < hi) dst[k++] = src[j++];
+           }
+           Op **tmp = src;
+           src = dst;
+           dst = tmp;
+       }
+       if (src != ops) {
+           for (size_t i = 0; i < n; ++i) ops[i] = src[i];
+       }
+   }
+
+   template<class K, class V, class C, class A, class W, class OnAdded, class OnRemoved, class OnChanged>
+   friend void diff(const map<K, V, C, A, W> &a, const map<K, V, C, A, W> &b,
+                    OnAdded on_added, OnRemoved on_removed, OnChanged on_changed);
+
   public:
    /**
   * see BidirectionalIterator at CppReference for help.
@@ -251,6 +822,12 @@ template<
 
        iterator(const iterator &other) : node(other.node), container(other.container) {}
 
+       iterator &operator=(const iterator &other) {
+           node = other.node;
+           container = other.container;
+           return *this;
+       }
+
        /**
     * TODO iter++
         */
@@ -301,7 +878,7 @@ template<
                if (container == nullptr || container->root == nullptr) {
                    throw invalid_iterator();
                }
-               node = container->maximum(container->root);
+               node = container->rightmost;
            } else {
                if (node->left != nullptr) {
                    node = node->left;
@@ -323,6 +900,46 @@ template<
            return *this;
        }
 
+       /**
+    * k elements further (back, for negative k), in O(log n) by the subtree sizes;
+    *   throw invalid_iterator if that leaves [begin(), end()].
+        */
+       iterator &operator+=(ptrdiff_t k) {
+           if (container == nullptr) {
+               throw invalid_iterator();
+           }
+           node = container->advance(node, k);
+           return *this;
+       }
+
+       iterator &operator-=(ptrdiff_t k) {
+           return *this += -k;
+       }
+
+       iterator operator+(ptrdiff_t k) const {
+           iterator temp = *this;
+           return temp += k;
+       }
+
+       iterator operator-(ptrdiff_t k) const {
+           iterator temp = *this;
+           return temp += -k;
+       }
+
+       /**
+    * the number of elements from rhs to this, throw invalid_iterator if they belong to different maps.
+        */
+       ptrdiff_t operator-(const iterator &rhs) const {
+           if (container == nullptr || container != rhs.container) {
+               throw invalid_iterator();
+           }
+           return static_cast<ptrdiff_t>(container->rankOf(node)) - static_cast<ptrdiff_t>(container->rankOf(rhs.node));
+       }
+
+       value_type &operator[](ptrdiff_t k) const {
+           return *(*this + k);
+       }
+
        /**
     * a operator to check whether two iterators are same (pointing to the same memory).
         */
@@ -383,6 +1000,12 @@ template<
 
        const_iterator(const iterator &other) : node(other.node), container(other.container) {}
 
+       const_iterator &operator=(const const_iterator &other) {
+           node = other.node;
+           container = other.container;
+           return *this;
+       }
+
        const_iterator operator++(int) {
            const_iterator temp = *this;
            ++(*this);
@@ -421,7 +1044,7 @@ template<
                if (container == nullptr || container->root == nullptr) {
                    throw invalid_iterator();
                }
-               node = container->maximum(container->root);
+               node = container->rightmost;
            } else {
                if (node->left != nullptr) {
                    node = node->left;
@@ -443,6 +1066,39 @@ template<
            return *this;
        }
 
+       const_iterator &operator+=(ptrdiff_t k) {
+           if (container == nullptr) {
+               throw invalid_iterator();
+           }
+           node = container->advance(node, k);
+           return *this;
+       }
+
+       const_iterator &operator-=(ptrdiff_t k) {
+           return *this += -k;
+       }
+
+       const_iterator operator+(ptrdiff_t k) const {
+           const_iterator temp = *this;
+           return temp += k;
+       }
+
+       const_iterator operator-(ptrdiff_t k) const {
+           const_iterator temp = *this;
+           return temp += -k;
+       }
+
+       ptrdiff_t operator-(const const_iterator &rhs) const {
+           if (container == nullptr || container != rhs.container) {
+               throw invalid_iterator();
+           }
+           return static_cast<ptrdiff_t>(container->rankOf(node)) - static_cast<ptrdiff_t>(container->rankOf(rhs.node));
+       }
+
+       const value_type &operator[](ptrdiff_t k) const {
+           return *(*this + k);
+       }
+
        const value_type &operator*() const {
            if (node == nullptr) {
                throw invalid_iterator();
@@ -479,11 +1135,23 @@ template<
    /**
   * TODO two constructors
     */
-   map() : root(nullptr), tree_size(0), comp() {}
+   map() : root(nullptr), leftmost(nullptr), rightmost(nullptr), tree_size(0), comp() {}
 
-   map(const map &other) : root(nullptr), tree_size(0), comp(other.comp) {
+   map(const map &other) : root(nullptr), leftmost(nullptr), rightmost(nullptr), tree_size(0), comp(other.comp) {
        root = copyTree(other.root, nullptr);
        tree_size = other.tree_size;
+       leftmost = minimum(root);
+       rightmost = maximum(root);
+   }
+
+   /**
+  * take the tree of other over in O(1), leaving other empty; iterators into other are invalidated.
+    */
+   map(map &&other)
+       : root(other.root), leftmost(other.leftmost), rightmost(other.rightmost), tree_size(other.tree_size),
+         comp(other.comp) {
+       other.root = other.leftmost = other.rightmost = nullptr;
+       other.tree_size = 0;
    }
 
    /**
@@ -495,6 +1163,22 @@ template<
            root = copyTree(other.root, nullptr);
            tree_size = other.tree_size;
            comp = other.comp;
+           leftmost = minimum(root);
+           rightmost = maximum(root);
+       }
+       return *this;
+   }
+
+   map &operator=(map &&other) {
+       if (this != &other) {
+           clearTree(root);
+           root = other.root;
+           leftmost = other.leftmost;
+           rightmost = other.rightmost;
+           tree_size = other.tree_size;
+           comp = other.comp;
+           other.root = other.leftmost = other.rightmost = nullptr;
+           other.tree_size = 0;
        }
        return *this;
    }
@@ -557,11 +1241,11 @@ template<
   * return a iterator to the beginning
     */
    iterator begin() {
-       return iterator(minimum(root), this);
+       return iterator(leftmost, this);
    }
 
    const_iterator cbegin() const {
-       return const_iterator(minimum(root), this);
+       return const_iterator(leftmost, this);
    }
 
    /**
@@ -591,12 +1275,95 @@ template<
        return tree_size;
    }
 
+   /**
+  * the first / last element in key order, in O(1); throw container_is_empty if there is none.
+    */
+   value_type &front() {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return leftmost->data;
+   }
+
+   const value_type &front() const {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return leftmost->data;
+   }
+
+   value_type &back() {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return rightmost->data;
+   }
+
+   const value_type &back() const {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return rightmost->data;
+   }
+
+   /**
+  * erase the first / last element; throw container_is_empty if there is none.
+  * The new extreme is the old one's neighbour, found in O(1) amortized.
+    */
+   void pop_front() {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       eraseNode(leftmost);
+   }
+
+   void pop_back() {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       eraseNode(rightmost);
+   }
+
+   /**
+  * detach the k smallest (largest) elements, all of them if k >= size(), and return
+  *   them as a map, in O(log^2 n) whatever k is: the tree is split by rank and both
+  *   halves rebalanced by red-black joins. No element is copied, and the result is
+  *   moved out; iterators to the taken ones are invalidated.
+    */
+   map take_smallest(size_t k) {
+       map taken;
+       taken.comp = comp;
+       if (k >= tree_size) {
+           k = tree_size;
+       }
+       splitInto(k, taken);
+       // this map keeps the larger part
+       Node *nodeRoot = root, *first = leftmost, *last = rightmost;
+       size_t count = tree_size;
+       root = taken.root;
+       leftmost = taken.leftmost;
+       rightmost = taken.rightmost;
+       tree_size = taken.tree_size;
+       taken.root = nodeRoot;
+       taken.leftmost = first;
+       taken.rightmost = last;
+       taken.tree_size = count;
+       return taken;
+   }
+
+   map take_largest(size_t k) {
+       map taken;
+       taken.comp = comp;
+       splitInto(k >= tree_size ? 0 : tree_size - k, taken);
+       return taken;
+   }
+
    /**
   * clears the contents
     */
    void clear() {
        clearTree(root);
-       root = nullptr;
+       root = leftmost = rightmost = nullptr;
        tree_size = 0;
    }
 
@@ -609,12 +1376,14 @@ template<
    pair<iterator, bool> insert(const value_type &value) {
        Node *parent = nullptr;
        Node *current = root;
+       int order = 0;
 
        while (current != nullptr) {
            parent = current;
-           if (comp(value.first, current->data.first)) {
+           order = compare_keys(comp, value.first, current->data.first);
+           if (order < 0) {
                current = current->left;
-           } else if (comp(current->data.first, value.first)) {
+           } else if (order > 0) {
                current = current->right;
            } else {
                // Key already exists
@@ -622,17 +1391,7 @@ template<
            }
        }
 
-       Node *newNode = new Node(value, parent);
-       if (parent == nullptr) {
-           root = newNode;
-       } else if (comp(value.first, parent->data.first)) {
-           parent->left = newNode;
-       } else {
-           parent->right = newNode;
-       }
-
-       fixInsert(newNode);
-       tree_size++;
+       Node *newNode = insertAt(value, parent, order < 0);
        return pair<iterator, bool>(iterator(newNode, this), true);
    }
 
@@ -646,40 +1405,7 @@ template<
            throw invalid_iterator();
        }
 
-       Node *z = pos.node;
-       Node *y = z;
-       Node *x = nullptr;
-       bool y_original_color = y->color;
-
-       if (z->left == nullptr) {
-           x = z->right;
-           transplant(z, z->right);
-       } else if (z->right == nullptr) {
-           x = z->left;
-           transplant(z, z->left);
-       } else {
-           y = minimum(z->right);
-           y_original_color = y->color;
-           x = y->right;
-           if (y->parent == z) {
-               if (x != nullptr) x->parent = y;
-           } else {
-               transplant(y, y->right);
-               y->right = z->right;
-               y->right->parent = y;
-           }
-           transplant(z, y);
-           y->left = z->left;
-           y->left->parent = y;
-           y->color = z->color;
-       }
-
-       if (!y_original_color) {
-           fixDelete(x);
-       }
-
-       delete z;
-       tree_size--;
+       eraseNode(pos.node);
    }
 
    /**
@@ -708,8 +1434,421 @@ template<
        const Node *node = findNode(key);
        return const_iterator(node, this);
    }
+
+   /**
+  * the first element whose key is not less than key, or end().
+    */
+   iterator lower_bound(const Key &key) {
+       return iterator(boundNode(key, false), this);
+   }
+
+   const_iterator lower_bound(const Key &key) const {
+       return const_iterator(boundNode(key, false), this);
+   }
+
+   /**
+  * the first element whose key is greater than key, or end().
+    */
+   iterator upper_bound(const Key &key) {
+       return iterator(boundNode(key, true), this);
+   }
+
+   const_iterator upper_bound(const Key &key) const {
+       return const_iterator(boundNode(key, true), this);
+   }
+
+   /**
+  * the element at index i in key order, in O(log n), so begin() + i without the walk;
+  *   throw index_out_of_bound if i >= size().
+    */
+   value_type &at_index(size_t i) {
+       if (i >= tree_size) {
+           throw index_out_of_bound();
+       }
+       return select(i)->data;
+   }
+
+   const value_type &at_index(size_t i) const {
+       if (i >= tree_size) {
+           throw index_out_of_bound();
+       }
+       return select(i)->data;
+   }
+
+   /**
+  * the number of keys less than key: the index key has, or would have once inserted.
+    */
+   size_t index_of(const Key &key) const {
+       size_t rank = 0;
+       for (Node *current = root; current != nullptr;) {
+           if (comp(current->data.first, key)) {
+               rank += sizeOf(current->left) + 1;
+               current = current->right;
+           } else {
+               current = current->left;
+           }
+       }
+       return rank;
+   }
+
+   /**
+  * a uniformly random element, in O(log n); rng is a UniformRandomBitGenerator
+  *   such as std::mt19937. throw container_is_empty if there is none.
+    */
+   template<class Rng>
+   iterator sample(Rng &rng) {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return iterator(select(randomBelow(rng, tree_size)), this);
+   }
+
+   template<class Rng>
+   const_iterator sample(Rng &rng) const {
+       if (tree_size == 0) {
+           throw container_is_empty();
+       }
+       return const_iterator(select(randomBelow(rng, tree_size)), this);
+   }
+
+   /**
+  * write iterators to min(k, size()) distinct elements, chosen uniformly, to out in
+  *   key order; return how many were written.
+  * The indices are drawn by Floyd's algorithm, one draw each, so the cost is
+  *   O(k log n) however k compares to n.
+    */
+   template<class Rng, class OutputIt>
+   size_t sample_k(Rng &rng, size_t k, OutputIt out) {
+       if (k > tree_size) k = tree_size;
+       map<size_t, bool> chosen;
+       for (size_t j = tree_size - k; j < tree_size; ++j) {
+           size_t t = randomBelow(rng, j + 1);
+           if (!chosen.insert(typename map<size_t, bool>::value_type(t, true)).second) {
+               chosen.insert(typename map<size_t, bool>::value_type(j, true));
+           }
+       }
+       iterator it = begin();
+       size_t at = 0;
+       for (typename map<size_t, bool>::const_iterator c = chosen.cbegin(); c != chosen.cend(); ++c) {
+           it += static_cast<ptrdiff_t>(c->first - at);
+           at = c->first;
+           *out = it;
+           ++out;
+       }
+       return k;
+   }
+
+   /**
+  * the total weight of the elements, under the Weight policy.
+    */
+   template<class W = Weight>
+   typename W::weight_type total_weight() const {
+       return weightOf(root, static_cast<W *>(nullptr));
+   }
+
+   /**
+  * an element chosen with probability proportional to its weight, in O(log n);
+  *   throw container_is_empty if the total weight is not positive.
+    */
+   template<class Rng>
+   iterator sample_weighted(Rng &rng) {
+       return iterator(weightedNode(rng), this);
+   }
+
+   template<class Rng>
+   const_iterator sample_weighted(Rng &rng) const {
+       return const_iterator(weightedNode(rng), this);
+   }
+
+   /**
+  * refresh the cached weights above pos after its mapped value changed, in O(log n);
+  *   needed only when the weight depends on the mapped value.
+    */
+   void reweigh(iterator pos) {
+       if (pos.container != this || pos.node == nullptr) {
+           throw invalid_iterator();
+       }
+       pullWeights(pos.node);
+   }
+
+   /**
+  * reservoir sampling over the keys in [lo, hi): write iterators to min(k, count)
+  *   of those elements, each k-subset equally likely, to out[0, ...) in no particular
+  *   order; return how many were written. out is random access.
+  * Li's Algorithm L draws how many elements to skip before the next one that enters
+  *   the reservoir, and iterator += skips them in O(log n), so the whole range is
+  *   sampled in O(k log(count / k) log n) instead of a walk over it.
+    */
+   template<class Rng, class RandomIt>
+   size_t sample_range(Rng &rng, const Key &lo, const Key &hi, size_t k, RandomIt out) {
+       size_t first = index_of(lo), last = index_of(hi);
+       if (k == 0 || last <= first) return 0;
+       size_t count = last - first;
+       iterator it = begin() + static_cast<ptrdiff_t>(first);
+       size_t taken = 0;
+       for (;;) {
+           out[taken] = it;
+           if (++taken == k || taken == count) break;
+           ++it;
+       }
+       if (taken < k) return taken;
+       // it is at index at of the range; w is the largest of k uniform variates so far
+       size_t at = k - 1;
+       double w = std::exp(std::log(randomUnit(rng)) / static_cast<double>(k));
+       for (;;) {
+           double skip = std::floor(std::log(randomUnit(rng)) / std::log1p(-w));
+           if (!(skip < static_cast<double>(count - at - 1))) break;
+           size_t next = at + 1 + static_cast<size_t>(skip);
+           it += static_cast<ptrdiff_t>(next - at);
+           at = next;
+           out[randomBelow(rng, k)] = it;
+           w *= std::exp(std::log(randomUnit(rng)) / static_cast<double>(k));
+       }
+       return k;
+   }
+
+   /**
+  * erase every element for which pred(element) is true, return how many were erased.
+  * pred is called exactly once per element, in key order.
+  * The walk starts by erasing node by node (amortized O(1) rebalancing each, since the
+  *   node is already at hand). Once removals clearly dominate, it frees the rest of the
+  *   doomed nodes without rebalancing and relinks the survivors into a freshly balanced
+  *   tree in O(n). Survivor nodes are reused, so iterators to them stay valid.
+    */
+   template<class Predicate>
+   size_t erase_if(Predicate pred) {
+       size_t removed = 0, kept = 0;
+       Node *node = minimum(root);
+       while (node != nullptr) {
+           Node *next = const_cast<Node *>(successor(node));
+           if (pred(static_cast<const value_type &>(node->data))) {
+               eraseNode(node);
+               ++removed;
+           } else {
+               ++kept;
+           }
+           node = next;
+           // freeing a node is about half the cost of erasing it, relinking a survivor about as much
+           if (removed > 2 * kept + 64) break;
+       }
+       if (node == nullptr) return removed;
+
+       // survivors so far are exactly the nodes before `node`
+       Node **nodes = new Node*[tree_size];
+       size_t count = 0;
+       for (Node *x = minimum(root); x != node; x = const_cast<Node *>(successor(x))) {
+           nodes[count++] = x;
+       }
+       // resume an explicit-stack in-order walk at `node`: a popped node is never
+       //   looked at again, so a doomed one can be freed right away
+       Node *stack[sizeof(size_t) * 16];
+       size_t top = 0;
+       for (Node *x = node; x->parent != nullptr; x = x->parent) {
+           if (x == x->parent->left) stack[top++] = x->parent;
+       }
+       for (size_t i = 0, j = top; i + 1 < j; ++i, --j) {
+           Node *tmp = stack[i];
+           stack[i] = stack[j - 1];
+           stack[j - 1] = tmp;
+       }
+       stack[top++] = node;
+       Node *current = nullptr;
+       try {
+           while (current != nullptr || top > 0) {
+               while (current != nullptr) {
+                   stack[top++] = current;
+                   current = current->left;
+               }
+               node = stack[--top];
+               current = node->right;
+               if (pred(static_cast<const value_type &>(node->data))) {
+                   delete node;
+                   ++removed;
+               } else {
+                   nodes[count++] = node;
+               }
+           }
+       } catch (...) {
+           // the tree already lost the freed nodes: keep everything not visited yet
+           nodes[count++] = node;
+           while (current != nullptr || top > 0) {
+               while (current != nullptr) {
+                   stack[top++] = current;
+                   current = current->left;
+               }
+               node = stack[--top];
+               current = node->right;
+               nodes[count++] = node;
+           }
+           rebuild(nodes, count);
+           delete[] nodes;
+           throw;
+       }
+       rebuild(nodes, count);
+       delete[] nodes;
+       return removed;
+   }
+
+   /**
+  * keep only the elements for which pred(element) is true, return how many were erased.
+    */
+   template<class Predicate>
+   size_t retain(Predicate pred) {
+       return erase_if(negation<Predicate>(pred));
+   }
+
+   /**
+  * one operation of apply_batch.
+  *   batch_insert: insert (key, *value) if key is absent; result is true if inserted.
+  *   batch_assign: insert (key, *value) or overwrite the mapped value; result is true if key was new.
+  *   batch_erase: erase key; result is true if key existed. value is not used.
+  *   batch_find: look key up; result is true if key exists, and value is set to its
+  *     mapped value or nullptr. The pointer is into the map: a later op of the same
+  *     batch may erase or overwrite the element, so to see the value as of this op,
+  *     set on_found, which the pass calls with it right away.
+  * value must stay alive until apply_batch returns.
+  * applied is set once the op has taken effect, so after apply_batch throws, the ops
+  *   still false are exactly the ones that did not.
+    */
+   enum batch_kind { batch_insert, batch_assign, batch_erase, batch_find };
+
+   struct batch_op {
+       batch_kind kind;
+       Key key;
+       const T *value;
+       bool result;
+       bool applied;
+       void (*on_found)(batch_op &op, const T &value);
+
+       batch_op(batch_kind k, const Key &key_, const T *value_ = nullptr)
+           : kind(k), key(key_), value(value_), result(false), applied(false), on_found(nullptr) {}
+   };
+
+   /**
+  * apply n operations in one ascending pass over the tree.
+  * Operations are stably sorted by key (so ops on the same key keep their order),
+  *   then each one is located by a finger search from the previous one instead of
+  *   from the root. With amortized O(1) rebalancing per insert/erase the pass costs
+  *   O(k log(n/k + 1)) besides the sort. Every op's result field is filled in.
+    */
+   void apply_batch(batch_op *ops, size_t n) {
+       if (n == 0) return;
+       batch_op **order = new batch_op*[n];
+       for (size_t i = 0; i < n; ++i) {
+           order[i] = ops + i;
+       }
+       applySorted(order, n);
+   }
+
+   /**
+  * the same over n operations scattered in memory; ops itself is left untouched.
+    */
+   void apply_batch(batch_op *const *ops, size_t n) {
+       if (n == 0) return;
+       batch_op **order = new batch_op*[n];
+       for (size_t i = 0; i < n; ++i) {
+           order[i] = ops[i];
+       }
+       applySorted(order, n);
+   }
+
+  private:
+   // apply_batch's pass; takes ownership of order
+   void applySorted(batch_op **order, size_t n) {
+       batch_op **buffer = nullptr;
+       for (size_t i = 0; i < n; ++i) {
+           order[i]->applied = false;
+       }
+       try {
+           buffer = new batch_op*[n];
+           sortBatch(order, buffer, n);
+
+           Node *finger = nullptr;
+           for (size_t i = 0; i < n; ++i) {
+               batch_op &op = *order[i];
+               bool found;
+               Node *node = fingerSearch(finger, op.key, found);
+               if (op.kind == batch_find) {
+                   op.result = found;
+                   op.value = found ? &node->data.second : nullptr;
+                   if (found) {
+                       finger = node;
+                       if (op.on_found != nullptr) op.on_found(op, node->data.second);
+                   }
+               } else if (op.kind == batch_erase) {
+                   op.result = found;
+                   if (found) {
+                       finger = predecessor(node);
+                       eraseNode(node);
+                   }
+               } else if (found) {
+                   op.result = false;
+                   if (op.kind == batch_assign) {
+                       node->data.second = *op.value;
+                       pullWeights(node);
+                   }
+                   finger = node;
+               } else {
+                   finger = insertAt(value_type(op.key, *op.value), node,
+                                     node != nullptr && comp(op.key, node->data.first));
+                   op.result = true;
+               }
+               op.applied = true;
+           }
+       } catch (...) {
+           delete[] order;
+           delete[] buffer;
+           throw;
+       }
+       delete[] order;
+       delete[] buffer;
+   }
 };
 
+/**
+ * report the difference between two versions of a map.
+ *   on_removed(entry) for every key only in a,
+ *   on_added(entry) for every key only in b,
+ *   on_changed(entry_in_a, entry_in_b) for every key in both whose mapped values differ (by ==).
+ * Keys are reported in ascending order. One merge walk over both trees, nothing is allocated.
+ * Nodes are never shared between two maps, so the only structure that can be
+ *   skipped by pointer equality is the whole tree (a and b are the same map).
+ */
+template<class Key, class T, class Compare, class Alloc, class Weight, class OnAdded, class OnRemoved, class OnChanged>
+void diff(const map<Key, T, Compare, Alloc, Weight> &a, const map<Key, T, Compare, Alloc, Weight> &b,
+          OnAdded on_added, OnRemoved on_removed, OnChanged on_changed) {
+   typedef map<Key, T, Compare, Alloc, Weight> map_type;
+   typedef typename map_type::Node Node;
+   if (&a == &b || a.root == b.root) return;
+
+   const Node *x = a.leftmost;
+   const Node *y = b.leftmost;
+   while (x != nullptr && y != nullptr) {
+       map_type::prefetchNext(x);
+       map_type::prefetchNext(y);
+       int order = compare_keys(a.comp, x->data.first, y->data.first);
+       if (order < 0) {
+           on_removed(x->data);
+           x = map_type::successor(x);
+       } else if (order > 0) {
+           on_added(y->data);
+           y = map_type::successor(y);
+       } else {
+           if (!(x->data.second == y->data.second)) {
+               on_changed(x->data, y->data);
+           }
+           x = map_type::successor(x);
+           y = map_type::successor(y);
+       }
+   }
+   for (; x != nullptr; x = map_type::successor(x)) {
+       on_removed(x->data);
+   }
+   for (; y != nullptr; y = map_type::successor(y)) {
+       on_added(y->data);
+   }
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,401 @@
+/**
+* a multi-version map whose snapshots stay consistent while writers go on
+*/
+#ifndef SJTU_MVCC_MAP_HPP
+#define SJTU_MVCC_MAP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * mvcc_map<Key, T> keeps, for every key, a chain of versions stamped with the
+ *   logical times [begin, end) during which each was current.
+ * Writers (insert, assign, erase) take the lock exclusively for one operation,
+ *   stamp it with the next time and only ever push a version or close the current
+ *   one; they never remove a tree node or free a version.
+ * begin_snapshot() pins the current time. Its iterators see exactly the versions
+ *   current at that time, however the map changes afterwards, and take the lock
+ *   shared for each single step only, so a long scan never blocks writers for long.
+ * collect_garbage() frees versions that ended before the oldest live snapshot and
+ *   erases keys left without any; it can run on a background thread.
+ */
+template<class Key, class T, class Compare = std::less<Key> >
+class mvcc_map {
+  private:
+   static const unsigned long long FOREVER = ~0ULL;
+
+   struct version {
+       T value;
+       unsigned long long begin, end;
+       version *older;
+       version(const T &v, unsigned long long b, version *o) : value(v), begin(b), end(FOREVER), older(o) {}
+   };
+
+   typedef map<Key, version *, Compare> index_type;
+
+   index_type index;
+   size_t live_count;
+   std::atomic<unsigned long long> clock;
+   mutable std::shared_timed_mutex lock;
+
+   std::mutex snapshot_lock;
+   map<unsigned long long, size_t> snapshots;   // pinned time -> number of snapshots
+
+   std::mutex collector_lock;
+   std::condition_variable collector_wake;
+   std::thread collector;
+   bool collector_stop;
+
+   static const version *visibleAt(const version *v, unsigned long long time) {
+       while (v != nullptr && v->begin > time) v = v->older;
+       return v != nullptr && time < v->end ? v : nullptr;
+   }
+
+   static void freeChain(version *v) {
+       while (v != nullptr) {
+           version *older = v->older;
+           delete v;
+           v = older;
+       }
+   }
+
+   unsigned long long pin() {
+       std::lock_guard<std::mutex> guard(snapshot_lock);
+       unsigned long long time = clock.load();
+       ++snapshots[time];
+       return time;
+   }
+
+   void unpin(unsigned long long time) {
+       std::lock_guard<std::mutex> guard(snapshot_lock);
+       typename map<unsigned long long, size_t>::iterator it = snapshots.find(time);
+       if (--it->second == 0) snapshots.erase(it);
+   }
+
+   // drops the versions that ended at or before horizon; true if none is left
+   struct prune {
+       unsigned long long horizon;
+       explicit prune(unsigned long long h) : horizon(h) {}
+       bool operator()(const typename index_type::value_type &entry) const {
+           version *v = entry.second;
+           if (v->end <= horizon) {
+               freeChain(v);
+               return true;
+           }
+           while (v->older != nullptr && v->older->end > horizon) v = v->older;
+           freeChain(v->older);
+           v->older = nullptr;
+           return false;
+       }
+   };
+
+   void collectorLoop(std::chrono::milliseconds period) {
+       std::unique_lock<std::mutex> guard(collector_lock);
+       while (!collector_stop) {
+           collector_wake.wait_for(guard, period);
+           if (collector_stop) break;
+           guard.unlock();
+           collect_garbage();
+           guard.lock();
+       }
+   }
+
+  public:
+   class snapshot;
+
+   /**
+  * a read-only iterator of a snapshot; valid while its snapshot is alive.
+  * Dereferencing gives a reference { first, second } to the key and the value
+  *   the key had at the snapshot's time.
+    */
+   class const_iterator {
+      public:
+       struct reference {
+           const Key &first;
+           const T &second;
+           reference(const Key &k, const T &v) : first(k), second(v) {}
+       };
+
+       struct pointer {
+           reference ref;
+           explicit pointer(const reference &r) : ref(r) {}
+           const reference *operator->() const {
+               return &ref;
+           }
+       };
+
+      private:
+       const mvcc_map *owner;
+       unsigned long long time;
+       typename index_type::const_iterator position;
+       const version *current;
+
+       // move forward to the first key visible at time, with the lock held
+       void settle() {
+           current = nullptr;
+           while (position != owner->index.cend()) {
+               current = visibleAt(position->second, time);
+               if (current != nullptr) break;
+               ++position;
+           }
+       }
+
+       const_iterator(const mvcc_map *o, unsigned long long t, typename index_type::const_iterator p)
+           : owner(o), time(t), position(p), current(nullptr) {
+           settle();
+       }
+
+      public:
+       const_iterator() : owner(nullptr), time(0), current(nullptr) {}
+
+       const_iterator &operator++() {
+           if (owner == nullptr || current == nullptr) {
+               throw invalid_iterator();
+           }
+           std::shared_lock<std::shared_timed_mutex> guard(owner->lock);
+           ++position;
+           settle();
+           return *this;
+       }
+
+       const_iterator operator++(int) {
+           const_iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       reference operator*() const {
+           if (current == nullptr) {
+               throw invalid_iterator();
+           }
+           return reference(position->first, current->value);
+       }
+
+       pointer operator->() const {
+           return pointer(**this);
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return owner == rhs.owner && current == rhs.current;
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       friend class snapshot;
+   };
+
+   /**
+  * a consistent read-only view of the map at the time begin_snapshot() was called.
+  * Movable, not copyable; versions it can see are kept until it is destroyed.
+    */
+   class snapshot {
+      private:
+       mvcc_map *owner;
+       unsigned long long time;
+
+       snapshot(mvcc_map *o, unsigned long long t) : owner(o), time(t) {}
+
+       friend class mvcc_map;
+
+      public:
+       snapshot(snapshot &&other) : owner(other.owner), time(other.time) {
+           other.owner = nullptr;
+       }
+
+       snapshot(const snapshot &) = delete;
+       snapshot &operator=(const snapshot &) = delete;
+
+       ~snapshot() {
+           if (owner != nullptr) owner->unpin(time);
+       }
+
+       unsigned long long timestamp() const {
+           return time;
+       }
+
+       const_iterator begin() const {
+           std::shared_lock<std::shared_timed_mutex> guard(owner->lock);
+           return const_iterator(owner, time, owner->index.cbegin());
+       }
+
+       const_iterator end() const {
+           const_iterator it;
+           it.owner = owner;
+           it.time = time;
+           return it;
+       }
+
+       size_t count(const Key &key) const {
+           std::shared_lock<std::shared_timed_mutex> guard(owner->lock);
+           typename index_type::const_iterator it = owner->index.find(key);
+           return it != owner->index.cend() && visibleAt(it->second, time) != nullptr ? 1 : 0;
+       }
+
+       /**
+      * the value of key at the snapshot's time, throw index_out_of_bound if absent then.
+        */
+       const T &at(const Key &key) const {
+           std::shared_lock<std::shared_timed_mutex> guard(owner->lock);
+           typename index_type::const_iterator it = owner->index.find(key);
+           const version *v = it == owner->index.cend() ? nullptr : visibleAt(it->second, time);
+           if (v == nullptr) {
+               throw index_out_of_bound();
+           }
+           return v->value;
+       }
+   };
+
+   mvcc_map() : live_count(0), clock(0), collector_stop(false) {}
+
+   mvcc_map(const mvcc_map &) = delete;
+   mvcc_map &operator=(const mvcc_map &) = delete;
+
+   /**
+  * every snapshot must be gone before the map is destroyed.
+    */
+   ~mvcc_map() {
+       stop_collector();
+       for (typename index_type::iterator it = index.begin(); it != index.end(); ++it) {
+           freeChain(it->second);
+       }
+   }
+
+   /**
+  * insert (key, value) if key has no current value; return whether it was inserted.
+    */
+   bool insert(const Key &key, const T &value) {
+       std::unique_lock<std::shared_timed_mutex> guard(lock);
+       typename index_type::iterator it = index.find(key);
+       if (it != index.end() && it->second->end == FOREVER) {
+           return false;
+       }
+       unsigned long long time = clock.load() + 1;
+       if (it == index.end()) {
+           index.insert(typename index_type::value_type(key, new version(value, time, nullptr)));
+       } else {
+           it->second = new version(value, time, it->second);
+       }
+       ++live_count;
+       clock.store(time);
+       return true;
+   }
+
+   /**
+  * make value the current value of key, inserting key if needed.
+    */
+   void assign(const Key &key, const T &value) {
+       std::unique_lock<std::shared_timed_mutex> guard(lock);
+       unsigned long long time = clock.load() + 1;
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) {
+           index.insert(typename index_type::value_type(key, new version(value, time, nullptr)));
+           ++live_count;
+       } else {
+           if (it->second->end == FOREVER) it->second->end = time;
+           else ++live_count;
+           it->second = new version(value, time, it->second);
+       }
+       clock.store(time);
+   }
+
+   /**
+  * end the current value of key; snapshots taken before still see it.
+  * Return the number of elements erased (0 or 1).
+    */
+   size_t erase(const Key &key) {
+       std::unique_lock<std::shared_timed_mutex> guard(lock);
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end() || it->second->end != FOREVER) {
+           return 0;
+       }
+       unsigned long long time = clock.load() + 1;
+       it->second->end = time;
+       --live_count;
+       clock.store(time);
+       return 1;
+   }
+
+   /**
+  * the current value of key, copied out since a writer may replace it at once;
+  *   throw index_out_of_bound if absent.
+    */
+   T at(const Key &key) const {
+       std::shared_lock<std::shared_timed_mutex> guard(lock);
+       typename index_type::const_iterator it = index.find(key);
+       if (it == index.cend() || it->second->end != FOREVER) {
+           throw index_out_of_bound();
+       }
+       return it->second->value;
+   }
+
+   size_t count(const Key &key) const {
+       std::shared_lock<std::shared_timed_mutex> guard(lock);
+       typename index_type::const_iterator it = index.find(key);
+       return it != index.cend() && it->second->end == FOREVER ? 1 : 0;
+   }
+
+   size_t size() const {
+       std::shared_lock<std::shared_timed_mutex> guard(lock);
+       return live_count;
+   }
+
+   bool empty() const {
+       return size() == 0;
+   }
+
+   /**
+  * pin the current state; the map must outlive the snapshot.
+    */
+   snapshot begin_snapshot() {
+       return snapshot(this, pin());
+   }
+
+   /**
+  * free every version no live snapshot can see, return how many keys were
+  *   erased from the tree because none of their versions is left.
+    */
+   size_t collect_garbage() {
+       std::unique_lock<std::shared_timed_mutex> guard(lock);
+       unsigned long long horizon;
+       {
+           std::lock_guard<std::mutex> pinned(snapshot_lock);
+           // writers are excluded, so clock is stable and later snapshots pin at least clock
+           horizon = snapshots.empty() ? clock.load() : snapshots.cbegin()->first;
+       }
+       return index.erase_if(prune(horizon));
+   }
+
+   /**
+  * run collect_garbage every period on a background thread until stop_collector().
+    */
+   void start_collector(std::chrono::milliseconds period) {
+       stop_collector();
+       collector_stop = false;
+       collector = std::thread(&mvcc_map::collectorLoop, this, period);
+   }
+
+   void stop_collector() {
+       if (!collector.joinable()) return;
+       {
+           std::lock_guard<std::mutex> guard(collector_lock);
+           collector_stop = true;
+       }
+       collector_wake.notify_all();
+       collector.join();
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,451 @@
+/**
+* a frozen map over a fixed key set with minimal perfect hashing
+*/
+#ifndef SJTU_PERFECT_HASH_MAP_HPP
+#define SJTU_PERFECT_HASH_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * perfect_hash_map<Key, T> is built once from an sjtu::map and never gains or
+ *   loses keys. Lookups hash the key, read one displacement word, and read the
+ *   entry slot it selects, whose stored key verifies the hit: two memory accesses
+ *   and O(1) time whatever the size. Values may still be modified in place.
+ * The hash is CHD-style (hash, displace): keys are grouped into buckets, and every
+ *   bucket gets a displacement that sends its keys to distinct free slots of a table
+ *   with exactly one slot per key. Buckets of one key are placed last and store
+ *   their slot directly.
+ * A secondary array of slot numbers in key order gives ordered iteration, and its
+ *   inverse turns a found slot into an iterator.
+ * Hash must give distinct keys distinct values: keys with equal hashes land in the
+ *   same slot under every displacement, so building from them throws runtime_error.
+ *   std::hash of integers and pointers is injective; for strings a collision of the
+ *   full 64-bit hash is practically impossible, but a weak Hash makes one likely.
+ */
+template<class Key, class T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key> >
+class perfect_hash_map {
+  public:
+   typedef pair<const Key, T> value_type;
+
+  private:
+   size_t slot_count;
+   size_t bucket_count;
+   unsigned long long seed;
+   int *displacement;       // > 0: hash displacement, < 0: -(slot + 1), 0: empty bucket
+   value_type *entries;     // slot order
+   size_t *order;           // slots in key order
+   size_t *rank;            // key order position of each slot
+
+   static unsigned long long mix(unsigned long long h, unsigned long long salt) {
+       // splitmix64 finalizer
+       h ^= salt * 0x9e3779b97f4a7c15ULL;
+       h ^= h >> 30;
+       h *= 0xbf58476d1ce4e5b9ULL;
+       h ^= h >> 27;
+       h *= 0x94d049bb133111ebULL;
+       h ^= h >> 31;
+       return h;
+   }
+
+   size_t slotOf(unsigned long long h) const {
+       int d = displacement[mix(h, seed) % bucket_count];
+       return d < 0 ? static_cast<size_t>(-(d + 1)) : static_cast<size_t>(mix(h, static_cast<unsigned long long>(d)) % slot_count);
+   }
+
+   // slot holding key, or slot_count if absent
+   size_t locate(const Key &key) const {
+       if (slot_count == 0) return 0;
+       size_t slot = slotOf(static_cast<unsigned long long>(Hash()(key)));
+       return KeyEqual()(entries[slot].first, key) ? slot : slot_count;
+   }
+
+   // all or nothing: if an allocation throws, the map is left empty
+   void allocate(size_t n) {
+       try {
+           displacement = new int[n / 2 + 1]();
+           entries = static_cast<value_type *>(::operator new(sizeof(value_type) * (n == 0 ? 1 : n)));
+           order = new size_t[n == 0 ? 1 : n];
+           rank = new size_t[n == 0 ? 1 : n];
+       } catch (...) {
+           ::operator delete(entries);
+           entries = nullptr;
+           release();
+           throw;
+       }
+       slot_count = n;
+       bucket_count = n / 2 + 1;
+   }
+
+   void rankSlots() {
+       for (size_t i = 0; i < slot_count; ++i) rank[order[i]] = i;
+   }
+
+   void release() {
+       // entries are only ever fully constructed, see build and load
+       if (entries != nullptr) {
+           for (size_t i = 0; i < slot_count; ++i) entries[order[i]].~value_type();
+           ::operator delete(entries);
+       }
+       delete[] displacement;
+       delete[] order;
+       delete[] rank;
+       displacement = nullptr;
+       entries = nullptr;
+       order = nullptr;
+       rank = nullptr;
+       slot_count = bucket_count = 0;
+   }
+
+   // find a seed and displacements for the hashes in key order; fills order
+   void place(const std::vector<unsigned long long> &hashes) {
+       size_t n = slot_count;
+       std::vector<size_t> bucketOf(n), start(bucket_count + 1), members(n), bySize(bucket_count);
+       std::vector<char> taken(n);
+       std::vector<size_t> slots;
+       for (seed = 1; ; ++seed) {
+           // group keys by bucket with a counting sort
+           std::fill(start.begin(), start.end(), 0);
+           for (size_t i = 0; i < n; ++i) {
+               bucketOf[i] = static_cast<size_t>(mix(hashes[i], seed) % bucket_count);
+               ++start[bucketOf[i] + 1];
+           }
+           size_t largest = 0;
+           for (size_t b = 0; b < bucket_count; ++b) {
+               if (start[b + 1] > largest) largest = start[b + 1];
+               start[b + 1] += start[b];
+           }
+           std::vector<size_t> fillPos(start.begin(), start.end() - 1);
+           for (size_t i = 0; i < n; ++i) members[fillPos[bucketOf[i]]++] = i;
+           // largest buckets first, while the table is still empty
+           std::vector<size_t> sizeStart(largest + 2);
+           for (size_t b = 0; b < bucket_count; ++b) ++sizeStart[largest - (start[b + 1] - start[b]) + 1];
+           for (size_t s = 0; s <= largest; ++s) sizeStart[s + 1] += sizeStart[s];
+           for (size_t b = 0; b < bucket_count; ++b) bySize[sizeStart[largest - (start[b + 1] - start[b])]++] = b;
+
+           std::fill(taken.begin(), taken.end(), 0);
+           std::fill(displacement, displacement + bucket_count, 0);
+           bool failed = false;
+           size_t k = 0, freeSlot = 0;
+           for (; k < bucket_count && !failed; ++k) {
+               size_t b = bySize[k], size = start[b + 1] - start[b];
+               if (size <= 1) break;
+               bool placed = false;
+               for (int d = 1; d < (1 << 20) && !placed; ++d) {
+                   slots.clear();
+                   placed = true;
+                   for (size_t j = start[b]; j < start[b + 1] && placed; ++j) {
+                       size_t slot = static_cast<size_t>(mix(hashes[members[j]], static_cast<unsigned long long>(d)) % n);
+                       if (taken[slot]) placed = false;
+                       for (size_t q = 0; q < slots.size() && placed; ++q) {
+                           if (slots[q] == slot) placed = false;
+                       }
+                       slots.push_back(slot);
+                   }
+                   if (placed) {
+                       displacement[b] = d;
+                       for (size_t j = 0; j < slots.size(); ++j) {
+                           taken[slots[j]] = 1;
+                           order[members[start[b] + j]] = slots[j];
+                       }
+                   }
+               }
+               failed = !placed;
+           }
+           if (failed) continue;
+           for (; k < bucket_count; ++k) {
+               size_t b = bySize[k];
+               if (start[b + 1] == start[b]) break;
+               while (taken[freeSlot]) ++freeSlot;
+               taken[freeSlot] = 1;
+               displacement[b] = -static_cast<int>(freeSlot + 1);
+               order[members[start[b]]] = freeSlot;
+           }
+           return;
+       }
+   }
+
+   template<class Compare, class Alloc, class Weight>
+   void build(const map<Key, T, Compare, Alloc, Weight> &source) {
+       size_t n = source.size();
+       std::vector<const value_type *> items;
+       std::vector<unsigned long long> hashes;
+       items.reserve(n);
+       hashes.reserve(n);
+       for (typename map<Key, T, Compare, Alloc, Weight>::const_iterator it = source.cbegin(); it != source.cend(); ++it) {
+           items.push_back(&*it);
+           hashes.push_back(static_cast<unsigned long long>(Hash()(it->first)));
+       }
+       // keys with equal hashes can never be separated by a displacement, see the class notes
+       std::vector<unsigned long long> sorted(hashes);
+       std::sort(sorted.begin(), sorted.end());
+       if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+           throw runtime_error();
+       }
+       allocate(n);
+       if (n == 0) return;
+       place(hashes);
+       rankSlots();
+       size_t constructed = 0;
+       try {
+           for (; constructed < n; ++constructed) {
+               new (entries + order[constructed]) value_type(*items[constructed]);
+           }
+       } catch (...) {
+           for (size_t i = 0; i < constructed; ++i) entries[order[i]].~value_type();
+           ::operator delete(entries);
+           entries = nullptr;
+           release();
+           throw;
+       }
+   }
+
+   void copyFrom(const perfect_hash_map &other) {
+       allocate(other.slot_count);
+       seed = other.seed;
+       memcpy(displacement, other.displacement, sizeof(int) * bucket_count);
+       memcpy(order, other.order, sizeof(size_t) * slot_count);
+       memcpy(rank, other.rank, sizeof(size_t) * slot_count);
+       size_t constructed = 0;
+       try {
+           for (; constructed < slot_count; ++constructed) {
+               new (entries + order[constructed]) value_type(other.entries[order[constructed]]);
+           }
+       } catch (...) {
+           for (size_t i = 0; i < constructed; ++i) entries[order[i]].~value_type();
+           ::operator delete(entries);
+           entries = nullptr;
+           release();
+           throw;
+       }
+   }
+
+  public:
+   class const_iterator {
+      private:
+       const perfect_hash_map *container;
+       size_t index;   // position in key order, size() for end
+
+      public:
+       const_iterator() : container(nullptr), index(0) {}
+
+       const_iterator(const perfect_hash_map *c, size_t i) : container(c), index(i) {}
+
+       const_iterator operator++(int) {
+           const_iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       const_iterator &operator++() {
+           if (container == nullptr || index == container->slot_count) {
+               throw invalid_iterator();
+           }
+           ++index;
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       const_iterator &operator--() {
+           if (container == nullptr || index == 0) {
+               throw invalid_iterator();
+           }
+           --index;
+           return *this;
+       }
+
+       const value_type &operator*() const {
+           if (container == nullptr || index == container->slot_count) {
+               throw invalid_iterator();
+           }
+           return container->entries[container->order[index]];
+       }
+
+       const value_type *operator->() const {
+           return &**this;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && index == rhs.index;
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+   };
+
+   perfect_hash_map() : slot_count(0), bucket_count(0), seed(0), displacement(nullptr), entries(nullptr), order(nullptr), rank(nullptr) {}
+
+   /**
+  * freeze the keys and values of source; throws runtime_error if two keys
+  *   have equal Hash values.
+    */
+   template<class Compare, class Alloc, class Weight>
+   explicit perfect_hash_map(const map<Key, T, Compare, Alloc, Weight> &source)
+       : slot_count(0), bucket_count(0), seed(0), displacement(nullptr), entries(nullptr), order(nullptr), rank(nullptr) {
+       build(source);
+   }
+
+   perfect_hash_map(const perfect_hash_map &other)
+       : slot_count(0), bucket_count(0), seed(0), displacement(nullptr), entries(nullptr), order(nullptr), rank(nullptr) {
+       copyFrom(other);
+   }
+
+   perfect_hash_map &operator=(const perfect_hash_map &other) {
+       if (this != &other) {
+           release();
+           copyFrom(other);
+       }
+       return *this;
+   }
+
+   ~perfect_hash_map() {
+       release();
+   }
+
+   /**
+  * access specified element with bounds checking, throw index_out_of_bound if absent.
+    */
+   T &at(const Key &key) {
+       size_t slot = locate(key);
+       if (slot == slot_count) {
+           throw index_out_of_bound();
+       }
+       return entries[slot].second;
+   }
+
+   const T &at(const Key &key) const {
+       size_t slot = locate(key);
+       if (slot == slot_count) {
+           throw index_out_of_bound();
+       }
+       return entries[slot].second;
+   }
+
+   size_t count(const Key &key) const {
+       return locate(key) == slot_count ? 0 : 1;
+   }
+
+   const_iterator find(const Key &key) const {
+       size_t slot = locate(key);
+       return const_iterator(this, slot == slot_count ? slot_count : rank[slot]);
+   }
+
+   const_iterator cbegin() const {
+       return const_iterator(this, 0);
+   }
+
+   const_iterator cend() const {
+       return const_iterator(this, slot_count);
+   }
+
+   bool empty() const {
+       return slot_count == 0;
+   }
+
+   size_t size() const {
+       return slot_count;
+   }
+
+   /**
+  * write the table to path with cstdio, for trivially copyable Key and T.
+  * The file depends on Hash, so load it with the same build; returns false on I/O failure.
+    */
+   bool save(const char *path) const {
+       static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value,
+                     "perfect_hash_map::save needs trivially copyable keys and values");
+       FILE *file = fopen(path, "wb");
+       if (file == nullptr) return false;
+       unsigned long long header[4] = {0x5348504dULL, slot_count, bucket_count, seed};
+       bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+       if (ok && slot_count > 0) {
+           ok = fwrite(displacement, sizeof(int), bucket_count, file) == bucket_count
+                && fwrite(order, sizeof(size_t), slot_count, file) == slot_count;
+           for (size_t i = 0; i < slot_count && ok; ++i) {
+               ok = fwrite(&entries[i].first, sizeof(Key), 1, file) == 1
+                    && fwrite(&entries[i].second, sizeof(T), 1, file) == 1;
+           }
+       }
+       return fclose(file) == 0 && ok;
+   }
+
+   /**
+  * replace the contents with a table written by save; returns false and
+  *   leaves the map empty if the file is missing or malformed.
+    */
+   bool load(const char *path) {
+       static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value,
+                     "perfect_hash_map::load needs trivially copyable keys and values");
+       release();
+       struct file_guard {
+           FILE *file;
+           ~file_guard() {
+               if (file != nullptr) fclose(file);
+           }
+       } guard = {fopen(path, "rb")};
+       FILE *file = guard.file;
+       if (file == nullptr) return false;
+       // the slot count sizes every allocation, so check it against the file first
+       long fileSize = -1;
+       if (fseek(file, 0, SEEK_END) == 0) fileSize = ftell(file);
+       if (fileSize < 0 || fseek(file, 0, SEEK_SET) != 0) return false;
+       unsigned long long header[4];
+       const unsigned long long perSlot = sizeof(size_t) + sizeof(Key) + sizeof(T);
+       bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == 0x5348504dULL
+                 && header[1] <= (static_cast<unsigned long long>(fileSize) - sizeof(header)) / perSlot
+                 && header[2] == header[1] / 2 + 1;
+       if (ok) {
+           allocate(static_cast<size_t>(header[1]));
+           seed = header[3];
+           size_t n = slot_count;
+           slot_count = 0;   // nothing constructed yet
+           ok = n == 0 || (fread(displacement, sizeof(int), bucket_count, file) == bucket_count
+                           && fread(order, sizeof(size_t), n, file) == n);
+           // every slot must be reachable exactly once, or lookups would read past the table
+           std::vector<char> seen(ok ? n : 0);
+           for (size_t i = 0; i < n && ok; ++i) {
+               ok = order[i] < n && !seen[order[i]];
+               if (ok) seen[order[i]] = 1;
+           }
+           for (size_t b = 0; b < bucket_count && ok && n > 0; ++b) {
+               ok = displacement[b] >= 0 || static_cast<size_t>(-(displacement[b] + 1)) < n;
+           }
+           // raw storage, so Key and T need not be default constructible
+           typename std::aligned_storage<sizeof(Key), alignof(Key)>::type key;
+           typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+           for (size_t i = 0; i < n && ok; ++i) {
+               ok = fread(&key, sizeof(Key), 1, file) == 1 && fread(&value, sizeof(T), 1, file) == 1;
+               if (ok) {
+                   new (entries + i) value_type(*reinterpret_cast<const Key *>(&key), *reinterpret_cast<const T *>(&value));
+               }
+           }
+           slot_count = n;
+           if (ok) rankSlots();
+           if (!ok) {
+               // entries are trivially destructible, drop them without running release's loop
+               ::operator delete(entries);
+               entries = nullptr;
+               release();
+           }
+       }
+       return ok;
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+* map keys that carry a cached order-preserving prefix inline
+*/
+#ifndef SJTU_PREFIXED_KEY_HPP
+#define SJTU_PREFIXED_KEY_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace sjtu {
+
+/**
+ * key_prefix(k) maps a key to 64 bits such that
+ *   key_prefix(a) < key_prefix(b) implies a < b.
+ * Equal prefixes decide nothing, the full keys are compared then.
+ * Other key types provide an overload found by argument-dependent lookup
+ *   (Util::Bint does, see data/class-bint.hpp).
+ */
+inline unsigned long long key_prefix(const std::string &s) {
+   // the first 8 bytes big-endian, so the integer order is the byte order of std::string
+   unsigned long long prefix = 0;
+   for (size_t i = 0; i < 8; ++i) {
+       prefix <<= 8;
+       if (i < s.size()) {
+           prefix |= static_cast<unsigned char>(s[i]);
+       }
+   }
+   return prefix;
+}
+
+/**
+ * a key plus its key_prefix, for maps over keys that are expensive to compare.
+ * The prefix lives inside the map node next to the child pointers, so most
+ *   comparisons during a descent never touch the heap memory of the key;
+ *   only keys with equal prefixes fall back to Key's operator<.
+ * Converts implicitly from Key, so at(key), count(key), find(key) and
+ *   operator[](key) can be called with plain keys.
+ */
+template<class Key>
+class prefixed_key {
+  private:
+   unsigned long long prefix_;
+   Key key_;
+
+  public:
+   prefixed_key(const Key &key) : prefix_(key_prefix(key)), key_(key) {}
+
+   const Key &key() const {
+       return key_;
+   }
+
+   unsigned long long prefix() const {
+       return prefix_;
+   }
+
+   bool operator<(const prefixed_key &rhs) const {
+       if (prefix_ != rhs.prefix_) {
+           return prefix_ < rhs.prefix_;
+       }
+       return key_ < rhs.key_;
+   }
+
+   bool operator==(const prefixed_key &rhs) const {
+       return prefix_ == rhs.prefix_ && key_ == rhs.key_;
+   }
+
+   bool operator!=(const prefixed_key &rhs) const {
+       return !(*this == rhs);
+   }
+};
+
+}
+
+#endif
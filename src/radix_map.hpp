@@ -0,0 +1,950 @@
+/**
+* an ordered map on an adaptive radix tree, for integer, floating point and string keys
+*/
+#ifndef SJTU_RADIX_MAP_HPP
+#define SJTU_RADIX_MAP_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * radix_key_traits<Key> maps keys to order-preserving byte strings: comparing
+ *   encodings byte by byte (unsigned, shorter first on a tie) must order keys like
+ *   std::less<Key>, and no encoding may be a prefix of another.
+ * Traits of fixed-width encodings declare static const size_t width (> 0) and
+ *   encode(key, unsigned char *out), writing exactly width bytes; radix_map then
+ *   encodes into a buffer on the stack. Others provide encode(key, std::string &out),
+ *   appending the encoding.
+ * Provided for integers, float/double and std::string; specialize it for other keys.
+ */
+template<class Key, class Enable = void>
+struct radix_key_traits;
+
+template<class Key>
+struct radix_key_traits<Key, typename std::enable_if<std::is_integral<Key>::value>::type> {
+   static const size_t width = sizeof(Key);
+
+   static void encode(const Key &key, unsigned char *out) {
+       typedef typename std::make_unsigned<Key>::type bits_type;
+       bits_type bits = static_cast<bits_type>(key);
+       if (std::is_signed<Key>::value) {
+           // flip the sign bit so negative numbers sort first
+           bits ^= static_cast<bits_type>(static_cast<bits_type>(1) << (sizeof(Key) * 8 - 1));
+       }
+       for (size_t i = sizeof(Key); i > 0; --i) {
+           out[sizeof(Key) - i] = static_cast<unsigned char>(bits >> ((i - 1) * 8));
+       }
+   }
+};
+
+template<class Key>
+struct radix_key_traits<Key, typename std::enable_if<std::is_floating_point<Key>::value && sizeof(Key) == 8>::type> {
+   static const size_t width = 8;
+
+   static void encode(const Key &key, unsigned char *out) {
+       // -0.0 and 0.0 are the same key for std::less; NaN has no place in the order
+       Key normalized = key == 0 ? 0 : key;
+       unsigned long long bits;
+       memcpy(&bits, &normalized, sizeof(bits));
+       bits = (bits >> 63) ? ~bits : (bits | (1ULL << 63));
+       radix_key_traits<unsigned long long>::encode(bits, out);
+   }
+};
+
+template<class Key>
+struct radix_key_traits<Key, typename std::enable_if<std::is_floating_point<Key>::value && sizeof(Key) == 4>::type> {
+   static const size_t width = 4;
+
+   static void encode(const Key &key, unsigned char *out) {
+       Key normalized = key == 0 ? 0 : key;
+       unsigned int bits;
+       memcpy(&bits, &normalized, sizeof(bits));
+       bits = (bits >> 31) ? ~bits : (bits | (1U << 31));
+       radix_key_traits<unsigned int>::encode(bits, out);
+   }
+};
+
+template<>
+struct radix_key_traits<std::string> {
+   // 0x00 is escaped as 0x00 0xff and the key ends with 0x00 0x00, keeping it prefix-free
+   static void encode(const std::string &key, std::string &out) {
+       for (size_t i = 0; i < key.size(); ++i) {
+           out += key[i];
+           if (key[i] == '\0') out += '\xff';
+       }
+       out += '\0';
+       out += '\0';
+   }
+};
+
+// Traits::width if the traits declare one, 0 for variable-width encodings
+template<class Traits, class Enable = void>
+struct radix_key_width {
+   static const size_t value = 0;
+};
+
+template<class Traits>
+struct radix_key_width<Traits, typename std::enable_if<(Traits::width > 0)>::type> {
+   static const size_t value = Traits::width;
+};
+
+/**
+ * the encoding of one key, held on the stack when its width is fixed.
+ */
+template<class Key, class Traits, size_t Width = radix_key_width<Traits>::value>
+class radix_key_bytes {
+  private:
+   unsigned char bytes[Width];
+
+  public:
+   void assign(const Key &key) {
+       Traits::encode(key, bytes);
+   }
+
+   const unsigned char *data() const {
+       return bytes;
+   }
+
+   size_t size() const {
+       return Width;
+   }
+
+   bool operator==(const radix_key_bytes &rhs) const {
+       return memcmp(bytes, rhs.bytes, Width) == 0;
+   }
+};
+
+template<class Key, class Traits>
+class radix_key_bytes<Key, Traits, 0> {
+  private:
+   std::string bytes;
+
+  public:
+   void assign(const Key &key) {
+       bytes.clear();
+       Traits::encode(key, bytes);
+   }
+
+   // null-terminated, like std::string's
+   const unsigned char *data() const {
+       return reinterpret_cast<const unsigned char *>(bytes.c_str());
+   }
+
+   size_t size() const {
+       return bytes.size();
+   }
+
+   bool operator==(const radix_key_bytes &rhs) const {
+       return bytes == rhs.bytes;
+   }
+};
+
+/**
+ * radix_map<Key, T> has the interface of sjtu::map<Key, T>, ordered by
+ *   radix_key_traits<Key>, on an adaptive radix tree: inner nodes of 4, 16, 48 or
+ *   256 children chosen by fan-out, with compressed paths and leaves created at
+ *   the first distinguishing byte. A lookup costs O(key length) byte steps
+ *   instead of O(log n) key comparisons.
+ * Leaves are kept in a doubly linked list in key order, so iterators step in
+ *   O(1), stay valid until their element is erased, and throw invalid_iterator
+ *   like map's do.
+ */
+template<class Key, class T, class Traits = radix_key_traits<Key> >
+class radix_map {
+  public:
+   typedef pair<const Key, T> value_type;
+
+  private:
+   enum { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+   struct node {
+       unsigned char kind;
+       explicit node(unsigned char k) : kind(k) {}
+   };
+
+   struct leaf : node {
+       value_type data;
+       leaf *prev, *next;
+       explicit leaf(const value_type &value) : node(LEAF), data(value), prev(nullptr), next(nullptr) {}
+   };
+
+   struct inner : node {
+       std::string prefix;   // compressed path below the byte that leads here
+       unsigned short count;
+       explicit inner(unsigned char k) : node(k), count(0) {}
+   };
+
+   struct node4 : inner {
+       unsigned char keys[4];
+       node *children[4];
+       node4() : inner(NODE4) {}
+   };
+
+   struct node16 : inner {
+       unsigned char keys[16];
+       node *children[16];
+       node16() : inner(NODE16) {}
+   };
+
+   struct node48 : inner {
+       unsigned char index[256];   // slot + 1, 0 for none
+       node *children[48];
+       node48() : inner(NODE48) {
+           memset(index, 0, sizeof(index));
+       }
+   };
+
+   struct node256 : inner {
+       node *children[256];
+       node256() : inner(NODE256) {
+           memset(children, 0, sizeof(children));
+       }
+   };
+
+   typedef radix_key_bytes<Key, Traits> key_bytes;
+
+   node *root;
+   leaf *head, *tail;
+   size_t tree_size;
+
+   // number of keys of a sorted node4/node16 key array that are less than b
+   static unsigned rankIn(const unsigned char *keys, unsigned count, unsigned char b) {
+       unsigned i = 0;
+       while (i < count && keys[i] < b) ++i;
+       return i;
+   }
+
+   static unsigned rank16(const node16 *n, unsigned char b) {
+#if defined(__SSE2__)
+       // unsigned compare through a signed one with the top bits flipped
+       const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+       __m128i keys = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(n->keys)), flip);
+       __m128i probe = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(b)), flip);
+       unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(keys, probe)));
+       return static_cast<unsigned>(__builtin_popcount(mask & ((1U << n->count) - 1)));
+#else
+       return rankIn(n->keys, n->count, b);
+#endif
+   }
+
+   static node **findChild(inner *n, unsigned char b) {
+       switch (n->kind) {
+           case NODE4: {
+               node4 *p = static_cast<node4 *>(n);
+               for (unsigned i = 0; i < p->count; ++i) {
+                   if (p->keys[i] == b) return &p->children[i];
+               }
+               return nullptr;
+           }
+           case NODE16: {
+               node16 *p = static_cast<node16 *>(n);
+#if defined(__SSE2__)
+               __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+                                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p->keys)));
+               unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1U << p->count) - 1);
+               return mask ? &p->children[__builtin_ctz(mask)] : nullptr;
+#else
+               for (unsigned i = 0; i < p->count; ++i) {
+                   if (p->keys[i] == b) return &p->children[i];
+               }
+               return nullptr;
+#endif
+           }
+           case NODE48: {
+               node48 *p = static_cast<node48 *>(n);
+               return p->index[b] ? &p->children[p->index[b] - 1] : nullptr;
+           }
+           default: {
+               node256 *p = static_cast<node256 *>(n);
+               return p->children[b] != nullptr ? &p->children[b] : nullptr;
+           }
+       }
+   }
+
+   // the child with the largest byte below b (or at most 255 when below is false)
+   static node *childBelow(inner *n, unsigned b) {
+       switch (n->kind) {
+           case NODE4: {
+               node4 *p = static_cast<node4 *>(n);
+               unsigned r = b > 255 ? p->count : rankIn(p->keys, p->count, static_cast<unsigned char>(b));
+               return r ? p->children[r - 1] : nullptr;
+           }
+           case NODE16: {
+               node16 *p = static_cast<node16 *>(n);
+               unsigned r = b > 255 ? p->count : rank16(p, static_cast<unsigned char>(b));
+               return r ? p->children[r - 1] : nullptr;
+           }
+           case NODE48: {
+               node48 *p = static_cast<node48 *>(n);
+               for (unsigned i = b; i > 0; --i) {
+                   if (p->index[i - 1]) return p->children[p->index[i - 1] - 1];
+               }
+               return nullptr;
+           }
+           default: {
+               node256 *p = static_cast<node256 *>(n);
+               for (unsigned i = b; i > 0; --i) {
+                   if (p->children[i - 1] != nullptr) return p->children[i - 1];
+               }
+               return nullptr;
+           }
+       }
+   }
+
+   static leaf *maximumLeaf(node *n) {
+       while (n->kind != LEAF) {
+           n = childBelow(static_cast<inner *>(n), 256);
+       }
+       return static_cast<leaf *>(n);
+   }
+
+   static void copyHeader(inner *to, const inner *from) {
+       to->prefix = from->prefix;
+       to->count = from->count;
+   }
+
+   // add child under byte b; a full node is replaced by the next larger kind through ref
+   static void addChild(node *&ref, inner *n, unsigned char b, node *child) {
+       switch (n->kind) {
+           case NODE4: {
+               node4 *p = static_cast<node4 *>(n);
+               if (p->count < 4) {
+                   unsigned r = rankIn(p->keys, p->count, b);
+                   for (unsigned i = p->count; i > r; --i) {
+                       p->keys[i] = p->keys[i - 1];
+                       p->children[i] = p->children[i - 1];
+                   }
+                   p->keys[r] = b;
+                   p->children[r] = child;
+                   ++p->count;
+                   return;
+               }
+               node16 *q = new node16;
+               copyHeader(q, p);
+               memcpy(q->keys, p->keys, 4);
+               memcpy(q->children, p->children, 4 * sizeof(node *));
+               ref = q;
+               delete p;
+               addChild(ref, q, b, child);
+               return;
+           }
+           case NODE16: {
+               node16 *p = static_cast<node16 *>(n);
+               if (p->count < 16) {
+                   unsigned r = rank16(p, b);
+                   for (unsigned i = p->count; i > r; --i) {
+                       p->keys[i] = p->keys[i - 1];
+                       p->children[i] = p->children[i - 1];
+                   }
+                   p->keys[r] = b;
+                   p->children[r] = child;
+                   ++p->count;
+                   return;
+               }
+               node48 *q = new node48;
+               copyHeader(q, p);
+               for (unsigned i = 0; i < 16; ++i) {
+                   q->children[i] = p->children[i];
+                   q->index[p->keys[i]] = static_cast<unsigned char>(i + 1);
+               }
+               ref = q;
+               delete p;
+               addChild(ref, q, b, child);
+               return;
+           }
+           case NODE48: {
+               node48 *p = static_cast<node48 *>(n);
+               if (p->count < 48) {
+                   p->children[p->count] = child;
+                   p->index[b] = static_cast<unsigned char>(++p->count);
+                   return;
+               }
+               node256 *q = new node256;
+               copyHeader(q, p);
+               for (unsigned i = 0; i < 256; ++i) {
+                   if (p->index[i]) q->children[i] = p->children[p->index[i] - 1];
+               }
+               ref = q;
+               delete p;
+               addChild(ref, q, b, child);
+               return;
+           }
+           default: {
+               node256 *p = static_cast<node256 *>(n);
+               p->children[b] = child;
+               ++p->count;
+               return;
+           }
+       }
+   }
+
+   // merge a node4 left with one child into that child
+   static void collapse(node *&ref, node4 *p) {
+       node *child = p->children[0];
+       if (child->kind != LEAF) {
+           inner *c = static_cast<inner *>(child);
+           std::string prefix = p->prefix;
+           prefix += static_cast<char>(p->keys[0]);
+           prefix += c->prefix;
+           c->prefix.swap(prefix);
+       }
+       ref = child;
+       delete p;
+   }
+
+   // remove the child under byte b; an underfull node shrinks through ref
+   static void removeChild(node *&ref, inner *n, unsigned char b) {
+       switch (n->kind) {
+           case NODE4: {
+               node4 *p = static_cast<node4 *>(n);
+               unsigned r = rankIn(p->keys, p->count, b);
+               for (unsigned i = r + 1; i < p->count; ++i) {
+                   p->keys[i - 1] = p->keys[i];
+                   p->children[i - 1] = p->children[i];
+               }
+               if (--p->count == 1) collapse(ref, p);
+               return;
+           }
+           case NODE16: {
+               node16 *p = static_cast<node16 *>(n);
+               unsigned r = rank16(p, b);
+               for (unsigned i = r + 1; i < p->count; ++i) {
+                   p->keys[i - 1] = p->keys[i];
+                   p->children[i - 1] = p->children[i];
+               }
+               if (--p->count == 3) {
+                   node4 *q = new node4;
+                   copyHeader(q, p);
+                   memcpy(q->keys, p->keys, 3);
+                   memcpy(q->children, p->children, 3 * sizeof(node *));
+                   ref = q;
+                   delete p;
+               }
+               return;
+           }
+           case NODE48: {
+               node48 *p = static_cast<node48 *>(n);
+               unsigned slot = p->index[b] - 1;
+               p->index[b] = 0;
+               unsigned last = --p->count;
+               if (slot != last) {
+                   // move the last slot into the hole
+                   p->children[slot] = p->children[last];
+                   for (unsigned i = 0; i < 256; ++i) {
+                       if (p->index[i] == last + 1) {
+                           p->index[i] = static_cast<unsigned char>(slot + 1);
+                           break;
+                       }
+                   }
+               }
+               if (p->count == 12) {
+                   node16 *q = new node16;
+                   copyHeader(q, p);
+                   unsigned k = 0;
+                   for (unsigned i = 0; i < 256; ++i) {
+                       if (p->index[i]) {
+                           q->keys[k] = static_cast<unsigned char>(i);
+                           q->children[k++] = p->children[p->index[i] - 1];
+                       }
+                   }
+                   ref = q;
+                   delete p;
+               }
+               return;
+           }
+           default: {
+               node256 *p = static_cast<node256 *>(n);
+               p->children[b] = nullptr;
+               if (--p->count == 37) {
+                   node48 *q = new node48;
+                   copyHeader(q, p);
+                   unsigned k = 0;
+                   for (unsigned i = 0; i < 256; ++i) {
+                       if (p->children[i] != nullptr) {
+                           q->children[k] = p->children[i];
+                           q->index[i] = static_cast<unsigned char>(++k);
+                       }
+                   }
+                   ref = q;
+                   delete p;
+               }
+               return;
+           }
+       }
+   }
+
+   static void destroy(node *n) {
+       switch (n->kind) {
+           case LEAF:
+               delete static_cast<leaf *>(n);
+               return;
+           case NODE4: {
+               node4 *p = static_cast<node4 *>(n);
+               for (unsigned i = 0; i < p->count; ++i) destroy(p->children[i]);
+               delete p;
+               return;
+           }
+           case NODE16: {
+               node16 *p = static_cast<node16 *>(n);
+               for (unsigned i = 0; i < p->count; ++i) destroy(p->children[i]);
+               delete p;
+               return;
+           }
+           case NODE48: {
+               node48 *p = static_cast<node48 *>(n);
+               for (unsigned i = 0; i < p->count; ++i) destroy(p->children[i]);
+               delete p;
+               return;
+           }
+           default: {
+               node256 *p = static_cast<node256 *>(n);
+               for (unsigned i = 0; i < 256; ++i) {
+                   if (p->children[i] != nullptr) destroy(p->children[i]);
+               }
+               delete p;
+               return;
+           }
+       }
+   }
+
+   leaf *findLeaf(const Key &key) const {
+       key_bytes encoded, other;
+       encoded.assign(key);
+       const unsigned char *bytes = encoded.data();
+       size_t length = encoded.size();
+       node *n = root;
+       size_t depth = 0;
+       while (n != nullptr && n->kind != LEAF) {
+           inner *p = static_cast<inner *>(n);
+           // the key must go on past the path to pick a child
+           if (depth + p->prefix.size() >= length) return nullptr;
+           if (p->prefix.size() > 0) {
+               if (memcmp(bytes + depth, p->prefix.data(), p->prefix.size()) != 0) return nullptr;
+               depth += p->prefix.size();
+           }
+           node **slot = findChild(p, bytes[depth]);
+           if (slot == nullptr) return nullptr;
+           n = *slot;
+           ++depth;
+       }
+       if (n == nullptr) return nullptr;
+       leaf *l = static_cast<leaf *>(n);
+       other.assign(l->data.first);
+       return other == encoded ? l : nullptr;
+   }
+
+   // the leaf before the one for bytes, which must be in the tree already
+   leaf *predecessor(const unsigned char *bytes) const {
+       node *n = root, *below = nullptr;
+       size_t depth = 0;
+       while (n->kind != LEAF) {
+           inner *p = static_cast<inner *>(n);
+           depth += p->prefix.size();
+           unsigned char b = bytes[depth];
+           node *left = childBelow(p, b);
+           if (left != nullptr) below = left;
+           n = *findChild(p, b);
+           ++depth;
+       }
+       return below != nullptr ? maximumLeaf(below) : nullptr;
+   }
+
+   void linkLeaf(leaf *l, const unsigned char *bytes) {
+       leaf *prev = predecessor(bytes);
+       l->prev = prev;
+       l->next = prev != nullptr ? prev->next : head;
+       if (l->next != nullptr) l->next->prev = l;
+       else tail = l;
+       if (prev != nullptr) prev->next = l;
+       else head = l;
+   }
+
+   // returns the leaf holding the key of value, inserted is true if it is new
+   leaf *insertLeaf(const value_type &value, bool &inserted) {
+       key_bytes encoded, otherEncoded;
+       encoded.assign(value.first);
+       // prefix-free encodings part before either ends, so no index below runs past one
+       const unsigned char *bytes = encoded.data();
+       node **ref = &root;
+       size_t depth = 0;
+       inserted = false;
+       while (true) {
+           node *n = *ref;
+           if (n == nullptr) {
+               leaf *l = new leaf(value);
+               *ref = l;
+               inserted = true;
+               linkLeaf(l, bytes);
+               return l;
+           }
+           if (n->kind == LEAF) {
+               leaf *existing = static_cast<leaf *>(n);
+               otherEncoded.assign(existing->data.first);
+               if (otherEncoded == encoded) return existing;
+               const unsigned char *other = otherEncoded.data();
+               // split the leaf: a node4 over the bytes both keys still share
+               size_t i = depth;
+               while (bytes[i] == other[i]) ++i;
+               leaf *l = new leaf(value);
+               node4 *split = new node4;
+               split->prefix.assign(reinterpret_cast<const char *>(bytes + depth), i - depth);
+               unsigned char a = bytes[i], c = other[i];
+               split->keys[0] = a < c ? a : c;
+               split->children[0] = a < c ? static_cast<node *>(l) : existing;
+               split->keys[1] = a < c ? c : a;
+               split->children[1] = a < c ? static_cast<node *>(existing) : l;
+               split->count = 2;
+               *ref = split;
+               inserted = true;
+               linkLeaf(l, bytes);
+               return l;
+           }
+           inner *p = static_cast<inner *>(n);
+           size_t matched = 0;
+           while (matched < p->prefix.size() &&
+                  static_cast<unsigned char>(p->prefix[matched]) == bytes[depth + matched]) {
+               ++matched;
+           }
+           if (matched < p->prefix.size()) {
+               // the key leaves the compressed path: split it
+               leaf *l = new leaf(value);
+               node4 *split = new node4;
+               split->prefix.assign(p->prefix, 0, matched);
+               unsigned char a = bytes[depth + matched];
+               unsigned char c = static_cast<unsigned char>(p->prefix[matched]);
+               p->prefix.erase(0, matched + 1);
+               split->keys[0] = a < c ? a : c;
+               split->children[0] = a < c ? static_cast<node *>(l) : p;
+               split->keys[1] = a < c ? c : a;
+               split->children[1] = a < c ? static_cast<node *>(p) : l;
+               split->count = 2;
+               *ref = split;
+               inserted = true;
+               linkLeaf(l, bytes);
+               return l;
+           }
+           depth += p->prefix.size();
+           unsigned char b = bytes[depth];
+           node **slot = findChild(p, b);
+           if (slot == nullptr) {
+               leaf *l = new leaf(value);
+               addChild(*ref, p, b, l);
+               inserted = true;
+               linkLeaf(l, bytes);
+               return l;
+           }
+           ref = slot;
+           ++depth;
+       }
+   }
+
+   void eraseLeaf(leaf *l) {
+       key_bytes encoded;
+       encoded.assign(l->data.first);
+       const unsigned char *bytes = encoded.data();
+       node **ref = &root, **parentRef = nullptr;
+       unsigned char parentByte = 0;
+       size_t depth = 0;
+       while ((*ref)->kind != LEAF) {
+           inner *p = static_cast<inner *>(*ref);
+           depth += p->prefix.size();
+           parentRef = ref;
+           parentByte = bytes[depth];
+           ref = findChild(p, parentByte);
+           ++depth;
+       }
+       if (parentRef == nullptr) {
+           root = nullptr;
+       } else {
+           removeChild(*parentRef, static_cast<inner *>(*parentRef), parentByte);
+       }
+       if (l->prev != nullptr) l->prev->next = l->next;
+       else head = l->next;
+       if (l->next != nullptr) l->next->prev = l->prev;
+       else tail = l->prev;
+       delete l;
+       --tree_size;
+   }
+
+  public:
+   class const_iterator;
+   class iterator {
+      private:
+       leaf *node_;
+       const radix_map *container;
+
+      public:
+       iterator() : node_(nullptr), container(nullptr) {}
+
+       iterator(leaf *n, const radix_map *c) : node_(n), container(c) {}
+
+       iterator operator++(int) {
+           iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       iterator &operator++() {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           node_ = node_->next;
+           return *this;
+       }
+
+       iterator operator--(int) {
+           iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       iterator &operator--() {
+           leaf *prev = node_ == nullptr ? (container == nullptr ? nullptr : container->tail) : node_->prev;
+           if (prev == nullptr) {
+               throw invalid_iterator();
+           }
+           node_ = prev;
+           return *this;
+       }
+
+       value_type &operator*() const {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           return node_->data;
+       }
+
+       value_type *operator->() const {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           return &node_->data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return node_ == rhs.node_ && container == rhs.container;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return node_ == rhs.node_ && container == rhs.container;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       friend class radix_map;
+       friend class const_iterator;
+   };
+
+   class const_iterator {
+      private:
+       const leaf *node_;
+       const radix_map *container;
+
+      public:
+       const_iterator() : node_(nullptr), container(nullptr) {}
+
+       const_iterator(const leaf *n, const radix_map *c) : node_(n), container(c) {}
+
+       const_iterator(const iterator &other) : node_(other.node_), container(other.container) {}
+
+       const_iterator operator++(int) {
+           const_iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       const_iterator &operator++() {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           node_ = node_->next;
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       const_iterator &operator--() {
+           const leaf *prev = node_ == nullptr ? (container == nullptr ? nullptr : container->tail) : node_->prev;
+           if (prev == nullptr) {
+               throw invalid_iterator();
+           }
+           node_ = prev;
+           return *this;
+       }
+
+       const value_type &operator*() const {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           return node_->data;
+       }
+
+       const value_type *operator->() const {
+           if (node_ == nullptr) {
+               throw invalid_iterator();
+           }
+           return &node_->data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return node_ == rhs.node_ && container == rhs.container;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return node_ == rhs.node_ && container == rhs.container;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       friend class radix_map;
+   };
+
+   radix_map() : root(nullptr), head(nullptr), tail(nullptr), tree_size(0) {}
+
+   radix_map(const radix_map &other) : root(nullptr), head(nullptr), tail(nullptr), tree_size(0) {
+       for (const leaf *l = other.head; l != nullptr; l = l->next) {
+           insert(l->data);
+       }
+   }
+
+   radix_map &operator=(const radix_map &other) {
+       if (this != &other) {
+           clear();
+           for (const leaf *l = other.head; l != nullptr; l = l->next) {
+               insert(l->data);
+           }
+       }
+       return *this;
+   }
+
+   ~radix_map() {
+       clear();
+   }
+
+   /**
+  * access specified element with bounds checking, throw index_out_of_bound if absent.
+    */
+   T &at(const Key &key) {
+       leaf *l = findLeaf(key);
+       if (l == nullptr) {
+           throw index_out_of_bound();
+       }
+       return l->data.second;
+   }
+
+   const T &at(const Key &key) const {
+       const leaf *l = findLeaf(key);
+       if (l == nullptr) {
+           throw index_out_of_bound();
+       }
+       return l->data.second;
+   }
+
+   /**
+  * access specified element, inserting a default constructed value if absent.
+    */
+   T &operator[](const Key &key) {
+       leaf *l = findLeaf(key);
+       if (l != nullptr) {
+           return l->data.second;
+       }
+       return insert(value_type(key, T())).first->second;
+   }
+
+   const T &operator[](const Key &key) const {
+       return at(key);
+   }
+
+   iterator begin() {
+       return iterator(head, this);
+   }
+
+   const_iterator cbegin() const {
+       return const_iterator(head, this);
+   }
+
+   iterator end() {
+       return iterator(nullptr, this);
+   }
+
+   const_iterator cend() const {
+       return const_iterator(nullptr, this);
+   }
+
+   bool empty() const {
+       return tree_size == 0;
+   }
+
+   size_t size() const {
+       return tree_size;
+   }
+
+   void clear() {
+       if (root != nullptr) destroy(root);
+       root = nullptr;
+       head = tail = nullptr;
+       tree_size = 0;
+   }
+
+   /**
+  * insert an element, return the iterator to it (or to the element that
+  *   prevented the insertion) and whether it was inserted.
+    */
+   pair<iterator, bool> insert(const value_type &value) {
+       bool inserted;
+       leaf *l = insertLeaf(value, inserted);
+       if (inserted) ++tree_size;
+       return pair<iterator, bool>(iterator(l, this), inserted);
+   }
+
+   /**
+  * erase the element at pos, throw invalid_iterator for end() or a foreign iterator.
+    */
+   void erase(iterator pos) {
+       if (pos.container != this || pos.node_ == nullptr) {
+           throw invalid_iterator();
+       }
+       eraseLeaf(pos.node_);
+   }
+
+   size_t count(const Key &key) const {
+       return findLeaf(key) != nullptr ? 1 : 0;
+   }
+
+   iterator find(const Key &key) {
+       return iterator(findLeaf(key), this);
+   }
+
+   const_iterator find(const Key &key) const {
+       return const_iterator(findLeaf(key), this);
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+/**
+* a map of 2D points answering orthogonal range counts and reports in polylog time
+*/
+#ifndef SJTU_RANGE_MAP_HPP
+#define SJTU_RANGE_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * range_map<X, Y, T> maps points (x, y) to values, like a map keyed by (x, y), and
+ *   answers count(x1, x2, y1, y2) and report(x1, x2, y1, y2, visit) for the points
+ *   with x1 <= x <= x2 and y1 <= y <= y2 in O(log^2 n), plus the number reported.
+ * The points live in a sjtu::map ordered by x, then y. Next to it, in the manner of
+ *   Bentley and Saxe, sit static layered range trees of 1, 2, 4, ... points; each
+ *   answers a query in O(log n) by fractional cascading. insert builds a tree from
+ *   the new point and the trees of every size below the first missing one, like a
+ *   binary counter increments, in O(log^2 n) amortized.
+ * erase cannot take a point out of a static tree, so it marks the point dead, for
+ *   report to skip, and adds it to a second such family of trees, which count
+ *   subtracts. Once dead points outnumber live ones, everything is rebuilt from the
+ *   map.
+ * Space is O(n log n).
+ */
+template<class X, class Y, class T, class CompareX = std::less<X>, class CompareY = std::less<Y> >
+class range_map {
+  private:
+   struct entry {
+       X x;
+       Y y;
+       T value;
+       bool alive;
+       entry(const X &px, const Y &py, const T &v) : x(px), y(py), value(v), alive(true) {}
+   };
+
+   struct key_compare {
+       CompareX lessX;
+       CompareY lessY;
+       bool operator()(const pair<X, Y> &a, const pair<X, Y> &b) const {
+           if (lessX(a.first, b.first)) return true;
+           if (lessX(b.first, a.first)) return false;
+           return lessY(a.second, b.second);
+       }
+   };
+
+   typedef map<pair<X, Y>, entry *, key_compare> index_type;
+
+   /**
+  * a layered range tree over a fixed set of points.
+  * levels[0] holds them sorted by (x, y). In levels[d], every aligned block of 2^d
+  *   positions holds the same points as in levels[0], sorted by y: the merge of its
+  *   two halves in levels[d - 1], which are its children.
+  * left[d][i] is how many of the positions before i in i's block came from the
+  *   left half; it maps a rank in a block to the ranks in both children in O(1),
+  *   so a query searches y only once, at the root.
+    */
+   class layer {
+      private:
+       std::vector<std::vector<entry *> > levels;
+       std::vector<std::vector<unsigned int> > left;
+       const range_map *owner;
+
+       // how many of the first p points of the block at start of levels[d] are in its left half
+       size_t leftRank(size_t d, size_t start, size_t p) const {
+           size_t length = std::min(levels[0].size() - start, size_t(1) << d);
+           if (p < length) return left[d][start + p];
+           return std::min(length, size_t(1) << (d - 1));
+       }
+
+       /**
+      * visit the block at start of levels[d] for points with x in positions [l, r)
+      *   of levels[0], given that its positions [start + a, start + b) are the ones
+      *   with y in range; a block inside [l, r) hands them to take.
+        */
+       template<class Take>
+       void descend(size_t d, size_t start, size_t a, size_t b, size_t l, size_t r, Take &take) const {
+           size_t end = std::min(levels[0].size(), start + (size_t(1) << d));
+           if (a >= b || end <= l || r <= start) return;
+           if (l <= start && end <= r) {
+               take(levels[d], start + a, start + b);
+               return;
+           }
+           size_t la = leftRank(d, start, a), lb = leftRank(d, start, b);
+           size_t half = size_t(1) << (d - 1);
+           descend(d - 1, start, la, lb, l, r, take);
+           descend(d - 1, start + half, a - la, b - lb, l, r, take);
+       }
+
+       template<class Take>
+       void query(const X &x1, const X &x2, const Y &y1, const Y &y2, Take &take) const {
+           const std::vector<entry *> &byX = levels[0];
+           const CompareX &lessX = owner->lessX;
+           const CompareY &lessY = owner->lessY;
+           size_t l = std::lower_bound(byX.begin(), byX.end(), x1,
+                                       [&lessX](const entry *e, const X &x) { return lessX(e->x, x); }) - byX.begin();
+           size_t r = std::upper_bound(byX.begin(), byX.end(), x2,
+                                       [&lessX](const X &x, const entry *e) { return lessX(x, e->x); }) - byX.begin();
+           if (l >= r) return;
+           const std::vector<entry *> &root = levels.back();
+           size_t a = std::lower_bound(root.begin(), root.end(), y1,
+                                       [&lessY](const entry *e, const Y &y) { return lessY(e->y, y); }) - root.begin();
+           size_t b = std::upper_bound(root.begin(), root.end(), y2,
+                                       [&lessY](const Y &y, const entry *e) { return lessY(y, e->y); }) - root.begin();
+           descend(levels.size() - 1, 0, a, b, l, r, take);
+       }
+
+      public:
+       explicit layer(const range_map *o) : owner(o) {}
+
+       bool empty() const {
+           return levels.empty();
+       }
+
+       size_t size() const {
+           return levels.empty() ? 0 : levels[0].size();
+       }
+
+       const std::vector<entry *> &points() const {
+           return levels[0];
+       }
+
+       void clear() {
+           levels.clear();
+           left.clear();
+       }
+
+       // build over points, which must be sorted by (x, y)
+       void build(std::vector<entry *> &points) {
+           clear();
+           size_t n = points.size();
+           levels.push_back(std::vector<entry *>());
+           levels[0].swap(points);
+           left.push_back(std::vector<unsigned int>());
+           for (size_t d = 1; (size_t(1) << (d - 1)) < n; ++d) {
+               const std::vector<entry *> &prev = levels[d - 1];
+               std::vector<entry *> merged(n);
+               std::vector<unsigned int> fromLeft(n);
+               size_t width = size_t(1) << d, half = width >> 1;
+               for (size_t start = 0; start < n; start += width) {
+                   size_t mid = std::min(n, start + half), end = std::min(n, start + width);
+                   size_t i = start, j = mid;
+                   unsigned int taken = 0;
+                   for (size_t k = start; k < end; ++k) {
+                       fromLeft[k] = taken;
+                       if (j == end || (i < mid && !owner->lessY(prev[j]->y, prev[i]->y))) {
+                           merged[k] = prev[i++];
+                           ++taken;
+                       } else {
+                           merged[k] = prev[j++];
+                       }
+                   }
+               }
+               levels.push_back(std::vector<entry *>());
+               levels.back().swap(merged);
+               left.push_back(std::vector<unsigned int>());
+               left.back().swap(fromLeft);
+           }
+       }
+
+       size_t count(const X &x1, const X &x2, const Y &y1, const Y &y2) const {
+           size_t total = 0;
+           auto take = [&total](const std::vector<entry *> &, size_t from, size_t to) { total += to - from; };
+           query(x1, x2, y1, y2, take);
+           return total;
+       }
+
+       template<class Visit>
+       void report(const X &x1, const X &x2, const Y &y1, const Y &y2, Visit &visit) const {
+           auto take = [&visit](const std::vector<entry *> &level, size_t from, size_t to) {
+               for (size_t i = from; i < to; ++i) {
+                   const entry *e = level[i];
+                   if (e->alive) visit(e->x, e->y, e->value);
+               }
+           };
+           query(x1, x2, y1, y2, take);
+       }
+   };
+
+   index_type index;
+   // slot i of each family is empty or a tree of 2^i points
+   std::vector<layer> inserted, erased;
+   // erased points, still referenced by the trees until the next rebuild
+   std::vector<entry *> dead;
+   CompareX lessX;
+   CompareY lessY;
+
+   bool lessXY(const entry *a, const entry *b) const {
+       if (lessX(a->x, b->x)) return true;
+       if (lessX(b->x, a->x)) return false;
+       return lessY(a->y, b->y);
+   }
+
+   // add e to a family of trees, merging the full slots below the first free one
+   void push(std::vector<layer> &family, entry *e) {
+       std::vector<entry *> carry(1, e);
+       size_t slot = 0;
+       for (; slot < family.size() && !family[slot].empty(); ++slot) {
+           const std::vector<entry *> &points = family[slot].points();
+           std::vector<entry *> merged(carry.size() + points.size());
+           std::merge(points.begin(), points.end(), carry.begin(), carry.end(), merged.begin(),
+                      [this](const entry *a, const entry *b) { return lessXY(a, b); });
+           carry.swap(merged);
+           family[slot].clear();
+       }
+       if (slot == family.size()) family.push_back(layer(this));
+       family[slot].build(carry);
+   }
+
+   // drop the dead points: rebuild the inserted trees from the map, one per bit of its size
+   void rebuild() {
+       for (size_t i = 0; i < dead.size(); ++i) delete dead[i];
+       dead.clear();
+       inserted.clear();
+       erased.clear();
+       std::vector<entry *> all;
+       all.reserve(index.size());
+       for (typename index_type::const_iterator it = index.cbegin(); it != index.cend(); ++it) {
+           all.push_back(it->second);
+       }
+       size_t start = 0;
+       for (size_t slot = 0; (all.size() >> slot) > 0; ++slot) {
+           inserted.push_back(layer(this));
+           if (((all.size() >> slot) & 1) == 0) continue;
+           std::vector<entry *> points(all.begin() + start, all.begin() + start + (size_t(1) << slot));
+           start += size_t(1) << slot;
+           inserted[slot].build(points);
+       }
+   }
+
+  public:
+   range_map() {}
+
+   range_map(const range_map &) = delete;
+   range_map &operator=(const range_map &) = delete;
+
+   ~range_map() {
+       clear();
+   }
+
+   /**
+  * insert value at (x, y) if no point is there yet; return whether it was inserted.
+    */
+   bool insert(const X &x, const Y &y, const T &value) {
+       pair<X, Y> key(x, y);
+       if (index.count(key) > 0) return false;
+       entry *e = new entry(x, y, value);
+       index.insert(typename index_type::value_type(key, e));
+       push(inserted, e);
+       return true;
+   }
+
+   /**
+  * remove the point at (x, y); return the number of points removed (0 or 1).
+    */
+   size_t erase(const X &x, const Y &y) {
+       typename index_type::iterator it = index.find(pair<X, Y>(x, y));
+       if (it == index.end()) return 0;
+       entry *e = it->second;
+       index.erase(it);
+       e->alive = false;
+       dead.push_back(e);
+       if (dead.size() > index.size()) {
+           rebuild();
+       } else {
+           push(erased, e);
+       }
+       return 1;
+   }
+
+   /**
+  * the value at (x, y), throw index_out_of_bound if there is no point there.
+    */
+   T &at(const X &x, const Y &y) {
+       return index.at(pair<X, Y>(x, y))->value;
+   }
+
+   const T &at(const X &x, const Y &y) const {
+       return index.at(pair<X, Y>(x, y))->value;
+   }
+
+   size_t count(const X &x, const Y &y) const {
+       return index.count(pair<X, Y>(x, y));
+   }
+
+   /**
+  * the number of points with x1 <= x <= x2 and y1 <= y <= y2.
+    */
+   size_t count(const X &x1, const X &x2, const Y &y1, const Y &y2) const {
+       if (lessX(x2, x1) || lessY(y2, y1)) return 0;
+       size_t total = 0;
+       for (size_t i = 0; i < inserted.size(); ++i) {
+           if (!inserted[i].empty()) total += inserted[i].count(x1, x2, y1, y2);
+       }
+       for (size_t i = 0; i < erased.size(); ++i) {
+           if (!erased[i].empty()) total -= erased[i].count(x1, x2, y1, y2);
+       }
+       return total;
+   }
+
+   /**
+  * call visit(x, y, value) for every point with x1 <= x <= x2 and y1 <= y <= y2,
+  *   in no particular order. visit must not modify the range_map.
+    */
+   template<class Visit>
+   void report(const X &x1, const X &x2, const Y &y1, const Y &y2, Visit visit) const {
+       if (lessX(x2, x1) || lessY(y2, y1)) return;
+       for (size_t i = 0; i < inserted.size(); ++i) {
+           if (!inserted[i].empty()) inserted[i].report(x1, x2, y1, y2, visit);
+       }
+   }
+
+   size_t size() const {
+       return index.size();
+   }
+
+   bool empty() const {
+       return index.empty();
+   }
+
+   void clear() {
+       for (typename index_type::iterator it = index.begin(); it != index.end(); ++it) {
+           delete it->second;
+       }
+       index.clear();
+       for (size_t i = 0; i < dead.size(); ++i) delete dead[i];
+       dead.clear();
+       inserted.clear();
+       erased.clear();
+   }
+};
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+/**
+* an immutable ordered map built at compile time
+*/
+#ifndef SJTU_STATIC_MAP_HPP
+#define SJTU_STATIC_MAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * an entry of a static_map; a plain { first, second } struct rather than
+ *   sjtu::pair, whose constructors are not constexpr.
+ */
+template<class Key, class T>
+struct static_map_entry {
+   Key first;
+   T second;
+
+   constexpr static_map_entry() : first(), second() {}
+
+   constexpr static_map_entry(const Key &k, const T &v) : first(k), second(v) {}
+};
+
+/**
+ * static_map<Key, T, N> holds N entries in a sorted array and answers lookups
+ *   by binary search. Construction is constexpr, so a table declared
+ *       constexpr auto table = make_static_map<int, int>({{3, 30}, {1, 10}, {2, 20}});
+ *   is sorted by the compiler and placed in read-only data: no heap, no startup cost.
+ * Key, T and Compare must be literal types for that; in a non-constant
+ *   context any types work and the sort simply runs at runtime.
+ * Duplicate keys are rejected by throwing runtime_error, which is a compile error
+ *   in a constant expression.
+ */
+template<class Key, class T, size_t N, class Compare = std::less<Key> >
+class static_map {
+  public:
+   typedef static_map_entry<Key, T> value_type;
+
+   class const_iterator {
+      private:
+       const value_type *entry;
+       const static_map *container;
+
+      public:
+       constexpr const_iterator() : entry(nullptr), container(nullptr) {}
+
+       constexpr const_iterator(const value_type *e, const static_map *c) : entry(e), container(c) {}
+
+       const_iterator operator++(int) {
+           const_iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       const_iterator &operator++() {
+           if (container == nullptr || entry == container->entries + N) {
+               throw invalid_iterator();
+           }
+           ++entry;
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       const_iterator &operator--() {
+           if (container == nullptr || entry == container->entries) {
+               throw invalid_iterator();
+           }
+           --entry;
+           return *this;
+       }
+
+       constexpr const value_type &operator*() const {
+           return container == nullptr || entry == container->entries + N ? throw invalid_iterator() : *entry;
+       }
+
+       constexpr const value_type *operator->() const {
+           return &**this;
+       }
+
+       constexpr bool operator==(const const_iterator &rhs) const {
+           return entry == rhs.entry && container == rhs.container;
+       }
+
+       constexpr bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+   };
+
+   typedef const_iterator iterator;
+
+  private:
+   value_type entries[N];
+
+   // the first entry not less than key
+   constexpr size_t lowerBound(const Key &key) const {
+       size_t lo = 0, hi = N;
+       while (lo < hi) {
+           size_t mid = lo + (hi - lo) / 2;
+           if (Compare()(entries[mid].first, key)) lo = mid + 1;
+           else hi = mid;
+       }
+       return lo;
+   }
+
+   constexpr size_t indexOf(const Key &key) const {
+       size_t i = lowerBound(key);
+       return i < N && !Compare()(key, entries[i].first) ? i : N;
+   }
+
+  public:
+   /**
+  * sort init by key; insertion sort keeps the constexpr evaluation simple
+  *   and is quadratic only in the size of a hand-written table.
+    */
+   constexpr explicit static_map(const value_type (&init)[N]) : entries() {
+       for (size_t i = 0; i < N; ++i) {
+           value_type current = init[i];
+           size_t j = i;
+           while (j > 0 && Compare()(current.first, entries[j - 1].first)) {
+               entries[j] = entries[j - 1];
+               --j;
+           }
+           entries[j] = current;
+       }
+       for (size_t i = 1; i < N; ++i) {
+           if (!Compare()(entries[i - 1].first, entries[i].first)) {
+               throw runtime_error();
+           }
+       }
+   }
+
+   /**
+  * access specified element with bounds checking, throw index_out_of_bound if absent.
+    */
+   constexpr const T &at(const Key &key) const {
+       size_t i = indexOf(key);
+       if (i == N) {
+           throw index_out_of_bound();
+       }
+       return entries[i].second;
+   }
+
+   constexpr const T &operator[](const Key &key) const {
+       return at(key);
+   }
+
+   constexpr const_iterator begin() const {
+       return const_iterator(entries, this);
+   }
+
+   constexpr const_iterator cbegin() const {
+       return begin();
+   }
+
+   constexpr const_iterator end() const {
+       return const_iterator(entries + N, this);
+   }
+
+   constexpr const_iterator cend() const {
+       return end();
+   }
+
+   constexpr bool empty() const {
+       return N == 0;
+   }
+
+   constexpr size_t size() const {
+       return N;
+   }
+
+   constexpr size_t count(const Key &key) const {
+       return indexOf(key) == N ? 0 : 1;
+   }
+
+   constexpr const_iterator find(const Key &key) const {
+       return const_iterator(entries + indexOf(key), this);
+   }
+
+   constexpr const_iterator lower_bound(const Key &key) const {
+       return const_iterator(entries + lowerBound(key), this);
+   }
+};
+
+/**
+ * deduces N from a braced list: make_static_map<Key, T>({{k, v}, ...}).
+ */
+template<class Key, class T, class Compare = std::less<Key>, size_t N>
+constexpr static_map<Key, T, N, Compare> make_static_map(const static_map_entry<Key, T> (&init)[N]) {
+   return static_map<Key, T, N, Compare>(init);
+}
+
+}
+
+#endif
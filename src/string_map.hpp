@@ -0,0 +1,828 @@
+/**
+* an ordered map from std::string keys that stores its keys front-coded in pages
+*/
+#ifndef SJTU_STRING_MAP_HPP
+#define SJTU_STRING_MAP_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "map.hpp"
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * string_map<T> behaves like map<std::string, T> for keys sharing long prefixes
+ *   (paths, hierarchical ids), but keeps the keys in pages of up to PAGE_CAPACITY
+ *   entries. Every key of a page is stored as (length shared with the page's first
+ *   key, remaining bytes), and a per-entry offset index allows binary search in a
+ *   page without decoding it. Pages are found through a map from first keys.
+ * Values live in the pages too, in a fixed array of slots beside the keys, so an
+ *   entry costs no allocation of its own. Entry i's value sits in slot slots[i]:
+ *   insert and erase shift that byte index along with offsets and never move a
+ *   value; only splitting and merging pages do, by moving (or, for types whose
+ *   move may throw, copying) the values over before anything is released.
+ *
+ * Iterators are bidirectional and throw invalid_iterator like map's do, but they
+ *   dereference to a view {first, second}: first is the key decoded into the
+ *   iterator, valid until the iterator moves. Unlike map, insert and erase
+ *   invalidate iterators into the page they touch.
+ * An insert or erase that throws (a copy of T, or std::bad_alloc) leaves the
+ *   elements as they were.
+ */
+template<class T>
+class string_map {
+  public:
+   typedef pair<const std::string, T> value_type;
+
+   struct reference {
+       const std::string &first;
+       T &second;
+   };
+
+   struct const_reference {
+       const std::string &first;
+       const T &second;
+   };
+
+  private:
+   static const size_t PAGE_CAPACITY = 64;
+   static const size_t PAGE_BYTES = 4096;
+
+   struct page {
+       const std::string *first;            // the page's key in index
+       std::string bytes;                   // encoded entries
+       unsigned offsets[PAGE_CAPACITY + 1]; // entry i is bytes[offsets[i], offsets[i + 1])
+       unsigned char slots[PAGE_CAPACITY];  // entry i's value is in storage[slots[i]]
+       unsigned long long used;             // bit s is set while storage[s] holds a value
+       typename std::aligned_storage<sizeof(T), alignof(T)>::type storage[PAGE_CAPACITY];
+       size_t count;
+       page *prev, *next;
+
+       page() : first(nullptr), used(0), count(0), prev(nullptr), next(nullptr) {
+           offsets[0] = 0;
+       }
+
+       page(const page &) = delete;
+       page &operator=(const page &) = delete;
+
+       ~page() {
+           for (unsigned long long m = used; m != 0; m &= m - 1) {
+               release(static_cast<unsigned char>(__builtin_ctzll(m)));
+           }
+       }
+
+       T &value(size_t i) {
+           return *reinterpret_cast<T *>(&storage[slots[i]]);
+       }
+
+       const T &value(size_t i) const {
+           return *reinterpret_cast<const T *>(&storage[slots[i]]);
+       }
+
+       // construct a value in a free slot and return the slot; a page with a free slot is not full
+       template<class V>
+       unsigned char place(V &&v) {
+           unsigned char s = static_cast<unsigned char>(__builtin_ctzll(~used));
+           new (&storage[s]) T(std::forward<V>(v));
+           used |= 1ULL << s;
+           return s;
+       }
+
+       void release(unsigned char s) {
+           reinterpret_cast<T *>(&storage[s])->~T();
+           used &= ~(1ULL << s);
+       }
+   };
+
+   static_assert(PAGE_CAPACITY <= 64, "a page's used slots are one 64-bit mask");
+
+   struct entry {
+       size_t shared;
+       const char *suffix;
+       size_t length;
+   };
+
+   // the bytes and offsets of a page's keys, built aside so a page changes only once nothing can throw
+   struct encoding {
+       std::string bytes;
+       unsigned offsets[PAGE_CAPACITY + 1];
+   };
+
+   typedef map<std::string, page *> index_type;
+
+   index_type index;
+   page *head, *tail;
+   size_t total;
+
+   template<class Ref>
+   struct arrow {
+       Ref ref;
+       const Ref *operator->() const {
+           return &ref;
+       }
+   };
+
+   static void putVarint(std::string &out, size_t v) {
+       while (v >= 0x80) {
+           out += static_cast<char>((v & 0x7f) | 0x80);
+           v >>= 7;
+       }
+       out += static_cast<char>(v);
+   }
+
+   static size_t getVarint(const char *&p) {
+       size_t v = 0;
+       for (size_t shift = 0;; shift += 7) {
+           unsigned char c = static_cast<unsigned char>(*p++);
+           v |= static_cast<size_t>(c & 0x7f) << shift;
+           if (c < 0x80) return v;
+       }
+   }
+
+   static size_t commonPrefix(const std::string &a, const std::string &b) {
+       size_t n = a.size() < b.size() ? a.size() : b.size(), i = 0;
+       while (i < n && a[i] == b[i]) ++i;
+       return i;
+   }
+
+   static void encode(std::string &out, const std::string &first, const std::string &key) {
+       size_t shared = commonPrefix(first, key);
+       putVarint(out, shared);
+       putVarint(out, key.size() - shared);
+       out.append(key, shared, std::string::npos);
+   }
+
+   static entry entryAt(const page *p, size_t i) {
+       const char *cursor = p->bytes.data() + p->offsets[i];
+       entry e;
+       e.shared = getVarint(cursor);
+       e.length = getVarint(cursor);
+       e.suffix = cursor;
+       return e;
+   }
+
+   static void decode(const page *p, size_t i, std::string &key) {
+       entry e = entryAt(p, i);
+       key.assign(*p->first, 0, e.shared);
+       key.append(e.suffix, e.length);
+   }
+
+   /*
+    * sign of key - entry i, where l = commonPrefix(key, first key of the page)
+    *   and firstSign = sign of key - first key. An entry sharing more than l bytes
+    *   with the first key differs from key exactly where the first key does.
+    */
+   static int compareEntry(const page *p, size_t i, const std::string &key, size_t l, int firstSign) {
+       entry e = entryAt(p, i);
+       if (e.shared > l) return firstSign;
+       size_t rest = key.size() - e.shared;
+       size_t n = rest < e.length ? rest : e.length;
+       int c = memcmp(key.data() + e.shared, e.suffix, n);
+       if (c != 0) return c < 0 ? -1 : 1;
+       return rest < e.length ? -1 : (rest > e.length ? 1 : 0);
+   }
+
+   // position of the first entry of p not less than key
+   static size_t search(const page *p, const std::string &key, bool &found) {
+       const std::string &first = *p->first;
+       size_t l = commonPrefix(key, first);
+       int firstSign;
+       if (l < key.size() && l < first.size()) {
+           firstSign = static_cast<unsigned char>(key[l]) < static_cast<unsigned char>(first[l]) ? -1 : 1;
+       } else {
+           firstSign = key.size() < first.size() ? -1 : (key.size() > first.size() ? 1 : 0);
+       }
+       size_t lo = 0, hi = p->count;
+       while (lo < hi) {
+           size_t mid = (lo + hi) / 2;
+           if (compareEntry(p, mid, key, l, firstSign) > 0) {
+               lo = mid + 1;
+           } else {
+               hi = mid;
+           }
+       }
+       found = lo < p->count && compareEntry(p, lo, key, l, firstSign) == 0;
+       return lo;
+   }
+
+   // the page whose range holds key: the last page whose first key is not greater than it
+   page *pageFor(const std::string &key) const {
+       if (head == nullptr) return nullptr;
+       typename index_type::const_iterator it = index.upper_bound(key);
+       if (it == index.cbegin()) return head;
+       --it;
+       return it->second;
+   }
+
+   // index p under key instead of its old first key; if the insertion throws, nothing changes
+   void setFirst(page *p, const std::string &key) {
+       typename index_type::iterator old = p->first == nullptr ? index.end() : index.find(*p->first);
+       pair<typename index_type::iterator, bool> result =
+           index.insert(typename index_type::value_type(key, p));
+       if (old != index.end()) {
+           index.erase(old);
+       }
+       p->first = &result.first->first;
+   }
+
+   // encode keys[0, n) against keys[0]
+   static void encodeAll(encoding &out, const std::string *keys, size_t n) {
+       for (size_t i = 0; i < n; ++i) {
+           out.offsets[i] = static_cast<unsigned>(out.bytes.size());
+           encode(out.bytes, keys[0], keys[i]);
+       }
+       out.offsets[n] = static_cast<unsigned>(out.bytes.size());
+   }
+
+   // give p the n entries of e, whose first key must already be p's, with values in slots[0, n)
+   static void install(page *p, encoding &e, const unsigned char *slots, size_t n) {
+       p->bytes.swap(e.bytes);
+       for (size_t i = 0; i <= n; ++i) {
+           p->offsets[i] = e.offsets[i];
+       }
+       for (size_t i = 0; i < n; ++i) {
+           p->slots[i] = slots[i];
+       }
+       p->count = n;
+   }
+
+   static void decodeAll(const page *p, std::string *keys) {
+       for (size_t i = 0; i < p->count; ++i) {
+           decode(p, i, keys[i]);
+       }
+   }
+
+   // link q, a new page, after p (at the front if p is null)
+   page *linkAfter(page *p, page *q) {
+       q->prev = p;
+       q->next = p == nullptr ? head : p->next;
+       if (q->next != nullptr) {
+           q->next->prev = q;
+       } else {
+           tail = q;
+       }
+       if (p != nullptr) {
+           p->next = q;
+       } else {
+           head = q;
+       }
+       return q;
+   }
+
+   void unlink(page *p) {
+       if (p->prev != nullptr) p->prev->next = p->next;
+       else head = p->next;
+       if (p->next != nullptr) p->next->prev = p->prev;
+       else tail = p->prev;
+       index.erase(index.find(*p->first));
+       delete p;
+   }
+
+   // move the values of entries [from, from + n) of src into free slots of dst, recording
+   //   them in slots; if one throws, dst gets back the slots it had and src is untouched
+   static void moveValues(page *src, size_t from, size_t n, page *dst, unsigned char *slots) {
+       size_t i = 0;
+       try {
+           for (; i < n; ++i) {
+               slots[i] = dst->place(std::move_if_noexcept(src->value(from + i)));
+           }
+       } catch (...) {
+           while (i > 0) dst->release(slots[--i]);
+           throw;
+       }
+       for (i = 0; i < n; ++i) {
+           src->release(src->slots[from + i]);
+       }
+   }
+
+   // move the upper half of p into a new page after it; if anything throws, p is unchanged
+   void split(page *p) {
+       std::string keys[PAGE_CAPACITY];
+       unsigned char slots[PAGE_CAPACITY];
+       decodeAll(p, keys);
+       size_t n = p->count, half = n / 2;
+       encoding lower, upper;
+       encodeAll(lower, keys, half);
+       encodeAll(upper, keys + half, n - half);
+       page *q = new page;
+       try {
+           setFirst(q, keys[half]);
+           moveValues(p, half, n - half, q, slots + half);
+       } catch (...) {
+           if (q->first != nullptr) index.erase(index.find(keys[half]));
+           delete q;
+           throw;
+       }
+       for (size_t i = 0; i < half; ++i) {
+           slots[i] = p->slots[i];
+       }
+       linkAfter(p, q);
+       install(q, upper, slots + half, n - half);
+       install(p, lower, slots, half);
+   }
+
+   // fold p->next into p when both are sparse
+   void mergeNext(page *p) {
+       page *q = p->next;
+       if (q == nullptr || p->count + q->count > PAGE_CAPACITY / 2) return;
+       std::string keys[PAGE_CAPACITY];
+       unsigned char slots[PAGE_CAPACITY];
+       decodeAll(p, keys);
+       for (size_t i = 0; i < q->count; ++i) {
+           decode(q, i, keys[p->count + i]);
+       }
+       size_t n = p->count + q->count;
+       encoding merged;
+       encodeAll(merged, keys, n);
+       moveValues(q, 0, q->count, p, slots + p->count);
+       for (size_t i = 0; i < p->count; ++i) {
+           slots[i] = p->slots[i];
+       }
+       q->count = 0;
+       unlink(q);
+       install(p, merged, slots, n);
+   }
+
+   // p must not be full. The keys are encoded before the value is placed, and the value is
+   //   released again if the page cannot take it, so a throw leaves p as it was
+   void insertEntry(page *p, size_t pos, const std::string &key, const T &value) {
+       if (pos == 0) {
+           // a new first key: every entry is re-coded against it
+           std::string keys[PAGE_CAPACITY];
+           unsigned char slots[PAGE_CAPACITY];
+           keys[0] = key;
+           for (size_t i = 0; i < p->count; ++i) {
+               decode(p, i, keys[i + 1]);
+               slots[i + 1] = p->slots[i];
+           }
+           encoding e;
+           encodeAll(e, keys, p->count + 1);
+           slots[0] = p->place(value);
+           try {
+               setFirst(p, key);
+           } catch (...) {
+               p->release(slots[0]);
+               throw;
+           }
+           install(p, e, slots, p->count + 1);
+           return;
+       }
+       std::string encoded;
+       encode(encoded, *p->first, key);
+       unsigned grow = static_cast<unsigned>(encoded.size());
+       unsigned char slot = p->place(value);
+       try {
+           p->bytes.insert(p->offsets[pos], encoded);
+       } catch (...) {
+           p->release(slot);
+           throw;
+       }
+       for (size_t i = p->count + 1; i > pos; --i) {
+           p->offsets[i] = p->offsets[i - 1] + grow;
+       }
+       for (size_t i = p->count; i > pos; --i) {
+           p->slots[i] = p->slots[i - 1];
+       }
+       p->slots[pos] = slot;
+       ++p->count;
+   }
+
+   void eraseEntry(page *p, size_t pos) {
+       if (p->count == 1) {
+           p->release(p->slots[pos]);
+           p->count = 0;
+           unlink(p);
+           return;
+       }
+       if (pos == 0) {
+           std::string keys[PAGE_CAPACITY];
+           unsigned char slots[PAGE_CAPACITY];
+           for (size_t i = 1; i < p->count; ++i) {
+               decode(p, i, keys[i - 1]);
+               slots[i - 1] = p->slots[i];
+           }
+           encoding e;
+           encodeAll(e, keys, p->count - 1);
+           setFirst(p, keys[0]);
+           p->release(p->slots[0]);
+           install(p, e, slots, p->count - 1);
+       } else {
+           p->release(p->slots[pos]);
+           unsigned shrink = p->offsets[pos + 1] - p->offsets[pos];
+           p->bytes.erase(p->offsets[pos], shrink);
+           for (size_t i = pos; i < p->count; ++i) {
+               p->offsets[i] = p->offsets[i + 1] - shrink;
+           }
+           for (size_t i = pos; i + 1 < p->count; ++i) {
+               p->slots[i] = p->slots[i + 1];
+           }
+           --p->count;
+       }
+       if (p->count < PAGE_CAPACITY / 4) {
+           // the entry is gone already; a merge that throws leaves two sparse but valid pages
+           try {
+               if (p->prev != nullptr && p->prev->count + p->count <= PAGE_CAPACITY / 2) {
+                   mergeNext(p->prev);
+               } else {
+                   mergeNext(p);
+               }
+           } catch (...) {
+           }
+       }
+   }
+
+   void clearPages() {
+       while (head != nullptr) {
+           page *next = head->next;
+           delete head;
+           head = next;
+       }
+       tail = nullptr;
+       index.clear();
+       total = 0;
+   }
+
+   void copyPages(const string_map &other) {
+       for (const page *src = other.head; src != nullptr; src = src->next) {
+           page *p = linkAfter(tail, new page);
+           setFirst(p, *src->first);
+           p->bytes = src->bytes;
+           for (size_t i = 0; i <= src->count; ++i) {
+               p->offsets[i] = src->offsets[i];
+           }
+           p->count = 0;
+           for (size_t i = 0; i < src->count; ++i) {
+               unsigned char s = src->slots[i];
+               new (&p->storage[s]) T(src->value(i));
+               p->used |= 1ULL << s;
+               p->slots[i] = s;
+               p->count = i + 1;
+           }
+       }
+       total = other.total;
+   }
+
+  public:
+   class const_iterator;
+   class iterator {
+      private:
+       string_map *container;
+       page *p;
+       size_t pos;
+       std::string key;
+
+       void load() {
+           if (p != nullptr) decode(p, pos, key);
+       }
+
+      public:
+       iterator() : container(nullptr), p(nullptr), pos(0) {}
+
+       iterator(string_map *c, page *p_, size_t pos_) : container(c), p(p_), pos(pos_) {
+           load();
+       }
+
+       iterator operator++(int) {
+           iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       iterator &operator++() {
+           if (p == nullptr) {
+               throw invalid_iterator();
+           }
+           if (++pos == p->count) {
+               p = p->next;
+               pos = 0;
+           }
+           load();
+           return *this;
+       }
+
+       iterator operator--(int) {
+           iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       iterator &operator--() {
+           if (p == nullptr) {
+               if (container == nullptr || container->tail == nullptr) {
+                   throw invalid_iterator();
+               }
+               p = container->tail;
+               pos = p->count - 1;
+           } else if (pos > 0) {
+               --pos;
+           } else if (p->prev != nullptr) {
+               p = p->prev;
+               pos = p->count - 1;
+           } else {
+               throw invalid_iterator();
+           }
+           load();
+           return *this;
+       }
+
+       reference operator*() const {
+           if (p == nullptr) {
+               throw invalid_iterator();
+           }
+           reference ref = {key, p->value(pos)};
+           return ref;
+       }
+
+       arrow<reference> operator->() const {
+           arrow<reference> result = {**this};
+           return result;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && p == rhs.p && pos == rhs.pos;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && p == rhs.p && pos == rhs.pos;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       friend class string_map;
+       friend class const_iterator;
+   };
+
+   class const_iterator {
+      private:
+       const string_map *container;
+       const page *p;
+       size_t pos;
+       std::string key;
+
+       void load() {
+           if (p != nullptr) decode(p, pos, key);
+       }
+
+      public:
+       const_iterator() : container(nullptr), p(nullptr), pos(0) {}
+
+       const_iterator(const string_map *c, const page *p_, size_t pos_) : container(c), p(p_), pos(pos_) {
+           load();
+       }
+
+       const_iterator(const iterator &other)
+           : container(other.container), p(other.p), pos(other.pos), key(other.key) {}
+
+       const_iterator operator++(int) {
+           const_iterator temp = *this;
+           ++(*this);
+           return temp;
+       }
+
+       const_iterator &operator++() {
+           if (p == nullptr) {
+               throw invalid_iterator();
+           }
+           if (++pos == p->count) {
+               p = p->next;
+               pos = 0;
+           }
+           load();
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator temp = *this;
+           --(*this);
+           return temp;
+       }
+
+       const_iterator &operator--() {
+           if (p == nullptr) {
+               if (container == nullptr || container->tail == nullptr) {
+                   throw invalid_iterator();
+               }
+               p = container->tail;
+               pos = p->count - 1;
+           } else if (pos > 0) {
+               --pos;
+           } else if (p->prev != nullptr) {
+               p = p->prev;
+               pos = p->count - 1;
+           } else {
+               throw invalid_iterator();
+           }
+           load();
+           return *this;
+       }
+
+       const_reference operator*() const {
+           if (p == nullptr) {
+               throw invalid_iterator();
+           }
+           const_reference ref = {key, p->value(pos)};
+           return ref;
+       }
+
+       arrow<const_reference> operator->() const {
+           arrow<const_reference> result = {**this};
+           return result;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && p == rhs.p && pos == rhs.pos;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && p == rhs.p && pos == rhs.pos;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       friend class string_map;
+   };
+
+   string_map() : head(nullptr), tail(nullptr), total(0) {}
+
+   string_map(const string_map &other) : head(nullptr), tail(nullptr), total(0) {
+       try {
+           copyPages(other);
+       } catch (...) {
+           clearPages();
+           throw;
+       }
+   }
+
+   string_map &operator=(const string_map &other) {
+       if (this != &other) {
+           clearPages();
+           copyPages(other);
+       }
+       return *this;
+   }
+
+   ~string_map() {
+       clearPages();
+   }
+
+   /**
+  * access specified element with bounds checking, throw index_out_of_bound if absent.
+    */
+   T &at(const std::string &key) {
+       iterator it = find(key);
+       if (it.p == nullptr) {
+           throw index_out_of_bound();
+       }
+       return it.p->value(it.pos);
+   }
+
+   const T &at(const std::string &key) const {
+       const_iterator it = find(key);
+       if (it.p == nullptr) {
+           throw index_out_of_bound();
+       }
+       return it.p->value(it.pos);
+   }
+
+   /**
+  * access specified element, inserting a default constructed value if absent.
+    */
+   T &operator[](const std::string &key) {
+       iterator it = find(key);
+       if (it.p == nullptr) {
+           it = insert(value_type(key, T())).first;
+       }
+       return it.p->value(it.pos);
+   }
+
+   const T &operator[](const std::string &key) const {
+       return at(key);
+   }
+
+   iterator begin() {
+       return iterator(this, head, 0);
+   }
+
+   const_iterator cbegin() const {
+       return const_iterator(this, head, 0);
+   }
+
+   iterator end() {
+       return iterator(this, nullptr, 0);
+   }
+
+   const_iterator cend() const {
+       return const_iterator(this, nullptr, 0);
+   }
+
+   bool empty() const {
+       return total == 0;
+   }
+
+   size_t size() const {
+       return total;
+   }
+
+   /**
+  * number of pages, for inspecting the layout.
+    */
+   size_t page_count() const {
+       return index.size();
+   }
+
+   void clear() {
+       clearPages();
+   }
+
+   /**
+  * insert an element, return the iterator to it (or to the element that
+  *   prevented the insertion) and whether it was inserted.
+    */
+   pair<iterator, bool> insert(const value_type &value) {
+       const std::string &key = value.first;
+       page *p = pageFor(key);
+       if (p == nullptr) {
+           p = linkAfter(nullptr, new page);
+       }
+       bool found = false;
+       size_t pos = p->count == 0 ? 0 : search(p, key, found);
+       if (found) {
+           return pair<iterator, bool>(iterator(this, p, pos), false);
+       }
+       if (p->count == PAGE_CAPACITY || (p->count > 1 && p->bytes.size() + key.size() > PAGE_BYTES)) {
+           split(p);
+           p = pageFor(key);
+           pos = search(p, key, found);
+       }
+       // the returned iterator holds a copy of the key, made while a throw still changes nothing
+       pair<iterator, bool> result(iterator(this, nullptr, 0), true);
+       try {
+           result.first.key = key;
+           insertEntry(p, pos, key, value.second);
+       } catch (...) {
+           if (p->count == 0) {
+               // the map was empty and p is the page made for this key
+               head = tail = nullptr;
+               delete p;
+           }
+           throw;
+       }
+       ++total;
+       result.first.p = p;
+       result.first.pos = pos;
+       return result;
+   }
+
+   /**
+  * erase the element at pos, throw invalid_iterator for end() or a foreign iterator.
+    */
+   void erase(iterator pos) {
+       if (pos.container != this || pos.p == nullptr) {
+           throw invalid_iterator();
+       }
+       eraseEntry(pos.p, pos.pos);
+       --total;
+   }
+
+   size_t count(const std::string &key) const {
+       return find(key).p != nullptr ? 1 : 0;
+   }
+
+   iterator find(const std::string &key) {
+       page *p = pageFor(key);
+       if (p == nullptr) return end();
+       bool found;
+       size_t pos = search(p, key, found);
+       return found ? iterator(this, p, pos) : end();
+   }
+
+   const_iterator find(const std::string &key) const {
+       const page *p = pageFor(key);
+       if (p == nullptr) return cend();
+       bool found;
+       size_t pos = search(p, key, found);
+       return found ? const_iterator(this, p, pos) : cend();
+   }
+};
+
+}
+
+#endif
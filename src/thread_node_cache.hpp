@@ -0,0 +1,165 @@
+/**
+* node storage for map with per-thread caches, for threads churning private maps
+*/
+#ifndef SJTU_THREAD_NODE_CACHE_HPP
+#define SJTU_THREAD_NODE_CACHE_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * a map storage policy that keeps freed nodes in thread-local magazines:
+ *   sjtu::map<Key, T, std::less<Key>, sjtu::thread_cache_allocator>.
+ * allocate and deallocate touch only the calling thread's magazine for its size
+ *   class. A magazine that runs empty takes a full one from the global depot (or
+ *   carves a new slab); one that grows past two magazines' worth hands one to
+ *   the depot. Only these exchanges take the depot's mutex, once per MAGAZINE_SIZE
+ *   operations, so threads churning their own maps do not contend.
+ * A node freed by another thread than the one that allocated it just joins the
+ *   freeing thread's magazine; the depot moves such surplus back to threads that
+ *   need it. Exiting threads return their magazines to the depot.
+ * Slabs are never returned to the system.
+ */
+class thread_cache_allocator {
+  public:
+   static const size_t GRANULE = 16;
+   static const size_t MAX_BLOCK = 1024;
+   static const size_t MAGAZINE_SIZE = 64;
+
+  private:
+   static const size_t CLASS_COUNT = MAX_BLOCK / GRANULE;
+
+   struct block {
+       block *next;
+   };
+
+   struct magazine {
+       block *head;
+       size_t count;
+   };
+
+   struct depot {
+       std::mutex lock;
+       std::vector<magazine> full[CLASS_COUNT];
+
+       // a magazine of blocks of class index, from the shelf or from a new slab
+       magazine take(size_t index) {
+           {
+               std::lock_guard<std::mutex> guard(lock);
+               if (!full[index].empty()) {
+                   magazine m = full[index].back();
+                   full[index].pop_back();
+                   return m;
+               }
+           }
+           size_t size = (index + 1) * GRANULE;
+           char *slab = static_cast<char *>(::operator new(size * MAGAZINE_SIZE));
+           magazine m = {nullptr, MAGAZINE_SIZE};
+           for (size_t i = MAGAZINE_SIZE; i > 0; --i) {
+               block *b = reinterpret_cast<block *>(slab + (i - 1) * size);
+               b->next = m.head;
+               m.head = b;
+           }
+           return m;
+       }
+
+       void give(size_t index, const magazine &m) {
+           std::lock_guard<std::mutex> guard(lock);
+           full[index].push_back(m);
+       }
+   };
+
+   // never destroyed: threads may still exit after static destruction
+   static depot &shared() {
+       static depot *d = new depot;
+       return *d;
+   }
+
+   struct cache {
+       magazine loaded[CLASS_COUNT];
+
+       cache() {
+           for (size_t i = 0; i < CLASS_COUNT; ++i) {
+               loaded[i].head = nullptr;
+               loaded[i].count = 0;
+           }
+       }
+
+       ~cache() {
+           dead() = true;
+           for (size_t i = 0; i < CLASS_COUNT; ++i) {
+               if (loaded[i].count > 0) shared().give(i, loaded[i]);
+           }
+       }
+   };
+
+   // set once this thread's cache is destroyed; trivially destructible, so still readable then
+   static bool &dead() {
+       static thread_local bool flag = false;
+       return flag;
+   }
+
+   static cache &local() {
+       static thread_local cache c;
+       return c;
+   }
+
+   static size_t classOf(size_t size) {
+       return (size + GRANULE - 1) / GRANULE - 1;
+   }
+
+  public:
+   static void *allocate(size_t size) {
+       if (size > MAX_BLOCK) return ::operator new(size);
+       size_t index = classOf(size);
+       if (dead()) {
+           // a thread-local object destroyed after the cache: no magazine to use
+           return ::operator new((index + 1) * GRANULE);
+       }
+       magazine &m = local().loaded[index];
+       if (m.count == 0) {
+           m = shared().take(index);
+       }
+       block *b = m.head;
+       m.head = b->next;
+       --m.count;
+       return b;
+   }
+
+   static void deallocate(void *p, size_t size) {
+       if (size > MAX_BLOCK) {
+           ::operator delete(p);
+           return;
+       }
+       size_t index = classOf(size);
+       block *b = static_cast<block *>(p);
+       if (dead()) {
+           magazine single = {b, 1};
+           b->next = nullptr;
+           shared().give(index, single);
+           return;
+       }
+       magazine &m = local().loaded[index];
+       if (m.count == 2 * MAGAZINE_SIZE) {
+           // split off a full magazine for the depot
+           magazine spare = {m.head, MAGAZINE_SIZE};
+           block *last = m.head;
+           for (size_t i = 1; i < MAGAZINE_SIZE; ++i) last = last->next;
+           m.head = last->next;
+           m.count -= MAGAZINE_SIZE;
+           last->next = nullptr;
+           shared().give(index, spare);
+       }
+       b->next = m.head;
+       m.head = b;
+       ++m.count;
+   }
+};
+
+}
+
+#endif
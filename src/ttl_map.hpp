@@ -0,0 +1,300 @@
+/**
+* a map whose entries expire, swept by a hierarchical timer wheel
+*/
+#ifndef SJTU_TTL_MAP_HPP
+#define SJTU_TTL_MAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include "map.hpp"
+
+namespace sjtu {
+
+/**
+ * ttl_map<Key, T> maps keys to values that each expire at a time given on insert,
+ *   in the caller's ticks (any unsigned 64-bit clock: ms, s, ...).
+ * An entry is dead once now >= its expiry. Lookups take now and never return a
+ *   dead entry: they remove it on the spot. expire(now) removes every dead entry
+ *   without iterating over live ones.
+ * Expirations are indexed by a hierarchical timer wheel, the entries threaded
+ *   through its buckets by links in the map's nodes: 11 levels of 64 buckets, level
+ *   l bucketing the expiries that first differ from the wheel's time in bits
+ *   [6l, 6l + 6). Moving the wheel's time forward empties the buckets now due and
+ *   spreads the one bucket that still straddles the new time over the levels below.
+ *   An entry moves down at most once per level, and occupancy masks find buckets
+ *   without scanning, so expire costs O(1) amortized per removed entry on top of
+ *   the map's erase, however far time jumps.
+ */
+template<class Key, class T, class Compare = std::less<Key> >
+class ttl_map {
+  public:
+   typedef unsigned long long time_type;
+
+  private:
+   static const size_t BUCKET_BITS = 6;
+   static const size_t BUCKETS = size_t(1) << BUCKET_BITS;
+   static const size_t LEVELS = (64 + BUCKET_BITS - 1) / BUCKET_BITS;
+
+   struct entry;
+   typedef map<Key, entry, Compare> index_type;
+
+   struct entry {
+       T value;
+       time_type expiry;
+       // the bucket's list, linked through the entries: pprev points at whatever points here
+       entry *next, **pprev;
+       typename index_type::iterator self;
+       entry(const T &v, time_type e) : value(v), expiry(e), next(nullptr), pprev(nullptr) {}
+   };
+
+   index_type index;
+   // the time the wheel is at: buckets are relative to it, and due holds expiry <= wheelTime
+   time_type wheelTime;
+   entry *wheel[LEVELS][BUCKETS];
+   unsigned long long occupied[LEVELS];
+   entry *due;
+
+   static void link(entry *&head, entry *e) {
+       e->next = head;
+       e->pprev = &head;
+       if (head != nullptr) head->pprev = &e->next;
+       head = e;
+   }
+
+   // the wheel level of an expiry later than wheelTime
+   size_t levelOf(time_type expiry) const {
+       return (63 - __builtin_clzll(expiry ^ wheelTime)) / BUCKET_BITS;
+   }
+
+   static size_t bucketOf(time_type expiry, size_t level) {
+       return (expiry >> (level * BUCKET_BITS)) & (BUCKETS - 1);
+   }
+
+   void place(entry *e) {
+       if (e->expiry <= wheelTime) {
+           link(due, e);
+           return;
+       }
+       size_t level = levelOf(e->expiry), bucket = bucketOf(e->expiry, level);
+       link(wheel[level][bucket], e);
+       occupied[level] |= 1ULL << bucket;
+   }
+
+   void unlink(entry *e) {
+       *e->pprev = e->next;
+       if (e->next != nullptr) e->next->pprev = e->pprev;
+       if (e->expiry <= wheelTime) return;
+       size_t level = levelOf(e->expiry), bucket = bucketOf(e->expiry, level);
+       if (wheel[level][bucket] == nullptr) occupied[level] &= ~(1ULL << bucket);
+   }
+
+   void remove(typename index_type::iterator it) {
+       unlink(&it->second);
+       index.erase(it);
+   }
+
+   // move the whole list at head onto due, or back through place
+   void drain(entry *&head, bool toDue) {
+       entry *e = head;
+       head = nullptr;
+       while (e != nullptr) {
+           entry *next = e->next;
+           if (toDue) {
+               link(due, e);
+           } else {
+               place(e);
+           }
+           e = next;
+       }
+   }
+
+   // move the wheel's time forward to now
+   void advance(time_type now) {
+       if (now <= wheelTime) return;
+       size_t top = (63 - __builtin_clzll(now ^ wheelTime)) / BUCKET_BITS;
+       // below top, now is past every bucket
+       for (size_t level = 0; level < top; ++level) {
+           for (unsigned long long mask = occupied[level]; mask != 0; mask &= mask - 1) {
+               drain(wheel[level][__builtin_ctzll(mask)], true);
+           }
+           occupied[level] = 0;
+       }
+       // at top, the buckets before now's are due and now's own straddles it
+       size_t digit = bucketOf(now, top);
+       unsigned long long before = occupied[top] & ((1ULL << digit) - 1);
+       for (unsigned long long mask = before; mask != 0; mask &= mask - 1) {
+           drain(wheel[top][__builtin_ctzll(mask)], true);
+       }
+       occupied[top] &= ~before & ~(1ULL << digit);
+       entry *straddling = wheel[top][digit];
+       wheel[top][digit] = nullptr;
+       wheelTime = now;
+       drain(straddling, false);
+   }
+
+  public:
+   ttl_map() : wheelTime(0), due(nullptr) {
+       for (size_t level = 0; level < LEVELS; ++level) {
+           occupied[level] = 0;
+           for (size_t bucket = 0; bucket < BUCKETS; ++bucket) wheel[level][bucket] = nullptr;
+       }
+   }
+
+   // the wheel links into the map's nodes
+   ttl_map(const ttl_map &) = delete;
+   ttl_map &operator=(const ttl_map &) = delete;
+
+   /**
+  * insert (key, value) expiring at expiry if key has no live entry at now, replacing
+  *   a dead one; return whether it was inserted.
+    */
+   bool insert(const Key &key, const T &value, time_type expiry, time_type now) {
+       typename index_type::iterator it = index.find(key);
+       if (it != index.end()) {
+           if (now < it->second.expiry) return false;
+           remove(it);
+       }
+       it = index.insert(typename index_type::value_type(key, entry(value, expiry))).first;
+       it->second.self = it;
+       place(&it->second);
+       return true;
+   }
+
+   /**
+  * make value, expiring at expiry, the entry of key, inserting key if needed.
+    */
+   void assign(const Key &key, const T &value, time_type expiry) {
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) {
+           it = index.insert(typename index_type::value_type(key, entry(value, expiry))).first;
+           it->second.self = it;
+       } else {
+           unlink(&it->second);
+           it->second.value = value;
+           it->second.expiry = expiry;
+       }
+       place(&it->second);
+   }
+
+   /**
+  * move the expiry of key's live entry at now to expiry; return whether there was one.
+    */
+   bool touch(const Key &key, time_type expiry, time_type now) {
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) return false;
+       if (now >= it->second.expiry) {
+           remove(it);
+           return false;
+       }
+       unlink(&it->second);
+       it->second.expiry = expiry;
+       place(&it->second);
+       return true;
+   }
+
+   /**
+  * remove key's entry, live or dead; return the number of entries removed (0 or 1).
+    */
+   size_t erase(const Key &key) {
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) return 0;
+       remove(it);
+       return 1;
+   }
+
+   /**
+  * the value of key's live entry at now; throw index_out_of_bound if there is none.
+  * A dead entry found here is removed.
+    */
+   T &at(const Key &key, time_type now) {
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) throw index_out_of_bound();
+       if (now >= it->second.expiry) {
+           remove(it);
+           throw index_out_of_bound();
+       }
+       return it->second.value;
+   }
+
+   const T &at(const Key &key, time_type now) const {
+       typename index_type::const_iterator it = index.find(key);
+       if (it == index.cend() || now >= it->second.expiry) throw index_out_of_bound();
+       return it->second.value;
+   }
+
+   size_t count(const Key &key, time_type now) {
+       typename index_type::iterator it = index.find(key);
+       if (it == index.end()) return 0;
+       if (now >= it->second.expiry) {
+           remove(it);
+           return 0;
+       }
+       return 1;
+   }
+
+   size_t count(const Key &key, time_type now) const {
+       typename index_type::const_iterator it = index.find(key);
+       return it != index.cend() && now < it->second.expiry ? 1 : 0;
+   }
+
+   /**
+  * the expiry of key's live entry at now; throw index_out_of_bound if there is none.
+    */
+   time_type expiry(const Key &key, time_type now) const {
+       typename index_type::const_iterator it = index.find(key);
+       if (it == index.cend() || now >= it->second.expiry) throw index_out_of_bound();
+       return it->second.expiry;
+   }
+
+   /**
+  * remove every entry dead at now, calling onExpire(key, value) for each just before,
+  *   in no particular order; return how many were removed. now may not go back: an
+  *   earlier time than a previous call's removes nothing new.
+  * onExpire must not modify the ttl_map.
+    */
+   template<class OnExpire>
+   size_t expire(time_type now, OnExpire onExpire) {
+       // once the wheel is at now, due holds exactly the entries with expiry <= now
+       advance(now);
+       size_t removed = 0;
+       while (due != nullptr) {
+           entry *e = due;
+           due = e->next;
+           if (due != nullptr) due->pprev = &due;
+           typename index_type::iterator it = e->self;
+           onExpire(it->first, e->value);
+           index.erase(it);
+           ++removed;
+       }
+       return removed;
+   }
+
+   size_t expire(time_type now) {
+       return expire(now, [](const Key &, const T &) {});
+   }
+
+   /**
+  * the number of entries, counting dead ones that neither expire nor a lookup
+  *   has removed yet.
+    */
+   size_t size() const {
+       return index.size();
+   }
+
+   bool empty() const {
+       return index.empty();
+   }
+
+   void clear() {
+       index.clear();
+       due = nullptr;
+       for (size_t level = 0; level < LEVELS; ++level) {
+           occupied[level] = 0;
+           for (size_t bucket = 0; bucket < BUCKETS; ++bucket) wheel[level][bucket] = nullptr;
+       }
+   }
+};
+
+}
+
+#endif